@@ -0,0 +1,196 @@
+/*******************************************************************************
+ *  SOMAR - Stratified Ocean Model with Adaptive Refinement
+ *  Developed by Ed Santilli & Alberto Scotti
+ *  Copyright (C) 2014 University of North Carolina at Chapel Hill
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301
+ *  USA
+ *
+ *  For up-to-date contact information, please visit the repository homepage,
+ *  https://github.com/somarhub.
+ ******************************************************************************/
+
+// Times the metric fills that run over every new box after a regrid and
+// reports the throughput per cell. The per-element paths (fill_gup and
+// fill_Jgup for each mu, nu) are compared against the row paths
+// (fill_gupRow and fill_JgupRow), which share one Jacobian evaluation
+// across a row. The two must agree to round-off.
+//
+// Usage: benchMetricFill [box size = 32] [repetitions = 5]
+
+#include "GeoSourceInterface.H"
+#include "FArrayBox.H"
+#include "BoxIterator.H"
+#include "parstream.H"
+#include "MayDay.H"
+#include "CONSTANTS.H"
+#include <cstdlib>
+#include <cmath>
+#include <sys/time.h>
+
+#ifdef CH_MPI
+#   include "mpi.h"
+#endif
+
+
+// -----------------------------------------------------------------------------
+// A non-diagonal, non-uniform map with only an analytic fill_physCoor, so
+// every derived fill goes through the GeoSourceInterface defaults.
+// -----------------------------------------------------------------------------
+class BenchTwistedMap: public GeoSourceInterface
+{
+public:
+    virtual const char* getCoorMapName () const
+    {
+        return "BenchTwisted";
+    }
+
+    virtual bool isDiagonal () const
+    {
+        return false;
+    }
+
+    virtual bool isUniform () const
+    {
+        return false;
+    }
+
+    virtual void fill_physCoor (FArrayBox&      a_dest,
+                                const int       a_destComp,
+                                const int       a_mu,
+                                const RealVect& a_dXi) const
+    {
+        const Box& destBox = a_dest.box();
+        const IntVect& destBoxType = destBox.type();
+
+        for (BoxIterator bit(destBox); bit.ok(); ++bit) {
+            const IntVect& iv = bit();
+
+            RealVect Xi;
+            Real pert = 1.0;
+            for (int dir = 0; dir < SpaceDim; ++dir) {
+                Xi[dir] = (Real(iv[dir]) + 0.5 * Real(1 - destBoxType[dir])) * a_dXi[dir];
+                pert *= sin(2.0 * PI * Xi[dir]);
+            }
+            a_dest(iv, a_destComp) = Xi[a_mu] + 0.05 * pert;
+        }
+    }
+};
+
+
+// -----------------------------------------------------------------------------
+// Wall clock in seconds.
+// -----------------------------------------------------------------------------
+static double wallTime ()
+{
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return double(tv.tv_sec) + 1.0e-6 * double(tv.tv_usec);
+}
+
+
+// -----------------------------------------------------------------------------
+// Prints the per-cell cost of a fill.
+// -----------------------------------------------------------------------------
+static void report (const char* a_name,
+                    const double a_seconds,
+                    const long   a_numCells)
+{
+    pout() << "  " << a_name << ": "
+           << 1.0e9 * a_seconds / double(a_numCells) << " ns/cell, "
+           << 1.0e-6 * double(a_numCells) / a_seconds << " Mcells/s" << std::endl;
+}
+
+
+// -----------------------------------------------------------------------------
+int main (int argc, char* argv[])
+{
+#ifdef CH_MPI
+    MPI_Init(&argc, &argv);
+#endif
+    {
+        const int boxSize = (argc > 1)? atoi(argv[1]): 32;
+        const int numReps = (argc > 2)? atoi(argv[2]): 5;
+
+        const Box ccBox(IntVect::Zero, (boxSize - 1) * IntVect::Unit);
+        const RealVect dXi = RealVect::Unit / Real(boxSize);
+        BenchTwistedMap map;
+
+        pout() << "benchMetricFill: " << SpaceDim << "D, box = " << ccBox
+               << ", " << numReps << " repetitions" << std::endl;
+
+        for (int mu = 0; mu < SpaceDim; ++mu) {
+            const Box fcBox = surroundingNodes(ccBox, mu);
+            const long numCells = long(fcBox.numPts()) * long(numReps);
+
+            FArrayBox elemFAB(fcBox, SpaceDim);
+            FArrayBox rowFAB(fcBox, SpaceDim);
+            FArrayBox JFAB(fcBox, 1);
+
+            pout() << "FC in dir " << mu << ":" << std::endl;
+
+            double t0 = wallTime();
+            for (int rep = 0; rep < numReps; ++rep) {
+                map.fill_J(JFAB, 0, dXi);
+            }
+            report("fill_J            ", wallTime() - t0, numCells);
+
+            t0 = wallTime();
+            for (int rep = 0; rep < numReps; ++rep) {
+                for (int nu = 0; nu < SpaceDim; ++nu) {
+                    map.fill_gup(elemFAB, nu, mu, nu, dXi);
+                }
+            }
+            report("fill_gup (x dim)  ", wallTime() - t0, numCells);
+
+            t0 = wallTime();
+            for (int rep = 0; rep < numReps; ++rep) {
+                map.fill_gupRow(rowFAB, mu, dXi);
+            }
+            report("fill_gupRow       ", wallTime() - t0, numCells);
+
+            rowFAB.minus(elemFAB);
+            const Real gupErr = rowFAB.norm(0);
+
+            t0 = wallTime();
+            for (int rep = 0; rep < numReps; ++rep) {
+                for (int nu = 0; nu < SpaceDim; ++nu) {
+                    map.fill_Jgup(elemFAB, nu, mu, nu, dXi);
+                }
+            }
+            report("fill_Jgup (x dim) ", wallTime() - t0, numCells);
+
+            t0 = wallTime();
+            for (int rep = 0; rep < numReps; ++rep) {
+                map.fill_JgupRow(rowFAB, mu, dXi);
+            }
+            report("fill_JgupRow      ", wallTime() - t0, numCells);
+
+            rowFAB.minus(elemFAB);
+            const Real JgupErr = rowFAB.norm(0);
+
+            pout() << "  max |row - element|: gup = " << gupErr
+                   << ", Jgup = " << JgupErr << std::endl;
+
+            if (gupErr > 1.0e-10 || JgupErr > 1.0e-10) {
+                MayDay::Error("benchMetricFill: the row and element fills disagree");
+            }
+        }
+    }
+#ifdef CH_MPI
+    MPI_Finalize();
+#endif
+    return 0;
+}
@@ -0,0 +1,388 @@
+/*******************************************************************************
+ *  SOMAR - Stratified Ocean Model with Adaptive Refinement
+ *  Developed by Ed Santilli & Alberto Scotti
+ *  Copyright (C) 2014 University of North Carolina at Chapel Hill
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301
+ *  USA
+ *
+ *  For up-to-date contact information, please visit the repository homepage,
+ *  https://github.com/somarhub.
+ ******************************************************************************/
+
+// Times the RunLengthIntVectSet operations that regrid uses (union of boxes,
+// grow, coarsen, refine, vertical extrusion, and box containment) against
+// the same operations on an IntVectSet. Every result is also checked
+// against a brute-force, cell-by-cell std::set. The tag sets are random
+// unions of small boxes, some of them at negative indices.
+//
+// Usage: benchRunLengthIVS [domain size = 64] [number of boxes = 200]
+//                          [repetitions = 5] [seed = 1]
+
+#include "RunLengthIntVectSet.H"
+#include "IntVectSet.H"
+#include "BoxIterator.H"
+#include "parstream.H"
+#include "MayDay.H"
+#include <cstdlib>
+#include <set>
+#include <string>
+#include <sys/time.h>
+
+#ifdef CH_MPI
+#   include "mpi.h"
+#endif
+
+
+// -----------------------------------------------------------------------------
+// The brute-force reference set.
+// -----------------------------------------------------------------------------
+struct CellLT {
+    bool operator() (const IntVect& a_lhs, const IntVect& a_rhs) const {
+        return a_lhs.lexLT(a_rhs);
+    }
+};
+typedef std::set<IntVect, CellLT> CellSet;
+
+
+// -----------------------------------------------------------------------------
+// Wall clock in seconds.
+// -----------------------------------------------------------------------------
+static double wallTime ()
+{
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return double(tv.tv_sec) + 1.0e-6 * double(tv.tv_usec);
+}
+
+
+// -----------------------------------------------------------------------------
+// Prints the cost of one operation on both kinds of set.
+// -----------------------------------------------------------------------------
+static void report (const char*  a_name,
+                    const double a_rleSeconds,
+                    const double a_ivsSeconds,
+                    const int    a_numReps)
+{
+    pout() << "  " << a_name << ": RLE = "
+           << 1.0e6 * a_rleSeconds / double(a_numReps) << " us, IntVectSet = "
+           << 1.0e6 * a_ivsSeconds / double(a_numReps) << " us" << std::endl;
+}
+
+
+// -----------------------------------------------------------------------------
+// Throws an error unless a_rle and a_brute hold the same cells.
+// -----------------------------------------------------------------------------
+static void check (const char*                a_name,
+                   const RunLengthIntVectSet& a_rle,
+                   const CellSet&             a_brute)
+{
+    const std::string where = std::string("benchRunLengthIVS: ") + a_name;
+
+    if (a_rle.numPts() != (long long)a_brute.size()) {
+        MayDay::Error((where + " has the wrong number of cells").c_str());
+    }
+
+    CellSet::const_iterator it;
+    for (it = a_brute.begin(); it != a_brute.end(); ++it) {
+        if (!a_rle.contains(*it)) {
+            MayDay::Error((where + " is missing a cell").c_str());
+        }
+    }
+
+    // Equal sizes and containment mean the sets are equal. Make sure the
+    // conversion back to an IntVectSet agrees too.
+    const IntVectSet ivs = a_rle.toIntVectSet();
+    if (ivs.numPts() != (long long)a_brute.size()) {
+        MayDay::Error((where + " does not convert to an IntVectSet").c_str());
+    }
+    if (!a_brute.empty()) {
+        Box bruteMinBox(*a_brute.begin(), *a_brute.begin());
+        for (it = a_brute.begin(); it != a_brute.end(); ++it) {
+            bruteMinBox.minBox(Box(*it, *it));
+        }
+        if (a_rle.minBox() != bruteMinBox) {
+            MayDay::Error((where + " has the wrong minBox").c_str());
+        }
+    }
+}
+
+
+// -----------------------------------------------------------------------------
+// Returns a random box of at most a_maxSize cells per side whose low corner
+// is in [a_lo, a_hi].
+// -----------------------------------------------------------------------------
+static Box randomBox (const int a_lo,
+                      const int a_hi,
+                      const int a_maxSize)
+{
+    IntVect lo, hi;
+    for (int dir = 0; dir < SpaceDim; ++dir) {
+        lo[dir] = a_lo + rand() % (a_hi - a_lo + 1);
+        hi[dir] = lo[dir] + rand() % a_maxSize;
+    }
+    return Box(lo, hi);
+}
+
+
+// -----------------------------------------------------------------------------
+int main (int argc, char* argv[])
+{
+#ifdef CH_MPI
+    MPI_Init(&argc, &argv);
+#endif
+    {
+        const int domSize  = (argc > 1)? atoi(argv[1]): 64;
+        const int numBoxes = (argc > 2)? atoi(argv[2]): 200;
+        const int numReps  = (argc > 3)? atoi(argv[3]): 5;
+        const int seed     = (argc > 4)? atoi(argv[4]): 1;
+        srand(seed);
+
+        const int growCells = 2;
+        const IntVect refRatio = 2 * IntVect::Unit;
+        const int vertDir = SpaceDim - 1;
+        const int loZ = -domSize / 2;
+        const int hiZ = domSize / 2 - 1;
+
+        pout() << "benchRunLengthIVS: " << SpaceDim << "D, "
+               << numBoxes << " boxes in [" << loZ << ", " << hiZ << "]^"
+               << SpaceDim << ", " << numReps << " repetitions" << std::endl;
+
+        Vector<Box> tagBoxes(numBoxes);
+        for (int b = 0; b < numBoxes; ++b) {
+            tagBoxes[b] = randomBox(loZ, hiZ - 8, 8);
+        }
+
+        double t0, rleTime, ivsTime;
+
+        // Union of boxes
+        RunLengthIntVectSet rle;
+        IntVectSet ivs;
+        CellSet brute;
+
+        t0 = wallTime();
+        for (int rep = 0; rep < numReps; ++rep) {
+            rle.clear();
+            for (int b = 0; b < numBoxes; ++b) rle |= tagBoxes[b];
+        }
+        rleTime = wallTime() - t0;
+
+        t0 = wallTime();
+        for (int rep = 0; rep < numReps; ++rep) {
+            ivs.makeEmpty();
+            for (int b = 0; b < numBoxes; ++b) ivs |= tagBoxes[b];
+        }
+        ivsTime = wallTime() - t0;
+
+        for (int b = 0; b < numBoxes; ++b) {
+            for (BoxIterator bit(tagBoxes[b]); bit.ok(); ++bit) {
+                brute.insert(bit());
+            }
+        }
+        report("union   ", rleTime, ivsTime, numReps);
+        check("union", rle, brute);
+
+        const RunLengthIntVectSet baseRLE = rle;
+        const IntVectSet baseIVS = ivs;
+        const CellSet baseBrute = brute;
+
+        // Box containment, as properlyNested uses it.
+        {
+            const int numQueries = 1000;
+            Vector<Box> queries(numQueries);
+            for (int q = 0; q < numQueries; ++q) {
+                queries[q] = randomBox(loZ, hiZ - 4, 4);
+            }
+
+            int rleCount = 0;
+            t0 = wallTime();
+            for (int rep = 0; rep < numReps; ++rep) {
+                for (int q = 0; q < numQueries; ++q) {
+                    if (baseRLE.contains(queries[q])) ++rleCount;
+                }
+            }
+            rleTime = wallTime() - t0;
+
+            int ivsCount = 0;
+            t0 = wallTime();
+            for (int rep = 0; rep < numReps; ++rep) {
+                for (int q = 0; q < numQueries; ++q) {
+                    if (baseIVS.contains(queries[q])) ++ivsCount;
+                }
+            }
+            ivsTime = wallTime() - t0;
+            report("contains", rleTime, ivsTime, numReps);
+
+            for (int q = 0; q < numQueries; ++q) {
+                bool bruteContains = true;
+                for (BoxIterator bit(queries[q]); bit.ok() && bruteContains; ++bit) {
+                    bruteContains = (baseBrute.count(bit()) > 0);
+                }
+                if (baseRLE.contains(queries[q]) != bruteContains) {
+                    MayDay::Error("benchRunLengthIVS: contains(Box) is wrong");
+                }
+            }
+            if (rleCount != ivsCount) {
+                MayDay::Error("benchRunLengthIVS: contains(Box) disagrees with IntVectSet");
+            }
+        }
+
+        // Grow
+        t0 = wallTime();
+        for (int rep = 0; rep < numReps; ++rep) {
+            rle = baseRLE;
+            rle.grow(growCells * IntVect::Unit);
+        }
+        rleTime = wallTime() - t0;
+
+        t0 = wallTime();
+        for (int rep = 0; rep < numReps; ++rep) {
+            ivs = baseIVS;
+            ivs.grow(growCells);
+        }
+        ivsTime = wallTime() - t0;
+
+        brute.clear();
+        {
+            const Box stencil(-growCells * IntVect::Unit, growCells * IntVect::Unit);
+            CellSet::const_iterator it;
+            for (it = baseBrute.begin(); it != baseBrute.end(); ++it) {
+                for (BoxIterator bit(stencil); bit.ok(); ++bit) {
+                    brute.insert(*it + bit());
+                }
+            }
+        }
+        report("grow    ", rleTime, ivsTime, numReps);
+        check("grow", rle, brute);
+
+        // Coarsen
+        t0 = wallTime();
+        for (int rep = 0; rep < numReps; ++rep) {
+            rle = baseRLE;
+            rle.coarsen(refRatio);
+        }
+        rleTime = wallTime() - t0;
+
+        t0 = wallTime();
+        for (int rep = 0; rep < numReps; ++rep) {
+            ivs = baseIVS;
+            ivs.coarsen(refRatio[0]);
+        }
+        ivsTime = wallTime() - t0;
+
+        brute.clear();
+        {
+            CellSet::const_iterator it;
+            for (it = baseBrute.begin(); it != baseBrute.end(); ++it) {
+                IntVect iv = *it;
+                iv.coarsen(refRatio);
+                brute.insert(iv);
+            }
+        }
+        report("coarsen ", rleTime, ivsTime, numReps);
+        check("coarsen", rle, brute);
+
+        // Refine
+        t0 = wallTime();
+        for (int rep = 0; rep < numReps; ++rep) {
+            rle = baseRLE;
+            rle.refine(refRatio);
+        }
+        rleTime = wallTime() - t0;
+
+        t0 = wallTime();
+        for (int rep = 0; rep < numReps; ++rep) {
+            ivs = baseIVS;
+            ivs.refine(refRatio[0]);
+        }
+        ivsTime = wallTime() - t0;
+
+        brute.clear();
+        {
+            CellSet::const_iterator it;
+            for (it = baseBrute.begin(); it != baseBrute.end(); ++it) {
+                Box fineBox(*it, *it);
+                fineBox.refine(refRatio);
+                for (BoxIterator bit(fineBox); bit.ok(); ++bit) {
+                    brute.insert(bit());
+                }
+            }
+        }
+        report("refine  ", rleTime, ivsTime, numReps);
+        check("refine", rle, brute);
+
+        // Vertical extrusion. The IntVectSet version is the cell loop that
+        // AMRNavierStokes::tagCells used to run.
+        t0 = wallTime();
+        for (int rep = 0; rep < numReps; ++rep) {
+            rle = baseRLE;
+            rle.extrude(vertDir, loZ, hiZ);
+        }
+        rleTime = wallTime() - t0;
+
+        t0 = wallTime();
+        for (int rep = 0; rep < numReps; ++rep) {
+            ivs = baseIVS;
+            IVSIterator ivsit(baseIVS);
+            for (ivsit.reset(); ivsit.ok(); ++ivsit) {
+                IntVect lo = ivsit();
+                IntVect hi = ivsit();
+                lo[vertDir] = loZ;
+                hi[vertDir] = hiZ;
+                ivs |= Box(lo, hi);
+            }
+        }
+        ivsTime = wallTime() - t0;
+
+        brute.clear();
+        {
+            CellSet::const_iterator it;
+            for (it = baseBrute.begin(); it != baseBrute.end(); ++it) {
+                IntVect iv = *it;
+                for (int k = loZ; k <= hiZ; ++k) {
+                    iv[vertDir] = k;
+                    brute.insert(iv);
+                }
+            }
+        }
+        report("extrude ", rleTime, ivsTime, numReps);
+        check("extrude", rle, brute);
+
+        // Union of two sets
+        RunLengthIntVectSet other;
+        for (int b = 0; b < numBoxes; ++b) {
+            other |= randomBox(loZ, hiZ - 8, 8);
+        }
+        rle = baseRLE;
+        rle |= other;
+
+        brute = baseBrute;
+        {
+            const Vector<Box> otherBoxes = other.boxes();
+            for (int b = 0; b < otherBoxes.size(); ++b) {
+                for (BoxIterator bit(otherBoxes[b]); bit.ok(); ++bit) {
+                    brute.insert(bit());
+                }
+            }
+        }
+        check("union of sets", rle, brute);
+
+        pout() << "All operations agree with the brute-force sets." << std::endl;
+    }
+#ifdef CH_MPI
+    MPI_Finalize();
+#endif
+    return 0;
+}
@@ -65,10 +65,11 @@ using std::endl;
 #include "LepticAMR.H"
 #include "FORT_PROTO.H"
 #include "ProblemContext.H"
+#include "PlotIOServer.H"
 
 
 // Function prototypes
-void setupMPIComms (const Real a_lesProcFrac);
+void setupMPIComms (const Real a_lesProcFrac, const int a_numIOProcs);
 void testMPIComms ();
 void nsrun ();
 
@@ -141,6 +142,14 @@ int main(int argc, char* argv[])
         pout() << "\tles.proc_frac = " << lesProcFrac << endl;
 #   endif
 
+    ParmParse ppPlot("plot");
+
+    int numIOProcs = 0;
+#   if defined(CH_MPI) && defined(CH_USE_HDF5)
+        ppPlot.query("numIOProcs", numIOProcs);
+        pout() << "\tplot.numIOProcs = " << numIOProcs << endl;
+#   endif
+
 #   ifndef CH_MPI
         if (lesProcFrac != 0.0) {
             MayDay::Warning("Cannot run LES without MPI. Continuing les.proc_frac = 0.0");
@@ -148,9 +157,9 @@ int main(int argc, char* argv[])
         }
 #   endif
 
-    // This creates groups and comms for communication among amr and les.
-    // Call this even if we are not using MPI.
-    setupMPIComms(lesProcFrac);
+    // This creates groups and comms for communication among amr, les, and
+    // the plot I/O ranks. Call this even if we are not using MPI.
+    setupMPIComms(lesProcFrac, numIOProcs);
     testMPIComms();
 
 #   ifdef CH_MPI
@@ -236,6 +245,11 @@ int main(int argc, char* argv[])
             // Setup AMR and run the simulation
             nsrun();
 
+#           ifdef CH_USE_HDF5
+                // Release the plot I/O ranks.
+                PlotIOServer::stop();
+#           endif
+
             // MPI_Barrier(AMRLESMeta::amrComm);
             printf("worldRank %d: AMR code finished.\n", AMRLESMeta::worldRank);
         }
@@ -268,6 +282,18 @@ int main(int argc, char* argv[])
     // End LES-only code
 #endif //USE_LES
 
+#ifdef CH_USE_HDF5
+    // BEGIN: Plot I/O-only code.
+    if (AMRLESMeta::ioSize > 0) {
+        if (AMRLESMeta::isGroupMember(AMRLESMeta::ioGroup)) {
+            PlotIOServer::serve();
+
+            printf("worldRank %d: Plot I/O server finished.\n", AMRLESMeta::worldRank);
+        }
+    }
+    // End plot I/O-only code
+#endif //CH_USE_HDF5
+
     cout << flush;
     MPI_Barrier(MPI_COMM_WORLD);
 
@@ -302,8 +328,9 @@ int main(int argc, char* argv[])
 
 // -----------------------------------------------------------------------------
 // This creates groups and comms for communication among amr and les.
+// The last a_numIOProcs ranks of worldComm are set aside to write plot files.
 // -----------------------------------------------------------------------------
-void setupMPIComms (const Real a_lesProcFrac)
+void setupMPIComms (const Real a_lesProcFrac, const int a_numIOProcs)
 {
     using namespace AMRLESMeta;
 
@@ -314,24 +341,35 @@ void setupMPIComms (const Real a_lesProcFrac)
     worldRank = getGroupRank(worldGroup);
 
 
-    // Compute the sizes of the groups.
-    amrSize = int(round( Real(worldSize)*(1.0-a_lesProcFrac) ));
-    if (amrSize < 0 || worldSize < amrSize) {
+    // Compute the sizes of the groups. The I/O ranks come off the top.
+    ioSize = a_numIOProcs;
+    if (ioSize < 0 || worldSize <= ioSize) {
+        MayDay::Error("setupMPIComms produced an ioSize that is out of range");
+    }
+    const int simSize = worldSize - ioSize;
+
+    amrSize = int(round( Real(simSize)*(1.0-a_lesProcFrac) ));
+    if (amrSize < 0 || simSize < amrSize) {
         MayDay::Error("setupMPIComms produced an amrSize that is out of range");
     }
 
-    lesSize = worldSize - amrSize;
-    if (lesSize < 0 || worldSize < lesSize) {
+    lesSize = simSize - amrSize;
+    if (lesSize < 0 || simSize < lesSize) {
         MayDay::Error("setupMPIComms produced an lesSize that is out of range");
     }
 
+    if (ioSize > 0 && amrSize == 0) {
+        MayDay::Error("setupMPIComms cannot set aside plot I/O ranks without AMR ranks");
+    }
+
     // Now, we have to split worldComm.
-    int membershipKey = ((worldRank < amrSize)? 0: 1);
+    // The ranks are ordered as [amr | les | io].
+    int membershipKey = ((worldRank < amrSize)? 0: ((worldRank < simSize)? 1: 2));
     MPI_Comm splitComm;
     if (MPI_Comm_split(worldComm, membershipKey, worldRank, &splitComm) != MPI_SUCCESS) {
         MayDay::Error("setupMPIComms could not split MPI_COMM_WORLD");
     }
-    if (worldRank < amrSize) {
+    if (membershipKey == 0) {
         amrComm = splitComm;
         amrGroup = getCommGroup(amrComm);
         amrRank = getGroupRank(amrGroup);
@@ -340,7 +378,11 @@ void setupMPIComms (const Real a_lesProcFrac)
         lesGroup = MPI_GROUP_NULL;
         lesRank = MPI_UNDEFINED_RANK;
 
-    } else {
+        ioComm = MPI_COMM_NULL;
+        ioGroup = MPI_GROUP_NULL;
+        ioRank = MPI_UNDEFINED_RANK;
+
+    } else if (membershipKey == 1) {
         lesComm = splitComm;
         lesGroup = getCommGroup(lesComm);
         lesRank = getGroupRank(lesGroup);
@@ -348,11 +390,31 @@ void setupMPIComms (const Real a_lesProcFrac)
         amrComm = MPI_COMM_NULL;
         amrGroup = MPI_GROUP_NULL;
         amrRank = MPI_UNDEFINED_RANK;
+
+        ioComm = MPI_COMM_NULL;
+        ioGroup = MPI_GROUP_NULL;
+        ioRank = MPI_UNDEFINED_RANK;
+
+    } else {
+        ioComm = splitComm;
+        ioGroup = getCommGroup(ioComm);
+        ioRank = getGroupRank(ioGroup);
+
+        amrComm = MPI_COMM_NULL;
+        amrGroup = MPI_GROUP_NULL;
+        amrRank = MPI_UNDEFINED_RANK;
+
+        lesComm = MPI_COMM_NULL;
+        lesGroup = MPI_GROUP_NULL;
+        lesRank = MPI_UNDEFINED_RANK;
     }
 
-    // Set Chombo's communicator
+    // Set Chombo's communicator. The I/O ranks use Chombo to write the
+    // plot files among themselves.
     if (isGroupMember(amrGroup)) {
         Chombo_MPI::comm = amrComm;
+    } else if (isGroupMember(ioGroup)) {
+        Chombo_MPI::comm = ioComm;
     }
 
     // Create the intercommunicator for the AMR and LES groups.
@@ -375,7 +437,7 @@ void setupMPIComms (const Real a_lesProcFrac)
             // Collective communications never want a local rank, they want a special macro.
             amr2lesLeader = ((amrRank == amr2lesLeader)? MPI_ROOT: MPI_PROC_NULL);
 
-        } else {
+        } else if (isGroupMember(lesGroup)) {
             int remoteLeader = 0; // The remote group specifies the remoteRank  (remote = les).
             if (MPI_Intercomm_create(splitComm, amr2lesLeader, amrlesPeerComm, remoteLeader, tag, &interComm) != MPI_SUCCESS) {
                 MayDay::Error("setupMPIComms had an error creating the AMR to LES intercommunicator");
@@ -383,6 +445,11 @@ void setupMPIComms (const Real a_lesProcFrac)
 
             // Collective communications never want a local rank, they want a special macro.
             les2amrLeader = ((lesRank == les2amrLeader)? MPI_ROOT: MPI_PROC_NULL);
+
+        } else {
+            // The I/O ranks do not take part in AMR/LES intercommunication.
+            amr2lesLeader = MPI_UNDEFINED_RANK;
+            les2amrLeader = MPI_UNDEFINED_RANK;
         }
     } else {
         amr2lesLeader = MPI_UNDEFINED_RANK;
@@ -390,6 +457,33 @@ void setupMPIComms (const Real a_lesProcFrac)
         interComm = MPI_COMM_NULL;
     }
 
+    // Create the intercommunicator for the AMR and I/O groups.
+    if (ioSize > 0) {
+        const int amr2ioLeader = 0; // This is the rank in amrComm.
+        const int io2amrLeader = 0; // This is the rank in ioComm.
+        int tag = 436;
+
+        // Use a dedicated peer communicator
+        if (MPI_Comm_dup(MPI_COMM_WORLD, &amrioPeerComm) != MPI_SUCCESS) {
+            MayDay::Error("setupMPIComms had an error creating amrioPeerComm");
+        }
+
+        if (isGroupMember(amrGroup)) {
+            int remoteLeader = simSize; // The worldRank of the first I/O rank.
+            if (MPI_Intercomm_create(splitComm, amr2ioLeader, amrioPeerComm, remoteLeader, tag, &amrioInterComm) != MPI_SUCCESS) {
+                MayDay::Error("setupMPIComms had an error creating the AMR to I/O intercommunicator");
+            }
+        } else if (isGroupMember(ioGroup)) {
+            int remoteLeader = 0; // The worldRank of the first AMR rank.
+            if (MPI_Intercomm_create(splitComm, io2amrLeader, amrioPeerComm, remoteLeader, tag, &amrioInterComm) != MPI_SUCCESS) {
+                MayDay::Error("setupMPIComms had an error creating the AMR to I/O intercommunicator");
+            }
+        }
+    } else {
+        amrioPeerComm = MPI_COMM_NULL;
+        amrioInterComm = MPI_COMM_NULL;
+    }
+
     // Name the communicators to help debugging along.
     if (isGroupMember(amrGroup)) {
         MPI_Comm_set_name(amrComm, "amrComm");
@@ -400,6 +494,12 @@ void setupMPIComms (const Real a_lesProcFrac)
     if (amrSize > 0 && lesSize > 0) {
         MPI_Comm_set_name(interComm, "interComm");
     }
+    if (isGroupMember(ioGroup)) {
+        MPI_Comm_set_name(ioComm, "ioComm");
+    }
+    if (amrioInterComm != MPI_COMM_NULL) {
+        MPI_Comm_set_name(amrioInterComm, "amrioInterComm");
+    }
 }
 
 
@@ -410,6 +510,14 @@ void setupMPIComms (const Real a_lesProcFrac)
 void testMPIComms () {
     using namespace AMRLESMeta;
 
+    // Make sure Chombo is using ioComm on the plot I/O ranks.
+    if (isGroupMember(ioGroup)) {
+        if (Chombo_MPI::comm != ioComm) {
+            MayDay::Error("testMPIComms found that Chombo is not using ioComm");
+        }
+        return;
+    }
+
     // Do we have an intercommunicator?
     if (amrSize <= 0 || lesSize <= 0) return;
 
@@ -519,14 +627,22 @@ void nsrun ()
     thisAMR.plotPrefix(ctx->plot_prefix);
     thisAMR.checkpointInterval(ctx->checkpoint_interval);
     thisAMR.checkpointPrefix(ctx->check_prefix);
+    thisAMR.checkpointStageDir(ctx->checkpoint_stageDir);
+    thisAMR.thumbnailInterval(ctx->thumbnail_interval);
+    thisAMR.thumbnailPrefix(ctx->thumbnail_prefix);
+    thisAMR.thumbnailCoarsening(ctx->thumbnail_coarsening);
     thisAMR.gridBufferSize(ctx->bufferSize);
 
     thisAMR.maxGridSize(ctx->maxGridSize);
     thisAMR.maxBaseGridSize(ctx->maxBaseGridSize);
     thisAMR.splitDirs(ctx->splitDirs);
     thisAMR.fillRatio(ctx->fill_ratio);
+    thisAMR.distributedClustering(ctx->distributedClustering);
     thisAMR.blockFactor(ctx->block_factor);
+    thisAMR.columnBlockFactor(ctx->column_block_factor);
     thisAMR.regridIntervals(ctx->regrid_intervals);
+    thisAMR.adaptiveRegrid(ctx->regrid_drift_tol, ctx->min_regrid_intervals);
+    thisAMR.maxLevelCells(ctx->max_level_cells);
 
     if (ctx->fixed_dt > 0) {
         thisAMR.fixedDt(ctx->fixed_dt);
@@ -536,9 +652,7 @@ void nsrun ()
     if (ctx->isRestart) {
         // Initialize from restart file
 #ifdef CH_USE_HDF5
-        HDF5Handle handle(ctx->restart_file, HDF5Handle::OPEN_RDONLY);
-        thisAMR.setupForRestart(handle);
-        handle.close();
+        thisAMR.setupForRestart(ctx->restart_file);
 #else
         MayDay::Error("AMRNavierStokes restart only defined with HDF5");
 #endif
@@ -562,6 +676,9 @@ void nsrun ()
     // Conclude
     thisAMR.conclude();
 
+    // Report on the metric caches before they are freed.
+    LevelGeometry::printCacheStats();
+
     // Free statically allocated memory.
     LevelGeometry::staticUndefine();
     LepticMeshRefine::deleteBuffer();
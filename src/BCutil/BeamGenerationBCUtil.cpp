@@ -133,6 +133,7 @@ void BeamGenerationBCUtil::setBackgroundScalar (FArrayBox&           a_scalarFAB
         // Get Cartesian coordinates at each point of a_scalarFAB.
         FArrayBox posFAB(a_scalarFAB.box(), 1);
         const RealVect& dx = a_levGeo.getDx();
+        MapTimeScope mapTime(a_levGeo);
         LevelGeometry::getGeoSourcePtr()->fill_physCoor(posFAB, 0, SpaceDim-1, dx);
 
         // Loop over each point of a_scalarFAB and set to background value.
@@ -320,6 +320,7 @@ void DJLBCUtil::setBackgroundScalar (FArrayBox&           a_scalarFAB,
         // Gather Cartesian coordinates.
         FArrayBox posFAB(a_scalarFAB.box(), 1);
         const RealVect& dx = a_levGeo.getDx();
+        MapTimeScope mapTime(a_levGeo);
         a_levGeo.getGeoSourcePtr()->fill_physCoor(posFAB, 0, SpaceDim-1, dx);
 
         // Loop over a_scalarFAB and set background scalar values.
@@ -136,6 +136,7 @@ void InternalWaveBCUtil::setBackgroundScalar (FArrayBox&           a_scalarFAB,
         // Get Cartesian coordinates at each point of a_scalarFAB.
         FArrayBox posFAB(a_scalarFAB.box(), 1);
         const RealVect& dx = a_levGeo.getDx();
+        MapTimeScope mapTime(a_levGeo);
         a_levGeo.getGeoSourcePtr()->fill_physCoor(posFAB, 0, SpaceDim-1, dx);
 
         // Loop over each point of a_scalarFAB and set to background value.
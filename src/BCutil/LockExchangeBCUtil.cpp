@@ -74,6 +74,7 @@ void LockExchangeBCUtil::setScalarIC (FArrayBox&           a_scalarFAB,
 
         // Compute Cartesian cell coordinates
         FArrayBox xposFAB(surroundingNodes(dataBox,0), 1);
+        MapTimeScope mapTime(a_levGeo);
         LevelGeometry::getGeoSourcePtr()->fill_physCoor(xposFAB, 0, 0, dx);
 
         FArrayBox yposFAB(dataBox, 1);
@@ -276,6 +276,7 @@ void PhysBCUtil::computeNSq (LevelData<FArrayBox>& a_Nsq,
     // Declare variables
     const RealVect& dx = a_levGeo.getDx();
     const GeoSourceInterface& geoSource = *(a_levGeo.getGeoSourcePtr());
+    MapTimeScope mapTime(a_levGeo);
     DataIterator dit = a_Nsq.dataIterator();
 
     // Loop over grids and compute Nsq.
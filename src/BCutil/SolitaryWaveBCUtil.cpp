@@ -205,6 +205,7 @@ void SolitaryWaveBCUtil::setBackgroundScalar (FArrayBox&           a_scalarFAB,
     if (s_useBackgroundScalar && a_scalarComp == 0) {
         FArrayBox posFAB(a_scalarFAB.box(), 1);
         const RealVect& dx = a_levGeo.getDx();
+        MapTimeScope mapTime(a_levGeo);
         a_levGeo.getGeoSourcePtr()->fill_physCoor(posFAB, 0, SpaceDim-1, dx);
 
         BoxIterator bit(a_scalarFAB.box());
@@ -19,6 +19,10 @@ using std::endl;
 #include "LepticAMR.H"
 #include "CH_Timer.H"
 #include "ProblemContext.H"
+#include "PlotIOServer.H"
+#include "CheckpointStager.H"
+#include "PlotWriter.H"
+#include "DiagnosticsLog.H"
 
 #ifdef CH_USE_TIMER
 using namespace Chombo;
@@ -69,6 +73,8 @@ void LepticAMR::setDefaultValues()
     m_checkpoint_interval = -1;
     m_plot_interval = -1;
     m_plot_period = -1.0;
+    m_thumbnail_interval = -1;
+    m_thumbnail_coarsening = 4 * IntVect::Unit;
     m_next_plot_time = -1.0;
     m_max_grid_size = IntVect::Zero;
     m_max_base_grid_size = m_max_grid_size;
@@ -84,11 +90,14 @@ void LepticAMR::setDefaultValues()
     m_use_meshrefine = false;
     m_plotfile_prefix = string("pltstate");
     m_checkpointfile_prefix = string("chk");
+    m_checkpoint_stageDir = string("");
+    m_thumbnail_prefix = string("thumb_");
     m_verbosity = 0;
     m_cur_time = 0;
     m_dt_tolerance_factor = 1.1;
     m_fixedDt = -1;
     m_blockFactor = 4;
+    m_regrid_drift_tol = -1.0;
 #ifdef CH_USE_TIMER
     m_timer = NULL ;
 #endif
@@ -241,6 +250,18 @@ void LepticAMR::blockFactor(int a_blockFactor)
 }
 //-----------------------------------------------------------------------
 
+//-----------------------------------------------------------------------
+void LepticAMR::columnBlockFactor(int a_columnBlockFactor)
+{
+    CH_TIME("LepticAMR::columnBlockFactor");
+
+    CH_assert(a_columnBlockFactor >= 0);
+    CH_assert(a_columnBlockFactor % m_blockFactor == 0);
+
+    m_mesh_refine.setColumnBlockFactor(a_columnBlockFactor);
+}
+//-----------------------------------------------------------------------
+
 //-----------------------------------------------------------------------
 void LepticAMR::fillRatio(Real a_fillRatio)
 {
@@ -253,6 +274,17 @@ void LepticAMR::fillRatio(Real a_fillRatio)
 }
 //-----------------------------------------------------------------------
 
+//-----------------------------------------------------------------------
+void LepticAMR::distributedClustering(bool a_distributed)
+{
+    CH_TIME("LepticAMR::distributedClustering");
+
+    CH_assert(isDefined());
+
+    m_mesh_refine.setDistributedClustering(a_distributed);
+}
+//-----------------------------------------------------------------------
+
 //-----------------------------------------------------------------------
 void LepticAMR::checkpointPrefix(const std::string& a_checkpointfile_prefix)
 {
@@ -262,6 +294,15 @@ void LepticAMR::checkpointPrefix(const std::string& a_checkpointfile_prefix)
 }
 //-----------------------------------------------------------------------
 
+//-----------------------------------------------------------------------
+void LepticAMR::checkpointStageDir(const std::string& a_checkpoint_stageDir)
+{
+    CH_assert(isDefined());
+
+    m_checkpoint_stageDir = a_checkpoint_stageDir;
+}
+//-----------------------------------------------------------------------
+
 //-----------------------------------------------------------------------
 void LepticAMR::regridIntervals(const Vector<int>& a_regridIntervals)
 {
@@ -272,6 +313,32 @@ void LepticAMR::regridIntervals(const Vector<int>& a_regridIntervals)
 }
 //-----------------------------------------------------------------------
 
+//-----------------------------------------------------------------------
+void LepticAMR::adaptiveRegrid(Real a_driftTol, const Vector<int>& a_minIntervals)
+{
+    CH_assert(isDefined());
+    CH_assert(a_driftTol <= 0.0 || a_minIntervals.size() >= m_max_level);
+
+    m_regrid_drift_tol = a_driftTol;
+    m_min_regrid_intervals = a_minIntervals;
+}
+//-----------------------------------------------------------------------
+
+//-----------------------------------------------------------------------
+void LepticAMR::maxLevelCells(const Vector<Real>& a_maxCells)
+{
+    CH_assert(isDefined());
+
+    m_max_level_cells = a_maxCells;
+
+    // The levels need to know if their tags will be ranked.
+    for (int level = 0; level <= m_max_level; ++level) {
+        const Real budget = (level < m_max_level_cells.size())? m_max_level_cells[level]: 0.0;
+        m_amrlevels[level]->cellBudget(budget);
+    }
+}
+//-----------------------------------------------------------------------
+
 //-----------------------------------------------------------------------
 void LepticAMR::plotInterval(int a_plot_interval)
 {
@@ -279,6 +346,28 @@ void LepticAMR::plotInterval(int a_plot_interval)
 }
 //-----------------------------------------------------------------------
 
+//-----------------------------------------------------------------------
+void LepticAMR::thumbnailInterval(int a_thumbnail_interval)
+{
+    m_thumbnail_interval = a_thumbnail_interval;
+}
+//-----------------------------------------------------------------------
+
+//-----------------------------------------------------------------------
+void LepticAMR::thumbnailPrefix(const std::string& a_thumbnail_prefix)
+{
+    m_thumbnail_prefix = a_thumbnail_prefix;
+}
+//-----------------------------------------------------------------------
+
+//-----------------------------------------------------------------------
+void LepticAMR::thumbnailCoarsening(const IntVect& a_thumbnail_coarsening)
+{
+    CH_assert(a_thumbnail_coarsening.min() >= 1);
+    m_thumbnail_coarsening = a_thumbnail_coarsening;
+}
+//-----------------------------------------------------------------------
+
 //-----------------------------------------------------------------------
 void LepticAMR::plotPeriod(Real a_plot_period)
 {
@@ -653,6 +742,37 @@ void LepticAMR::setupForRestart(HDF5Handle& a_handle)
         m_amrlevels[level]->initialData();
     }
 }
+//-----------------------------------------------------------------------
+
+//-----------------------------------------------------------------------
+void LepticAMR::setupForRestart(const std::string& a_filename)
+{
+    std::string hdf5File = a_filename;
+
+    if (CheckpointStager::isStaged(a_filename)) {
+        // Merge the per-rank files into <name>.hdf5 next to the directory.
+        hdf5File = a_filename;
+        while (hdf5File.size() > 1 && hdf5File[hdf5File.size() - 1] == '/') {
+            hdf5File.erase(hdf5File.size() - 1);
+        }
+        const std::string stagedExt(".staged");
+        if (hdf5File.size() > stagedExt.size() &&
+            hdf5File.compare(hdf5File.size() - stagedExt.size(), stagedExt.size(), stagedExt) == 0) {
+            hdf5File.erase(hdf5File.size() - stagedExt.size());
+        }
+        hdf5File += ".hdf5";
+
+        if (m_verbosity >= 2) {
+            pout() << "merging staged checkpoint " << a_filename
+                   << " into " << hdf5File << endl;
+        }
+        CheckpointStager::merge(a_filename, hdf5File);
+    }
+
+    HDF5Handle handle(hdf5File, HDF5Handle::OPEN_RDONLY);
+    this->setupForRestart(handle);
+    handle.close();
+}
 #endif
 //-----------------------------------------------------------------------
 
@@ -678,6 +798,14 @@ void LepticAMR::conclude() const
         writeCheckpointFile();
     }
 
+#ifdef CH_USE_HDF5
+    // Don't leave before the last staged checkpoint is safe.
+    CheckpointStager::wait();
+#endif
+
+    // Write out any diagnostics that are still held in memory.
+    DiagnosticsLog::close();
+
     // Call any scheduled functions. This is placed after plotting and
     // checkpointing so that the plotting functions can congeal plot files.
     if (!m_scheduler.isNull()) {
@@ -794,6 +922,18 @@ void LepticAMR::run(Real a_max_time, int a_max_step)
             m_next_plot_time = m_cur_time + m_plot_period;
         }
 
+        // Write a thumbnail if enough steps have passed.
+        if ((m_thumbnail_interval > 0) &&
+                (m_cur_step % m_thumbnail_interval == 0)) {
+            writeThumbnailFile();
+        }
+
+        // Sample any probes that are due.
+        m_amrlevels[0]->writeProbes(m_cur_step, m_cur_time);
+
+        // Call any in-situ analyses that are due.
+        runInSituAnalyses();
+
         // Call any scheduled functions. This is placed here so that
         // the plotter function can assume plot files have already been dumped.
         if (!m_scheduler.isNull())
@@ -804,6 +944,11 @@ void LepticAMR::run(Real a_max_time, int a_max_step)
         bool timeBoundary = true;
         (void)timeStep(level, stepsLeft, timeBoundary);
 
+#ifdef CH_USE_HDF5
+        // Nudge any plot file that is still on its way to the I/O ranks.
+        PlotIOServer::progress();
+#endif
+
         assignDt();
 #ifdef CH_USE_TIMER
         m_timer->stop();
@@ -1126,9 +1271,7 @@ int LepticAMR::timeStep(int a_level, int a_stepsLeft, bool a_coarseTimeBoundary)
 
             // regrid if necessary
             //if not, increment number of steps since regrid.
-            bool regridThisLevel =
-                (m_regrid_intervals[a_level] > 0) &&
-                (m_steps_since_regrid[a_level] >= m_regrid_intervals[a_level]);
+            bool regridThisLevel = regridIsDue(a_level, true);
             if (regridThisLevel) {
                 regrid(a_level);
                 m_steps_since_regrid[a_level] = 1; // Changed from 0 to 1 by ES - this step counts!
@@ -1199,22 +1342,131 @@ bool LepticAMR::needToRegrid(int a_level, int a_stepsLeft) const
         pout() << "LepticAMR::needToRegrid(" << a_level << ")" << endl;
     }
 
-    regridThisLevel =
-        (m_regrid_intervals[a_level] > 0) &&
-        (m_steps_since_regrid[a_level] >= m_regrid_intervals[a_level]);
-
     int nextCoarserLevel = a_level - 1;
 
+    // In adaptive mode, we cannot know whether the coarser level's tags
+    // will drift, so only its max interval is considered here.
     regridNextCoarserLevel =
         (a_stepsLeft == 0)                         &&
         (nextCoarserLevel >= 0)                    &&
-        (m_regrid_intervals[nextCoarserLevel] > 0) &&
-        (m_steps_since_regrid[nextCoarserLevel] >= m_regrid_intervals[nextCoarserLevel]);
+        regridIsDue(nextCoarserLevel, false);
+
+    // Only run the (more expensive) drift check if it matters.
+    if (!regridNextCoarserLevel) {
+        regridThisLevel = regridIsDue(a_level, true);
+    }
 
     return (regridThisLevel && !regridNextCoarserLevel);
 }
 //-----------------------------------------------------------------------
 
+//-----------------------------------------------------------------------
+bool LepticAMR::regridIsDue(int a_level, bool a_checkDrift) const
+{
+    if (m_regrid_intervals[a_level] <= 0) return false;
+
+    const int steps = m_steps_since_regrid[a_level];
+    if (steps >= m_regrid_intervals[a_level]) return true;
+
+    // Fixed intervals?
+    if (m_regrid_drift_tol <= 0.0 || !a_checkDrift) return false;
+
+    if (steps < m_min_regrid_intervals[a_level]) return false;
+
+    const Real drift = tagDriftFraction(a_level);
+    if (m_verbosity >= 4) {
+        pout() << "LepticAMR::regridIsDue: level " << a_level
+               << " tag drift = " << drift << endl;
+    }
+
+    return (drift > m_regrid_drift_tol);
+}
+//-----------------------------------------------------------------------
+
+//-----------------------------------------------------------------------
+// Tags a_level and counts how many tags are not covered by the next
+// finer level. If there are no tags, the finer level is no longer needed
+// and we return 1 if it exists. The tags are pruned to the cell budget
+// first, just as regrid would, or an over-budget level would always drift.
+Real LepticAMR::tagDriftFraction(int a_level) const
+{
+    CH_TIME("LepticAMR::tagDriftFraction");
+
+    IntVectSet tags;
+    m_amrlevels[a_level]->tagCells(tags);
+    pruneToCellBudget(tags, a_level);
+    long long numTags[2];
+    numTags[0] = tags.numPts();
+
+    if (a_level < m_finest_level) {
+        const Vector<Box>& fineBoxes = m_amrlevels[a_level + 1]->boxes();
+        for (int i = 0; i < fineBoxes.size(); ++i) {
+            tags -= coarsen(fineBoxes[i], m_ref_ratios[a_level]);
+            if (tags.isEmpty()) break;
+        }
+    }
+    numTags[1] = tags.numPts();
+
+#ifdef CH_MPI
+    long long localNumTags[2] = {numTags[0], numTags[1]};
+    MPI_Allreduce(localNumTags, numTags, 2, MPI_LONG_LONG, MPI_SUM, Chombo_MPI::comm);
+#endif
+
+    if (numTags[0] == 0) {
+        return ((a_level < m_finest_level)? 1.0: 0.0);
+    }
+    return Real(numTags[1]) / Real(numTags[0]);
+}
+//-----------------------------------------------------------------------
+
+//-----------------------------------------------------------------------
+// The clustering covers at least m_fillRatio of each new box with tags,
+// so a level with at most budget * m_fillRatio / refVolume tags below it
+// fits in its budget. This ignores the grid buffer and the cells added
+// for proper nesting, so the budget should leave some headroom.
+void LepticAMR::enforceCellBudget(Vector<IntVectSet>& a_tags,
+                                  int                 a_baseLevel,
+                                  int                 a_topLevel) const
+{
+    CH_TIME("LepticAMR::enforceCellBudget");
+
+    for (int level = a_baseLevel; level <= a_topLevel; ++level) {
+        pruneToCellBudget(a_tags[level], level);
+    }
+}
+//-----------------------------------------------------------------------
+
+//-----------------------------------------------------------------------
+// See enforceCellBudget.
+void LepticAMR::pruneToCellBudget(IntVectSet& a_tags,
+                                  int         a_level) const
+{
+    if (a_level >= m_max_level_cells.size()) return;
+
+    const Real budget = m_max_level_cells[a_level];
+    if (budget <= 0.0) return;
+
+    const Real refVolume = Real(m_ref_ratios[a_level].product());
+    const long long maxTags = (long long)(budget * m_fillRatio / refVolume);
+
+    long long numTags = a_tags.numPts();
+#ifdef CH_MPI
+    long long localNumTags = numTags;
+    MPI_Allreduce(&localNumTags, &numTags, 1, MPI_LONG_LONG, MPI_SUM, Chombo_MPI::comm);
+#endif
+    if (numTags <= maxTags) return;
+
+    if (m_verbosity >= 2) {
+        pout() << "LepticAMR::pruneToCellBudget: level " << a_level
+               << " has " << numTags << " tags. Pruning to "
+               << maxTags << " to fit level " << a_level + 1
+               << " in " << budget << " cells." << endl;
+    }
+
+    m_amrlevels[a_level]->pruneTags(a_tags, maxTags);
+}
+//-----------------------------------------------------------------------
+
 //-----------------------------------------------------------------------
 // generate new grid hierarchy
 void LepticAMR::regrid(int a_base_level)
@@ -1268,6 +1520,8 @@ void LepticAMR::regrid(int a_base_level)
             }
         }
 
+        enforceCellBudget(tags, a_base_level, top_level);
+
         int new_finest_level;
         new_finest_level = m_mesh_refine.regrid(new_grids,
                                                 tags,
@@ -1572,6 +1826,8 @@ void LepticAMR::initialGrid()
                 }
             }
 
+            enforceCellBudget(tags, 0, top_level);
+
             m_finest_level = m_mesh_refine.regrid(new_grids,
                                                   tags,
                                                   0,
@@ -1665,8 +1921,6 @@ void LepticAMR::writePlotFile() const
         pout() << "plot file name = " << iter_str << endl;
     }
 
-    HDF5Handle handle(iter_str.c_str(), HDF5Handle::CREATE);
-
     // write amr data
     HDF5HeaderData header;
     header.m_int ["max_level"]  = m_max_level;
@@ -1674,22 +1928,46 @@ void LepticAMR::writePlotFile() const
     header.m_int ["iteration"]  = m_cur_step;
     header.m_real["time"]       = m_cur_time;
 
-    // should steps since regrid be in the checkpoint file?
-    header.writeToFile(handle);
-
     if (m_verbosity >= 3) {
         pout() << header << endl;
     }
 
-    // write physics class header data
-    m_amrlevels[0]->writePlotHeader(handle);
+    if (PlotIOServer::isActive()) {
+        // Collect everything and let the I/O ranks do the writing.
+        HDF5HeaderData plotHeader;
+        m_amrlevels[0]->getPlotHeader(plotHeader);
 
-    // write physics class per-level data
-    for (int level = 0; level <= m_finest_level; ++level) {
-        m_amrlevels[level]->writePlotLevel(handle);
-    }
+        Vector<HDF5HeaderData> levHeaders(m_finest_level + 1);
+        Vector<LevelData<FArrayBox>*> levData(m_finest_level + 1, NULL);
+        for (int level = 0; level <= m_finest_level; ++level) {
+            levData[level] = new LevelData<FArrayBox>;
+            m_amrlevels[level]->getPlotLevel(levHeaders[level], *levData[level]);
+        }
 
-    handle.close();
+        const ProblemContext* ctx = ProblemContext::getInstance();
+        PlotIOServer::sendPlotFile(iter_str, header, plotHeader, levHeaders, levData,
+                                   ctx->plot_writeOptions);
+
+        for (int level = 0; level <= m_finest_level; ++level) {
+            delete levData[level];
+        }
+
+    } else {
+        HDF5Handle handle(iter_str.c_str(), HDF5Handle::CREATE);
+
+        // should steps since regrid be in the checkpoint file?
+        header.writeToFile(handle);
+
+        // write physics class header data
+        m_amrlevels[0]->writePlotHeader(handle);
+
+        // write physics class per-level data
+        for (int level = 0; level <= m_finest_level; ++level) {
+            m_amrlevels[level]->writePlotLevel(handle);
+        }
+
+        handle.close();
+    }
 #endif
 
     // Here's an extra hook for doing custom plots. :-P -JNJ
@@ -1697,6 +1975,59 @@ void LepticAMR::writePlotFile() const
 }
 //-----------------------------------------------------------------------
 
+//-----------------------------------------------------------------------
+void LepticAMR::writeThumbnailFile() const
+{
+    CH_TIME("LepticAMR::writeThumbnailFile");
+
+    CH_assert(m_isDefined);
+
+    if (m_verbosity >= 3) {
+        pout() << "LepticAMR::writeThumbnailFile" << endl;
+    }
+
+#ifdef CH_USE_HDF5
+    string iter_str = m_thumbnail_prefix;
+
+    char suffix[100];
+    sprintf(suffix, "%06d.%dd.hdf5", m_cur_step, SpaceDim);
+
+    iter_str += suffix;
+
+    if (m_verbosity >= 4) {
+        pout() << "thumbnail file name = " << iter_str << endl;
+    }
+
+    // The physics class averages its plot data down for us.
+    HDF5HeaderData plotHeader, levHeader;
+    LevelData<FArrayBox> thumbData;
+    m_amrlevels[0]->getPlotHeader(plotHeader);
+    m_amrlevels[0]->getThumbnail(levHeader, thumbData, m_thumbnail_coarsening);
+
+    // write amr data
+    HDF5HeaderData header;
+    header.m_int ["max_level"]  = 0;
+    header.m_int ["num_levels"] = 1;
+    header.m_int ["iteration"]  = m_cur_step;
+    header.m_real["time"]       = m_cur_time;
+
+    HDF5Handle handle(iter_str.c_str(), HDF5Handle::CREATE);
+    header.writeToFile(handle);
+    plotHeader.writeToFile(handle);
+
+    handle.setGroup("level_0");
+    levHeader.writeToFile(handle);
+    write(handle, thumbData.getBoxes());
+
+    const ProblemContext* ctx = ProblemContext::getInstance();
+    writePlotData(handle, thumbData, "data", thumbData.ghostVect(),
+                  ctx->plot_writeOptions);
+
+    handle.close();
+#endif
+}
+//-----------------------------------------------------------------------
+
 //-----------------------------------------------------------------------
 void LepticAMR::writeCheckpointFile() const
 {
@@ -1708,11 +2039,18 @@ void LepticAMR::writeCheckpointFile() const
         pout() << "LepticAMR::writeCheckpointFile" << endl;
     }
 
+    // A restart from this checkpoint should find the diagnostics up to here.
+    DiagnosticsLog::flush();
+
 #ifdef CH_USE_HDF5
     string iter_str = m_checkpointfile_prefix;
 
     char suffix[100];
-    sprintf(suffix, "%06d.%dd.hdf5", m_cur_step, SpaceDim);
+    if (m_checkpoint_stageDir.empty()) {
+        sprintf(suffix, "%06d.%dd.hdf5", m_cur_step, SpaceDim);
+    } else {
+        sprintf(suffix, "%06d.%dd.staged", m_cur_step, SpaceDim);
+    }
 
     iter_str += suffix;
 
@@ -1720,8 +2058,6 @@ void LepticAMR::writeCheckpointFile() const
         pout() << "checkpoint file name = " << iter_str << endl;
     }
 
-    HDF5Handle handle(iter_str.c_str(), HDF5Handle::CREATE);
-
     // write amr data
     HDF5HeaderData header;
     header.m_int ["max_level"]  = m_max_level;
@@ -1735,13 +2071,35 @@ void LepticAMR::writeCheckpointFile() const
         header.m_int[headername] = m_regrid_intervals[level];
     }
 
-    // should steps since regrid be in the checkpoint file?
-    header.writeToFile(handle);
-
     if (m_verbosity >= 3) {
         pout() << header << endl;
     }
 
+    if (!m_checkpoint_stageDir.empty()) {
+        // Dump our boxes to node-local storage and drain them to iter_str
+        // in the background.
+        HDF5HeaderData physHeader;
+        m_amrlevels[0]->getCheckpointHeader(physHeader);
+
+        Vector<HDF5HeaderData> levHeaders(m_finest_level + 1);
+        Vector<Vector<std::string> > levNames(m_finest_level + 1);
+        Vector<Vector<const LevelData<FArrayBox>*> > levData(m_finest_level + 1);
+        for (int level = 0; level <= m_finest_level; ++level) {
+            m_amrlevels[level]->getCheckpointLevel(levHeaders[level],
+                                                   levNames[level],
+                                                   levData[level]);
+        }
+
+        CheckpointStager::stage(m_checkpoint_stageDir, iter_str, header,
+                                physHeader, levHeaders, levNames, levData);
+        return;
+    }
+
+    HDF5Handle handle(iter_str.c_str(), HDF5Handle::CREATE);
+
+    // should steps since regrid be in the checkpoint file?
+    header.writeToFile(handle);
+
     // write physics class data
     m_amrlevels[0]->writeCheckpointHeader(handle);
 
@@ -1754,6 +2112,31 @@ void LepticAMR::writeCheckpointFile() const
 }
 //-----------------------------------------------------------------------
 
+//-----------------------------------------------------------------------
+void LepticAMR::runInSituAnalyses() const
+{
+    CH_TIME("LepticAMR::runInSituAnalyses");
+
+    Vector<InSituLevelView> views;
+
+    for (int a = 0; a < m_inSituAnalyses.size(); ++a) {
+        InSituAnalysis& analysis = *m_inSituAnalyses[a];
+        if (analysis.interval() <= 0) continue;
+        if (m_cur_step % analysis.interval() != 0) continue;
+
+        // Only gather the views if something is due.
+        if (views.size() == 0) {
+            views.resize(m_finest_level + 1);
+            for (int level = 0; level <= m_finest_level; ++level) {
+                m_amrlevels[level]->getInSituView(views[level]);
+            }
+        }
+
+        analysis.analyze(m_cur_step, m_cur_time, views);
+    }
+}
+//-----------------------------------------------------------------------
+
 //-----------------------------------------------------------------------
 void LepticAMR::verbosity(int a_verbosity)
 {
@@ -1841,6 +2224,15 @@ Timer* LepticAMR::timer(Timer* a_timer )
 #endif
 //-----------------------------------------------------------------------
 
+//-----------------------------------------------------------------------
+void
+LepticAMR::addInSituAnalysis(RefCountedPtr<InSituAnalysis> a_analysis)
+{
+    CH_assert(!a_analysis.isNull());
+    m_inSituAnalyses.push_back(a_analysis);
+}
+//-----------------------------------------------------------------------
+
 //-----------------------------------------------------------------------
 void
 LepticAMR::schedule(RefCountedPtr<Scheduler> a_scheduler)
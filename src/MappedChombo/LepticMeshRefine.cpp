@@ -8,6 +8,8 @@
 // Default constructor -- leaves object in an unusable state
 // -----------------------------------------------------------------------------
 LepticMeshRefine::LepticMeshRefine ()
+: m_distributedClustering(false),
+  m_columnBlockFactor(0)
 {
     // Do nothing special.
     // The base class default constructors will be called automatically.
@@ -24,6 +26,8 @@ LepticMeshRefine::LepticMeshRefine (const Box&             a_baseDomain,    // L
                                     const int              a_bufferSize,    // Proper nesting buffer amount
                                     const IntVect&         a_maxSize,       // Maximum grid length in any direction -- 0 means no limit.
                                     const IntVect&         a_spanDirs)      // Set to 1 for new boxes to span the dim.
+: m_distributedClustering(false),
+  m_columnBlockFactor(0)
 {
     const ProblemDomain crseDom(a_baseDomain);
 
@@ -47,6 +51,8 @@ LepticMeshRefine::LepticMeshRefine (const ProblemDomain&   a_baseDomain,    // L
                                     const int              a_bufferSize,    // Proper nesting buffer amount
                                     const IntVect&         a_maxSize,       // Maximum grid length in any direction -- 0 means no limit.
                                     const IntVect&         a_spanDirs)      // Set to 1 for new boxes to span the dim.
+: m_distributedClustering(false),
+  m_columnBlockFactor(0)
 {
     this->define(a_baseDomain,
                  a_refRatios,
@@ -239,10 +245,11 @@ int LepticMeshRefine::regrid (Vector<Vector<Box> >&       a_newmeshes,  // new s
         //
         // Generate new meshes if requested.
         if ( TopLevel+1 > a_baseLevel ) {
+            const int horizBF = (m_columnBlockFactor > 0)? m_columnBlockFactor: m_blockFactor;
             IntVect vectBF;
-            D_TERM(vectBF[0] = (m_spanDirs[0] == 1)? 1: m_blockFactor;,
-                   vectBF[1] = (m_spanDirs[1] == 1)? 1: m_blockFactor;,
-                   vectBF[2] = (m_spanDirs[2] == 1)? 1: m_blockFactor;)
+            D_TERM(vectBF[0] = (m_spanDirs[0] == 1)? 1: horizBF;,
+                   vectBF[1] = (m_spanDirs[1] == 1)? 1: horizBF;,
+                   vectBF[2] = (m_spanDirs[2] == 1)? 1: horizBF;)
 
             Box domaint = m_vectDomains[a_baseLevel].domainBox();
             Box testdom = coarsen(domaint, vectBF);
@@ -354,6 +361,10 @@ coarsen(modifiedTags[level], m_level_blockfactors[level]);
                 modifiedTags[lvl] &= m_pnds[lvl] ;
             }
 
+            // Make fast copies of the PNDs for properlyNested.
+            m_rlePnds.resize(m_pnds.size());
+            this->makePNDs(m_rlePnds, a_baseLevel, TopLevel, OldBaseMesh);
+
             //
             // Generate new meshes.
             //
@@ -369,12 +380,16 @@ coarsen(modifiedTags[level], m_level_blockfactors[level]);
             for ( int lvl = TopLevel ; lvl >= a_baseLevel ; lvl-- ) {
                 // make a new mesh at the same level as the tags
 
+                // In distributed mode, each rank keeps its own tags and
+                // takes every numProc()-th nesting box below.
+                const bool isDistributed = (m_distributedClustering && numProc() > 1);
+
                 const int dest_proc = uniqueProc(SerialTask::compute);
 
                 Vector<IntVectSet> all_tags;
-                gather(all_tags, modifiedTags[lvl], dest_proc);
+                if (!isDistributed) gather(all_tags, modifiedTags[lvl], dest_proc);
 
-                if (procID() == dest_proc) {
+                if (!isDistributed && procID() == dest_proc) {
                     for (int i = 0; i < all_tags.size(); ++i) {
                         //                     modifiedTags[lvl] |= all_tags[i];
                         //**FIXME -- revert to above line when IVS is fixed.
@@ -391,7 +406,7 @@ coarsen(modifiedTags[level], m_level_blockfactors[level]);
                     }
                 }
 
-                broadcast( modifiedTags[lvl] , dest_proc);
+                if (!isDistributed) broadcast( modifiedTags[lvl] , dest_proc);
 
                 // Move this union _after_ the above gather/broadcast to
                 // reduce memory -- shouldn't have other effects. (BVS,NDK 6/30/2008)
@@ -410,6 +425,7 @@ coarsen(modifiedTags[level], m_level_blockfactors[level]);
                     ShiftIterator shiftIt = lvldomain.shiftIterator();
                     IntVect shiftMult(domainBox.size());
                     for (int i=0; i<lvlboxes.size(); i++) {
+                        if (isDistributed && i % numProc() != procID()) continue;
                         Box localBox(lvlboxes[i]);
                         // will handle periodic wraparound through shifting and
                         // adding shifted image to tags, which will all remain
@@ -434,6 +450,7 @@ coarsen(modifiedTags[level], m_level_blockfactors[level]);
                 } else {
                     // non periodic case is simple
                     for ( int i = 0 ; i < lvlboxes.size() ; i++ ) {
+                        if (isDistributed && i % numProc() != procID()) continue;
                         modifiedTags[lvl] |= lvlboxes[i] ;
                     }
                 }
@@ -442,8 +459,13 @@ coarsen(modifiedTags[level], m_level_blockfactors[level]);
                 // which will result in satisfying the maxSize restriction when
                 // everything is refined up to the new level
                 const IntVect maxBoxSizeLevel = m_maxSize/(m_level_blockfactors[lvl]*m_nRefVect[lvl]);
-                this->makeBoxes(lvlboxes, modifiedTags[lvl], m_pnds[lvl],
-                                lvldomain, maxBoxSizeLevel, totalBufferSize[lvl]);
+                if (isDistributed) {
+                    this->makeBoxesDistributed(lvlboxes, modifiedTags[lvl], m_pnds[lvl],
+                                               lvldomain, maxBoxSizeLevel, totalBufferSize[lvl]);
+                } else {
+                    this->makeBoxes(lvlboxes, modifiedTags[lvl], m_pnds[lvl],
+                                    lvldomain, maxBoxSizeLevel, totalBufferSize[lvl]);
+                }
 
                 // This ensures the m_spanDirs requirements.
                 for (int d = 0; d < SpaceDim; ++d) {
@@ -494,6 +516,7 @@ coarsen(modifiedTags[level], m_level_blockfactors[level]);
                     }
                 }
             } // end loop over levels
+            m_rlePnds.resize(0);
         } // end if TopLevel+1 > baseLevel
 
         //
@@ -1063,6 +1086,269 @@ void LepticMeshRefine::makeBoxesParallel (std::list<Box>&      a_mesh,
 } //end of makeBoxesParallel
 
 
+#ifdef CH_MPI
+// -----------------------------------------------------------------------------
+// Sends a list of clusters (boxes and their tag counts) to a_dest.
+// -----------------------------------------------------------------------------
+static void sendClusters (const Vector<Box>&            a_boxes,
+                          const std::vector<long long>& a_numTags,
+                          const int                     a_dest,
+                          const int                     a_tag)
+{
+    const int boxSize = 2 * CH_SPACEDIM;
+    int numBoxes = a_boxes.size();
+    std::vector<int> buffer(numBoxes * boxSize);
+
+    for (int i = 0; i < numBoxes; ++i) {
+        for (int dir = 0; dir < CH_SPACEDIM; ++dir) {
+            buffer[i*boxSize + 2*dir    ] = a_boxes[i].smallEnd(dir);
+            buffer[i*boxSize + 2*dir + 1] = a_boxes[i].bigEnd(dir);
+        }
+    }
+
+    MPI_Send(&numBoxes, 1, MPI_INT, a_dest, a_tag, Chombo_MPI::comm);
+    if (numBoxes > 0) {
+        MPI_Send(&buffer[0], numBoxes * boxSize, MPI_INT,
+                 a_dest, a_tag, Chombo_MPI::comm);
+        MPI_Send((void*)&a_numTags[0], numBoxes, MPI_LONG_LONG,
+                 a_dest, a_tag, Chombo_MPI::comm);
+    }
+}
+
+
+// -----------------------------------------------------------------------------
+// Receives a list of clusters sent by sendClusters.
+// -----------------------------------------------------------------------------
+static void receiveClusters (Vector<Box>&            a_boxes,
+                             std::vector<long long>& a_numTags,
+                             const int               a_source,
+                             const int               a_tag)
+{
+    const int boxSize = 2 * CH_SPACEDIM;
+    MPI_Status status;
+    int numBoxes = 0;
+
+    MPI_Recv(&numBoxes, 1, MPI_INT, a_source, a_tag, Chombo_MPI::comm, &status);
+
+    a_boxes.resize(numBoxes);
+    a_numTags.resize(numBoxes);
+    if (numBoxes == 0) return;
+
+    std::vector<int> buffer(numBoxes * boxSize);
+    MPI_Recv(&buffer[0], numBoxes * boxSize, MPI_INT,
+             a_source, a_tag, Chombo_MPI::comm, &status);
+    MPI_Recv(&a_numTags[0], numBoxes, MPI_LONG_LONG,
+             a_source, a_tag, Chombo_MPI::comm, &status);
+
+    for (int i = 0; i < numBoxes; ++i) {
+        IntVect lo, hi;
+        for (int dir = 0; dir < CH_SPACEDIM; ++dir) {
+            lo[dir] = buffer[i*boxSize + 2*dir    ];
+            hi[dir] = buffer[i*boxSize + 2*dir + 1];
+        }
+        a_boxes[i] = Box(lo, hi);
+    }
+}
+#endif
+
+
+// -----------------------------------------------------------------------------
+// Does the same thing as makeBoxes, but a_localTags only holds this rank's
+// tags. Each rank clusters its tags, then the boxes are merged up a
+// binary reduction tree and broadcast. Tags are never communicated.
+// -----------------------------------------------------------------------------
+void LepticMeshRefine::makeBoxesDistributed (Vector<Box>&         a_mesh,
+                                             const IntVectSet&    a_localTags,
+                                             const IntVectSet&    a_pnd,
+                                             const ProblemDomain& a_domain,
+                                             const IntVect&       a_maxBoxSize,
+                                             const IntVect&       a_totalBufferSize) const
+{
+    CH_TIME("LepticMeshRefine::makeBoxesDistributed");
+
+    // Cluster the local tags with the serial algorithm.
+    Vector<Box> boxes;
+    std::vector<long long> numTags;
+    {
+        IntVectSet tags(a_localTags); // makeBoxes consumes its tags.
+        std::list<Box> localMesh;
+        this->makeBoxes(localMesh, tags, a_pnd, a_domain,
+                        a_maxBoxSize, 0, a_totalBufferSize);
+
+        // Start from an empty list so that overlaps with clusters that were
+        // split by maxBoxSize are handled the same way as remote ones.
+        Vector<Box> localBoxes;
+        std::vector<long long> localNumTags;
+        std::list<Box>::const_iterator it;
+        for (it = localMesh.begin(); it != localMesh.end(); ++it) {
+            IntVectSet boxTags(a_localTags);
+            boxTags &= *it;
+            localBoxes.push_back(*it);
+            localNumTags.push_back(boxTags.numPts());
+        }
+
+        this->mergeClusters(boxes, numTags, localBoxes, localNumTags,
+                            a_pnd, a_domain, a_totalBufferSize);
+    }
+
+#ifdef CH_MPI
+    // Merge the clusters up a binary tree. Rank 0 ends up with everything.
+    {
+        CH_TIME("reduction");
+
+        const int rank = procID();
+        const int nProc = numProc();
+        const int mpiTag = 4831;
+
+        for (int stride = 1; stride < nProc; stride *= 2) {
+            if (rank % (2*stride) == stride) {
+                sendClusters(boxes, numTags, rank - stride, mpiTag);
+                break;
+            }
+
+            if (rank + stride < nProc) {
+                Vector<Box> remoteBoxes;
+                std::vector<long long> remoteNumTags;
+                receiveClusters(remoteBoxes, remoteNumTags, rank + stride, mpiTag);
+
+                this->mergeClusters(boxes, numTags, remoteBoxes, remoteNumTags,
+                                    a_pnd, a_domain, a_totalBufferSize);
+            }
+        }
+    }
+
+    broadcast(boxes, 0);
+#endif
+
+    // Merged clusters may have outgrown the max box size.
+    std::list<Box> mesh;
+    for (int i = 0; i < boxes.size(); ++i) {
+        mesh.push_back(boxes[i]);
+    }
+    if (a_maxBoxSize.sum() > 0) {
+        for (std::list<Box>::iterator it = mesh.begin(); it != mesh.end(); ++it) {
+            this->splitBox(mesh, it, a_maxBoxSize);
+        }
+    }
+
+    a_mesh.resize(mesh.size());
+    std::list<Box>::iterator it = mesh.begin();
+    for (int i = 0; i < a_mesh.size(); ++i, ++it) a_mesh[i] = *it;
+}
+
+
+// -----------------------------------------------------------------------------
+// Adds the a_newBoxes clusters to a_boxes. A new cluster is merged with
+// the clusters it touches as long as the merged box stays efficient and
+// properly nested. Whatever overlap remains is cut from the new cluster,
+// so a_boxes stays disjoint. a_numTags holds the tag count of each box.
+// -----------------------------------------------------------------------------
+void LepticMeshRefine::mergeClusters (Vector<Box>&                  a_boxes,
+                                      std::vector<long long>&       a_numTags,
+                                      const Vector<Box>&            a_newBoxes,
+                                      const std::vector<long long>& a_newNumTags,
+                                      const IntVectSet&             a_pnd,
+                                      const ProblemDomain&          a_domain,
+                                      const IntVect&                a_totalBufferSize) const
+{
+    CH_TIME("LepticMeshRefine::mergeClusters");
+    CH_assert(a_boxes.size() == int(a_numTags.size()));
+    CH_assert(a_newBoxes.size() == int(a_newNumTags.size()));
+
+    for (int n = 0; n < a_newBoxes.size(); ++n) {
+        Box newBox = a_newBoxes[n];
+        long long newNumTags = a_newNumTags[n];
+
+        // Grow the new cluster into its neighbors for as long as we can.
+        bool didMerge = true;
+        while (didMerge) {
+            didMerge = false;
+            const Box touchBox = grow(newBox, 1);
+
+            for (int i = 0; i < a_boxes.size(); ++i) {
+                if (!touchBox.intersects(a_boxes[i])) continue;
+
+                Box candidate = newBox;
+                candidate.minBox(a_boxes[i]);
+
+                // The candidate absorbs whatever it covers, but it may not
+                // partially overlap any other cluster.
+                long long candNumTags = newNumTags;
+                bool isClean = true;
+                for (int j = 0; j < a_boxes.size(); ++j) {
+                    if (!candidate.intersects(a_boxes[j])) continue;
+                    if (!candidate.contains(a_boxes[j])) {
+                        isClean = false;
+                        break;
+                    }
+                    candNumTags += a_numTags[j];
+                }
+                if (!isClean) continue;
+
+                if (Real(candNumTags) < Real(candidate.numPts()) * m_fillRatio) continue;
+                if (!properlyNested(candidate, a_domain, a_pnd, a_totalBufferSize)) continue;
+
+                // Accept the merge.
+                int k = 0;
+                for (int j = 0; j < a_boxes.size(); ++j) {
+                    if (candidate.contains(a_boxes[j])) continue;
+                    a_boxes[k] = a_boxes[j];
+                    a_numTags[k] = a_numTags[j];
+                    ++k;
+                }
+                a_boxes.resize(k);
+                a_numTags.resize(k);
+
+                newBox = candidate;
+                newNumTags = candNumTags;
+                didMerge = true;
+                break;
+            }
+        }
+
+        // Cut away any overlap that could not be merged. The pieces are
+        // inside newBox, so they are still properly nested.
+        IntVectSet remainder(newBox);
+        bool hasOverlap = false;
+        for (int i = 0; i < a_boxes.size(); ++i) {
+            if (!newBox.intersects(a_boxes[i])) continue;
+            remainder -= a_boxes[i];
+            hasOverlap = true;
+        }
+
+        if (!hasOverlap) {
+            a_boxes.push_back(newBox);
+            a_numTags.push_back(newNumTags);
+        } else if (!remainder.isEmpty()) {
+            // We no longer know where the tags are, so split the count
+            // between the pieces by volume.
+            const Vector<Box> pieces = remainder.boxes();
+            const Real tagsPerCell = Real(newNumTags) / Real(newBox.numPts());
+            for (int p = 0; p < pieces.size(); ++p) {
+                a_boxes.push_back(pieces[p]);
+                a_numTags.push_back((long long)(tagsPerCell * Real(pieces[p].numPts())));
+            }
+        }
+    }
+}
+
+
+// -----------------------------------------------------------------------------
+// Returns the run-length copy of a_pnd if a_pnd is one of m_pnds and
+// regrid made a copy. Otherwise, returns NULL.
+// -----------------------------------------------------------------------------
+const RunLengthIntVectSet* LepticMeshRefine::findRunLengthPND (const IntVectSet& a_pnd) const
+{
+    for (int lvl = 0; lvl < m_rlePnds.size(); ++lvl) {
+        if (&a_pnd == &m_pnds[lvl]) {
+            if (m_rlePnds[lvl].isEmpty()) return NULL;
+            return &m_rlePnds[lvl];
+        }
+    }
+    return NULL;
+}
+
+
 // -----------------------------------------------------------------------------
 // Simply checks if a_pnd contains points that are properly nested in a_box.
 // -----------------------------------------------------------------------------
@@ -1075,10 +1361,16 @@ bool LepticMeshRefine::properlyNested (const Box&           a_box,
         MayDay::Error("LepticMeshRefine::properlyNested: m_PNDMode should not be zero");
         return a_pnd.contains(a_box);
     } else {
+        const RunLengthIntVectSet* rlePndPtr = this->findRunLengthPND(a_pnd);
+
         Box growBox(a_box);
         growBox.grow(a_totalBufferSize);
         growBox &= a_domain.domainBox();
-        if (!a_pnd.contains(growBox)) return false; //typical case
+        if (rlePndPtr != NULL) {
+            if (!rlePndPtr->contains(growBox)) return false; //typical case
+        } else {
+            if (!a_pnd.contains(growBox)) return false; //typical case
+        }
         if (a_domain.isPeriodic()) {
             Box growPeriodic(a_box);
             growPeriodic.grow(a_totalBufferSize);
@@ -1098,7 +1390,10 @@ bool LepticMeshRefine::properlyNested (const Box&           a_box,
                 images.checkDefine(a_domain);
                 for (images.begin(growPeriodic); images.ok(); ++images) {
                     if (!images.box().isEmpty()) {
-                        if (!a_pnd.contains(images.box())) {
+                        const bool isContained = (rlePndPtr != NULL)?
+                                                 rlePndPtr->contains(images.box()):
+                                                 a_pnd.contains(images.box());
+                        if (!isContained) {
                             return false;
                         }
                     }
@@ -1237,14 +1532,23 @@ void LepticMeshRefine::splitBox (std::list<Box>&                 a_boxes,
 // grids which will be generated.  If m_BlockFactor is less than the refinement
 // ratio between levels (lvl) and (lvl+1), then no coarsening needs to be done
 // so we default to one, in that case.
+//
+// If m_columnBlockFactor is set and some directions are spanned, the boxes
+// are blocked by m_columnBlockFactor in the other directions instead. The
+// spanned directions are not blocked since the boxes fill them anyway.
 // -----------------------------------------------------------------------------
 void LepticMeshRefine::computeLocalBlockFactors ()
 {
+    IntVect blockFactor = m_blockFactor * IntVect::Unit;
+    if (m_columnBlockFactor > 0 && m_spanDirs.sum() > 0) {
+        blockFactor = m_columnBlockFactor * (IntVect::Unit - m_spanDirs) + m_spanDirs;
+    }
+
     for (int lev = 0; lev < (m_level_blockfactors.size()); ++lev) {
-        // This is simply ceil(m_blockFactor / m_nRefVect[lev]).
+        // This is simply ceil(blockFactor / m_nRefVect[lev]).
         m_level_blockfactors[lev] =
             (  m_nRefVect[lev]
-             + IntVect(D_DECL(m_blockFactor-1,m_blockFactor-1,m_blockFactor-1))  )
+             + blockFactor - IntVect::Unit  )
             / m_nRefVect[lev];
 
         // for (int dir = 0; dir < SpaceDim; ++dir) {
@@ -1260,7 +1564,7 @@ void LepticMeshRefine::computeLocalBlockFactors ()
                 pout() << "Unable to implement blocking for level " << lev + 1 << ".  "
                        "Blocking requires ceil(blockFactor/nRef) to be a power of 2 but "
                        "for nRef[" << lev << "] = " << m_nRefVect[lev]
-                       << " and blockFactor = " << m_blockFactor << ", this is "
+                       << " and blockFactor = " << blockFactor << ", this is "
                        << m_level_blockfactors[lev] << '.' << endl;
                 MayDay::Error("aborting LepticMeshRefine::regrid");
             }
@@ -1447,6 +1751,38 @@ void LepticMeshRefine::makePNDs (Vector<IntVectSet>&          a_pnds,
 }
 
 
+// -----------------------------------------------------------------------------
+// Computes run-length copies of the proper nesting domains for
+// properlyNested. The PNDs are refined exactly as in the IntVectSet
+// version, but a_rlePnds is built from a_baseMesh's boxes directly.
+// -----------------------------------------------------------------------------
+void LepticMeshRefine::makePNDs (Vector<RunLengthIntVectSet>& a_rlePnds,
+                                 const int                    a_baseLevel,
+                                 const int                    a_topLevel,
+                                 const Vector<Box>&           a_baseMesh) const
+{
+    CH_TIME("LepticMeshRefine::makePNDs (run-length)");
+    CH_assert( a_baseLevel <= a_topLevel && a_baseLevel >= 0 );
+    CH_assert( a_rlePnds.size() >= a_topLevel + 1 );
+
+    RunLengthIntVectSet& basePnd = a_rlePnds[a_baseLevel];
+    basePnd.clear();
+    for (int box = 0; box < a_baseMesh.size(); ++box) {
+        basePnd |= a_baseMesh[box];
+    }
+
+    for ( int lvl = a_baseLevel ; lvl < a_topLevel ; lvl++) {
+        // Same as the IntVectSet version.
+        IntVect allInOne_nRef = m_nRefVect[lvl];
+        allInOne_nRef *= m_level_blockfactors[lvl];
+        allInOne_nRef /= m_level_blockfactors[lvl + 1];
+
+        a_rlePnds[lvl + 1] = a_rlePnds[lvl];
+        a_rlePnds[lvl + 1].refine(allInOne_nRef);
+    }
+}
+
+
 // -----------------------------------------------------------------------------
 // Static utility
 // Recursive function to enforce max size of boxes in a given direction.
@@ -8,6 +8,7 @@ using std::endl;
 #include "Vector.H"
 #include "LayoutIterator.H"
 #include "parstream.H"
+#include "MayDay.H"
 
 #include "MappedAMRLevel.H"
 
@@ -37,6 +38,7 @@ MappedAMRLevel::MappedAMRLevel()
     m_time = 0;
     m_dt = 0;
     m_initial_dt_multiplier = 0.1;
+    m_cell_budget = 0.0;
 }
 //-----------------------------------------------------------------------
 
@@ -165,6 +167,20 @@ Real MappedAMRLevel::initialDtMultiplier() const
 }
 //-----------------------------------------------------------------------
 
+//-----------------------------------------------------------------------
+void MappedAMRLevel::cellBudget(Real a_max_cells)
+{
+    m_cell_budget = a_max_cells;
+}
+//-----------------------------------------------------------------------
+
+//-----------------------------------------------------------------------
+Real MappedAMRLevel::cellBudget() const
+{
+    return m_cell_budget;
+}
+//-----------------------------------------------------------------------
+
 //-----------------------------------------------------------------------
 // static
 void MappedAMRLevel::verbosity(int a_verbosity)
@@ -181,6 +197,15 @@ int MappedAMRLevel::verbosity()
 }
 //-----------------------------------------------------------------------
 
+//-----------------------------------------------------------------------
+void MappedAMRLevel::pruneTags(IntVectSet& a_tags, long long a_maxTags)
+{
+    if (s_verbosity >= 3) {
+        pout() << "MappedAMRLevel::pruneTags" << endl;
+    }
+}
+//-----------------------------------------------------------------------
+
 //-----------------------------------------------------------------------
 void MappedAMRLevel::preRegrid(int a_base_level, const Vector<Vector<Box> >& a_new_grids)
 {
@@ -229,6 +254,53 @@ Vector<MappedAMRLevel*> MappedAMRLevel::getAMRLevelHierarchy()
 }
 //-----------------------------------------------------------------------
 
+#ifdef CH_USE_HDF5
+//-----------------------------------------------------------------------
+void
+MappedAMRLevel::getPlotHeader(HDF5HeaderData& a_header) const
+{
+    MayDay::Error("MappedAMRLevel::getPlotHeader not implemented by this physics class");
+}
+//-----------------------------------------------------------------------
+
+//-----------------------------------------------------------------------
+void
+MappedAMRLevel::getPlotLevel(HDF5HeaderData&       a_header,
+                             LevelData<FArrayBox>& a_plotData) const
+{
+    MayDay::Error("MappedAMRLevel::getPlotLevel not implemented by this physics class");
+}
+//-----------------------------------------------------------------------
+
+//-----------------------------------------------------------------------
+void
+MappedAMRLevel::getThumbnail(HDF5HeaderData&       a_header,
+                             LevelData<FArrayBox>& a_thumbData,
+                             const IntVect&        a_coarsening) const
+{
+    MayDay::Error("MappedAMRLevel::getThumbnail not implemented by this physics class");
+}
+//-----------------------------------------------------------------------
+
+//-----------------------------------------------------------------------
+void
+MappedAMRLevel::getCheckpointHeader(HDF5HeaderData& a_header) const
+{
+    MayDay::Error("MappedAMRLevel::getCheckpointHeader not implemented by this physics class");
+}
+//-----------------------------------------------------------------------
+
+//-----------------------------------------------------------------------
+void
+MappedAMRLevel::getCheckpointLevel(HDF5HeaderData&                      a_header,
+                                   Vector<std::string>&                 a_names,
+                                   Vector<const LevelData<FArrayBox>*>& a_data) const
+{
+    MayDay::Error("MappedAMRLevel::getCheckpointLevel not implemented by this physics class");
+}
+//-----------------------------------------------------------------------
+#endif
+
 //-----------------------------------------------------------------------
 void
 MappedAMRLevel::writeCustomPlotFile(const std::string& a_prefix,
@@ -238,6 +310,27 @@ MappedAMRLevel::writeCustomPlotFile(const std::string& a_prefix,
 }
 //-----------------------------------------------------------------------
 
+//-----------------------------------------------------------------------
+void
+MappedAMRLevel::writeProbes(int  a_step,
+                            Real a_time) const
+{
+    // By default, this does nothing.
+}
+//-----------------------------------------------------------------------
+
+//-----------------------------------------------------------------------
+void
+MappedAMRLevel::getInSituView(InSituLevelView& a_view) const
+{
+    a_view = InSituLevelView();
+    a_view.level    = m_level;
+    a_view.time     = m_time;
+    a_view.dt       = m_dt;
+    a_view.refRatio = m_ref_ratio;
+}
+//-----------------------------------------------------------------------
+
 //-----------------------------------------------------------------------
 void
 MappedAMRLevel::conclude(int a_step) const
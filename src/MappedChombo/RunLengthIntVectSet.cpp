@@ -0,0 +1,446 @@
+/*******************************************************************************
+ *  SOMAR - Stratified Ocean Model with Adaptive Refinement
+ *  Developed by Ed Santilli & Alberto Scotti
+ *  Copyright (C) 2014 University of North Carolina at Chapel Hill
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301
+ *  USA
+ *
+ *  For up-to-date contact information, please visit the repository homepage,
+ *  https://github.com/somarhub.
+ ******************************************************************************/
+#include "RunLengthIntVectSet.H"
+#include "BoxIterator.H"
+#include "CH_Timer.H"
+#include <algorithm>
+
+
+// -----------------------------------------------------------------------------
+// Integer division with rounding downwards.
+// -----------------------------------------------------------------------------
+static inline int floorDiv (const int a_num, const int a_den)
+{
+    return (a_num >= 0)? a_num / a_den: -((-a_num + a_den - 1) / a_den);
+}
+
+
+// -----------------------------------------------------------------------------
+// Used to binary search the runs of a line by their upper end.
+// -----------------------------------------------------------------------------
+static inline bool runHiLT (const RunLengthIntVectSet::Run& a_run, const int a_i)
+{
+    return a_run.second < a_i;
+}
+
+
+// -----------------------------------------------------------------------------
+// Returns the box of line keys covered by a_box.
+// -----------------------------------------------------------------------------
+static inline Box lineKeyBox (const Box& a_box)
+{
+    IntVect lo = a_box.smallEnd();
+    IntVect hi = a_box.bigEnd();
+    lo[0] = 0;
+    hi[0] = 0;
+    return Box(lo, hi);
+}
+
+
+// -----------------------------------------------------------------------------
+// Creates a set that holds the same cells as a_ivs.
+// -----------------------------------------------------------------------------
+RunLengthIntVectSet::RunLengthIntVectSet (const IntVectSet& a_ivs)
+{
+    this->define(a_ivs);
+}
+
+
+// -----------------------------------------------------------------------------
+// Creates a set that holds the cells of a_box.
+// -----------------------------------------------------------------------------
+RunLengthIntVectSet::RunLengthIntVectSet (const Box& a_box)
+{
+    *this |= a_box;
+}
+
+
+// -----------------------------------------------------------------------------
+// Replaces this set with the cells of a_ivs.
+// -----------------------------------------------------------------------------
+void RunLengthIntVectSet::define (const IntVectSet& a_ivs)
+{
+    CH_TIME("RunLengthIntVectSet::define");
+
+    m_lines.clear();
+
+    const Vector<Box> ivsBoxes = a_ivs.boxes();
+    for (int b = 0; b < ivsBoxes.size(); ++b) {
+        *this |= ivsBoxes[b];
+    }
+}
+
+
+// -----------------------------------------------------------------------------
+// Empties the set.
+// -----------------------------------------------------------------------------
+void RunLengthIntVectSet::clear ()
+{
+    m_lines.clear();
+}
+
+
+// -----------------------------------------------------------------------------
+// Adds the cells of a_box.
+// -----------------------------------------------------------------------------
+RunLengthIntVectSet& RunLengthIntVectSet::operator|= (const Box& a_box)
+{
+    if (a_box.isEmpty()) return *this;
+    CH_assert(a_box.type() == IntVect::Zero);
+
+    const int lo = a_box.smallEnd(0);
+    const int hi = a_box.bigEnd(0);
+
+    BoxIterator bit(lineKeyBox(a_box));
+    for (bit.reset(); bit.ok(); ++bit) {
+        addRun(m_lines[bit()], lo, hi);
+    }
+
+    return *this;
+}
+
+
+// -----------------------------------------------------------------------------
+// Adds the cells of another set.
+// -----------------------------------------------------------------------------
+RunLengthIntVectSet& RunLengthIntVectSet::operator|= (const RunLengthIntVectSet& a_src)
+{
+    LineMap::const_iterator it;
+    for (it = a_src.m_lines.begin(); it != a_src.m_lines.end(); ++it) {
+        addRuns(m_lines[it->first], it->second);
+    }
+
+    return *this;
+}
+
+
+// -----------------------------------------------------------------------------
+// Is a_iv in the set?
+// -----------------------------------------------------------------------------
+bool RunLengthIntVectSet::contains (const IntVect& a_iv) const
+{
+    LineMap::const_iterator it = m_lines.find(lineKey(a_iv));
+    if (it == m_lines.end()) return false;
+
+    return (findRun(it->second, a_iv[0]) != it->second.end());
+}
+
+
+// -----------------------------------------------------------------------------
+// Is every cell of a_box in the set?
+// -----------------------------------------------------------------------------
+bool RunLengthIntVectSet::contains (const Box& a_box) const
+{
+    if (a_box.isEmpty()) return true;
+
+    const int lo = a_box.smallEnd(0);
+    const int hi = a_box.bigEnd(0);
+
+    BoxIterator bit(lineKeyBox(a_box));
+    for (bit.reset(); bit.ok(); ++bit) {
+        LineMap::const_iterator it = m_lines.find(bit());
+        if (it == m_lines.end()) return false;
+
+        // Runs do not touch, so one run must hold the whole range.
+        RunList::const_iterator run = findRun(it->second, lo);
+        if (run == it->second.end()) return false;
+        if (run->second < hi) return false;
+    }
+
+    return true;
+}
+
+
+// -----------------------------------------------------------------------------
+// Grows the set by a_numCells in each direction, like IntVectSet::grow.
+// -----------------------------------------------------------------------------
+void RunLengthIntVectSet::grow (const IntVect& a_numCells)
+{
+    CH_TIME("RunLengthIntVectSet::grow");
+    CH_assert(a_numCells >= IntVect::Zero);
+
+    // Along the runs, this is just a matter of widening each run.
+    if (a_numCells[0] > 0) {
+        const int g = a_numCells[0];
+        LineMap::iterator it;
+        for (it = m_lines.begin(); it != m_lines.end(); ++it) {
+            RunList oldRuns;
+            oldRuns.swap(it->second);
+            for (unsigned int r = 0; r < oldRuns.size(); ++r) {
+                addRun(it->second, oldRuns[r].first - g, oldRuns[r].second + g);
+            }
+        }
+    }
+
+    // Across the runs, each line is copied to its neighbors.
+    for (int dir = 1; dir < SpaceDim; ++dir) {
+        const int g = a_numCells[dir];
+        if (g == 0) continue;
+
+        LineMap newLines;
+        LineMap::const_iterator it;
+        for (it = m_lines.begin(); it != m_lines.end(); ++it) {
+            IntVect key = it->first;
+            for (int s = -g; s <= g; ++s) {
+                key[dir] = it->first[dir] + s;
+                addRuns(newLines[key], it->second);
+            }
+        }
+        m_lines.swap(newLines);
+    }
+}
+
+
+// -----------------------------------------------------------------------------
+// Coarsens the set. A coarse cell is in the set if any of its fine cells are.
+// -----------------------------------------------------------------------------
+void RunLengthIntVectSet::coarsen (const IntVect& a_refRatio)
+{
+    CH_TIME("RunLengthIntVectSet::coarsen");
+    CH_assert(a_refRatio >= IntVect::Unit);
+
+    if (a_refRatio == IntVect::Unit) return;
+
+    const int r = a_refRatio[0];
+    LineMap newLines;
+    LineMap::const_iterator it;
+    for (it = m_lines.begin(); it != m_lines.end(); ++it) {
+        IntVect key = it->first;
+        key.coarsen(a_refRatio);
+
+        RunList& newRuns = newLines[key];
+        for (unsigned int n = 0; n < it->second.size(); ++n) {
+            addRun(newRuns, floorDiv(it->second[n].first, r), floorDiv(it->second[n].second, r));
+        }
+    }
+    m_lines.swap(newLines);
+}
+
+
+// -----------------------------------------------------------------------------
+// Refines the set.
+// -----------------------------------------------------------------------------
+void RunLengthIntVectSet::refine (const IntVect& a_refRatio)
+{
+    CH_TIME("RunLengthIntVectSet::refine");
+    CH_assert(a_refRatio >= IntVect::Unit);
+
+    if (a_refRatio == IntVect::Unit) return;
+
+    const int r = a_refRatio[0];
+
+    // The fine lines that refine a single coarse line.
+    IntVect offsetHi = a_refRatio - IntVect::Unit;
+    offsetHi[0] = 0;
+    const Box offsetBox(IntVect::Zero, offsetHi);
+    BoxIterator bit(offsetBox);
+
+    LineMap newLines;
+    LineMap::const_iterator it;
+    for (it = m_lines.begin(); it != m_lines.end(); ++it) {
+        RunList fineRuns(it->second.size());
+        for (unsigned int n = 0; n < it->second.size(); ++n) {
+            fineRuns[n].first = it->second[n].first * r;
+            fineRuns[n].second = it->second[n].second * r + r - 1;
+        }
+
+        const IntVect fineKey = it->first * a_refRatio;
+        for (bit.reset(); bit.ok(); ++bit) {
+            newLines[fineKey + bit()] = fineRuns;
+        }
+    }
+    m_lines.swap(newLines);
+}
+
+
+// -----------------------------------------------------------------------------
+// Fills every line in a_dir, from a_lo to a_hi, that holds any cell of
+// the set. This is how vertical tag extrusion works. a_dir must not be 0.
+// -----------------------------------------------------------------------------
+void RunLengthIntVectSet::extrude (const int a_dir,
+                                   const int a_lo,
+                                   const int a_hi)
+{
+    CH_TIME("RunLengthIntVectSet::extrude");
+    CH_assert(0 < a_dir && a_dir < SpaceDim);
+    CH_assert(a_lo <= a_hi);
+
+    // Flatten the set onto a_lo...
+    LineMap flatLines;
+    LineMap::const_iterator it;
+    for (it = m_lines.begin(); it != m_lines.end(); ++it) {
+        IntVect key = it->first;
+        key[a_dir] = a_lo;
+        addRuns(flatLines[key], it->second);
+    }
+
+    // ...then copy the flat lines up to a_hi.
+    m_lines.clear();
+    for (it = flatLines.begin(); it != flatLines.end(); ++it) {
+        IntVect key = it->first;
+        for (int k = a_lo; k <= a_hi; ++k) {
+            key[a_dir] = k;
+            m_lines[key] = it->second;
+        }
+    }
+}
+
+
+// -----------------------------------------------------------------------------
+// Returns the number of cells in the set.
+// -----------------------------------------------------------------------------
+long long RunLengthIntVectSet::numPts () const
+{
+    long long num = 0;
+    LineMap::const_iterator it;
+    for (it = m_lines.begin(); it != m_lines.end(); ++it) {
+        for (unsigned int n = 0; n < it->second.size(); ++n) {
+            num += it->second[n].second - it->second[n].first + 1;
+        }
+    }
+    return num;
+}
+
+
+// -----------------------------------------------------------------------------
+// Returns the smallest box that holds the set.
+// -----------------------------------------------------------------------------
+Box RunLengthIntVectSet::minBox () const
+{
+    Box retBox;
+    LineMap::const_iterator it;
+    for (it = m_lines.begin(); it != m_lines.end(); ++it) {
+        if (it->second.empty()) continue;
+
+        IntVect lo = it->first;
+        IntVect hi = it->first;
+        lo[0] = it->second.front().first;
+        hi[0] = it->second.back().second;
+
+        if (retBox.isEmpty()) {
+            retBox = Box(lo, hi);
+        } else {
+            retBox.minBox(Box(lo, hi));
+        }
+    }
+    return retBox;
+}
+
+
+// -----------------------------------------------------------------------------
+// Returns one box per run.
+// -----------------------------------------------------------------------------
+Vector<Box> RunLengthIntVectSet::boxes () const
+{
+    Vector<Box> retBoxes;
+    LineMap::const_iterator it;
+    for (it = m_lines.begin(); it != m_lines.end(); ++it) {
+        IntVect lo = it->first;
+        IntVect hi = it->first;
+        for (unsigned int n = 0; n < it->second.size(); ++n) {
+            lo[0] = it->second[n].first;
+            hi[0] = it->second[n].second;
+            retBoxes.push_back(Box(lo, hi));
+        }
+    }
+    return retBoxes;
+}
+
+
+// -----------------------------------------------------------------------------
+// Converts to an IntVectSet.
+// -----------------------------------------------------------------------------
+IntVectSet RunLengthIntVectSet::toIntVectSet () const
+{
+    CH_TIME("RunLengthIntVectSet::toIntVectSet");
+
+    IntVectSet ivs;
+    const Vector<Box> runBoxes = this->boxes();
+    for (int b = 0; b < runBoxes.size(); ++b) {
+        ivs |= runBoxes[b];
+    }
+    return ivs;
+}
+
+
+// -----------------------------------------------------------------------------
+// Adds [a_lo, a_hi] to a_runs, merging runs that overlap or touch.
+// -----------------------------------------------------------------------------
+void RunLengthIntVectSet::addRun (RunList& a_runs,
+                                  int      a_lo,
+                                  int      a_hi)
+{
+    CH_assert(a_lo <= a_hi);
+
+    // The first run that ends at or after a_lo - 1 may touch the new run.
+    RunList::iterator first = std::lower_bound(a_runs.begin(), a_runs.end(),
+                                               a_lo - 1, runHiLT);
+
+    // Absorb every run that starts at or before a_hi + 1.
+    RunList::iterator last = first;
+    while (last != a_runs.end() && last->first <= a_hi + 1) {
+        a_lo = Min(a_lo, last->first);
+        a_hi = Max(a_hi, last->second);
+        ++last;
+    }
+
+    if (first == last) {
+        a_runs.insert(first, Run(a_lo, a_hi));
+    } else {
+        first->first = a_lo;
+        first->second = a_hi;
+        a_runs.erase(first + 1, last);
+    }
+}
+
+
+// -----------------------------------------------------------------------------
+// Adds every run of a_src to a_dest.
+// -----------------------------------------------------------------------------
+void RunLengthIntVectSet::addRuns (RunList&       a_dest,
+                                   const RunList& a_src)
+{
+    if (a_dest.empty()) {
+        a_dest = a_src;
+        return;
+    }
+
+    for (unsigned int n = 0; n < a_src.size(); ++n) {
+        addRun(a_dest, a_src[n].first, a_src[n].second);
+    }
+}
+
+
+// -----------------------------------------------------------------------------
+// Returns the run that holds a_i, or a_runs.end().
+// -----------------------------------------------------------------------------
+RunLengthIntVectSet::RunList::const_iterator
+RunLengthIntVectSet::findRun (const RunList& a_runs,
+                              const int      a_i)
+{
+    RunList::const_iterator run = std::lower_bound(a_runs.begin(), a_runs.end(),
+                                                   a_i, runHiLT);
+    if (run == a_runs.end() || run->first > a_i) return a_runs.end();
+    return run;
+}
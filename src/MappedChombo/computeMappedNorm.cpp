@@ -221,12 +221,11 @@ Real computeMappedNorm (const LevelData<FArrayBox>& a_phi,
 // Unmapped FArrayBox versions...
 
 // -----------------------------------------------------------------------------
-// Private function.
-// Performs most of the computation for the norm functions. This version is not
-// public and does not perform MPI communication or the final root.
+// Performs most of the computation for the norm functions. This version does
+// not perform MPI communication or the final root.
 // LIMITATIONS: This function can only handle cell-centered data.
 // -----------------------------------------------------------------------------
-static Real computeLocalUnmappedNormPow (const LevelData<FArrayBox>& a_phi,
+Real computeLocalUnmappedNormPow (const LevelData<FArrayBox>& a_phi,
                                          const DisjointBoxLayout*    a_finerGridsPtr,
                                          const LevelGeometry&        a_levGeo,
                                          const int                   a_p,
@@ -295,15 +294,15 @@ static Real computeLocalUnmappedNormPow (const LevelData<FArrayBox>& a_phi,
 
 
 // -----------------------------------------------------------------------------
-// Returns the norm of phi over an AMR hierarchy.
-// a_levGeo can be any levGeo in the hierarchy.
+// Returns this rank's part of norm^p over an AMR hierarchy. This version does
+// not perform MPI communication or the final root.
 // LIMITATIONS: This function can only handle cell-centered data.
 // -----------------------------------------------------------------------------
-Real computeUnmappedNorm (const Vector<LevelData<FArrayBox>*>& a_phi,
-                          const LevelGeometry&                 a_levGeo,
-                          const int                            a_p,
-                          const int                            a_comp,
-                          const int                            a_lBase)
+Real computeLocalUnmappedNormPow (const Vector<LevelData<FArrayBox>*>& a_phi,
+                                  const LevelGeometry&                 a_levGeo,
+                                  const int                            a_p,
+                                  const int                            a_comp,
+                                  const int                            a_lBase)
 {
     // Sanity check on a_lBase
     const int vectorSize = a_phi.size();
@@ -351,6 +350,27 @@ Real computeUnmappedNorm (const Vector<LevelData<FArrayBox>*>& a_phi,
         }
     }
 
+    return localNormPow;
+}
+
+
+// -----------------------------------------------------------------------------
+// Returns the norm of phi over an AMR hierarchy.
+// a_levGeo can be any levGeo in the hierarchy.
+// LIMITATIONS: This function can only handle cell-centered data.
+// -----------------------------------------------------------------------------
+Real computeUnmappedNorm (const Vector<LevelData<FArrayBox>*>& a_phi,
+                          const LevelGeometry&                 a_levGeo,
+                          const int                            a_p,
+                          const int                            a_comp,
+                          const int                            a_lBase)
+{
+    Real localNormPow = computeLocalUnmappedNormPow(a_phi,
+                                                    a_levGeo,
+                                                    a_p,
+                                                    a_comp,
+                                                    a_lBase);
+
     // Compute global norm (this is where the MPI communication happens)
 #ifdef CH_MPI
     Real globalNorm = 0.0;
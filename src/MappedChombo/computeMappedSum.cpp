@@ -192,15 +192,15 @@ Real computeMappedSum (const Vector<LevelData<FArrayBox>*>& a_phi,
 
 
 // -----------------------------------------------------------------------------
-// Returns the integral of phi over an AMR hierarchy.
-// a_levGeo can be any levGeo in the hierarchy.
+// Returns this rank's part of the integral of phi over an AMR hierarchy.
+// This version does not perform MPI communication.
 // LIMITATIONS: This function can only handle cell-centered data.
 // -----------------------------------------------------------------------------
-Real computeMappedSum (Real&                                a_vol,
-                       const Vector<LevelData<FArrayBox>*>& a_phi,
-                       const LevelGeometry&                 a_levGeo,
-                       const int                            a_comp,
-                       const int                            a_lBase)
+Real computeLocalMappedSum (Real&                                a_vol,
+                            const Vector<LevelData<FArrayBox>*>& a_phi,
+                            const LevelGeometry&                 a_levGeo,
+                            const int                            a_comp,
+                            const int                            a_lBase)
 {
     // Sanity check on a_lBase
     const int vectorSize = a_phi.size();
@@ -243,6 +243,25 @@ Real computeMappedSum (Real&                                a_vol,
                                           a_comp);
     }
 
+    a_vol += localVol;
+    return localSum;
+}
+
+
+// -----------------------------------------------------------------------------
+// Returns the integral of phi over an AMR hierarchy.
+// a_levGeo can be any levGeo in the hierarchy.
+// LIMITATIONS: This function can only handle cell-centered data.
+// -----------------------------------------------------------------------------
+Real computeMappedSum (Real&                                a_vol,
+                       const Vector<LevelData<FArrayBox>*>& a_phi,
+                       const LevelGeometry&                 a_levGeo,
+                       const int                            a_comp,
+                       const int                            a_lBase)
+{
+    Real localVol = 0.0;
+    Real localSum = computeLocalMappedSum(localVol, a_phi, a_levGeo, a_comp, a_lBase);
+
     // Compute global sum (this is where the MPI communication happens)
 #ifdef CH_MPI
     Real globalSum = 0.0;
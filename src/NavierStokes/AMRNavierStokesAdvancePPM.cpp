@@ -93,10 +93,22 @@ void AMRNavierStokes::PPMTimeStep (const Real a_oldTime,
     old_vel.exchange(m_tracingExCopier);
     nanCheck(old_vel);
 
+    // On a moving grid, the advecting velocity is predicted with the metric at
+    // the half time. Everything after that is updated on the new grid.
+    const bool isMovingGrid = LevelGeometry::isTimeDependent();
+    const Real newTime = a_oldTime + a_dt;
+    if (isMovingGrid) {
+        moveMetric(old_vel, a_oldTime + 0.5 * a_dt);
+    }
+
     LevelData<FluxBox> adv_vel(grids, 1, IntVect::Unit); // Changed from m_tracingGhosts to 1
     computeAdvectingVelocities(adv_vel, old_vel, a_oldTime, a_dt);
     nanCheck(adv_vel);
 
+    if (isMovingGrid) {
+        moveMetric(old_vel, newTime);
+    }
+
     if (a_updatePassiveScalars) {
         // Lambda update
         LevelData<FArrayBox> old_lambda;
@@ -106,6 +118,9 @@ void AMRNavierStokes::PPMTimeStep (const Real a_oldTime,
 
         LevelData<FArrayBox> dLdt(grids, 1);
         getNewLambda(dLdt, new_lambda, old_lambda, old_vel, adv_vel, a_oldTime, a_dt, a_dt);
+        if (isMovingGrid) {
+            m_levGeoPtr->addGCLCorrection(new_lambda, old_lambda, a_oldTime, newTime);
+        }
         nanCheck(new_lambda);
     }
 
@@ -118,6 +133,9 @@ void AMRNavierStokes::PPMTimeStep (const Real a_oldTime,
 
         LevelData<FArrayBox> dSdt(grids, 1);
         getNewScalar(dSdt, new_b, old_b, old_vel, adv_vel, a_oldTime, a_dt, a_dt, 0);
+        if (isMovingGrid) {
+            m_levGeoPtr->addGCLCorrection(new_b, old_b, a_oldTime, newTime);
+        }
         nanCheck(new_b);
     }
 
@@ -129,11 +147,19 @@ void AMRNavierStokes::PPMTimeStep (const Real a_oldTime,
 
         LevelData<FArrayBox> dSdt(grids, 1);
         getNewScalar(dSdt, newScal(comp), old_scal, old_vel, adv_vel, a_oldTime, a_dt, a_dt, comp);
+        if (isMovingGrid) {
+            m_levGeoPtr->addGCLCorrection(newScal(comp), old_scal, a_oldTime, newTime);
+        }
     }
 
     {   // Update CC velocities
         LevelData<FArrayBox> dUdt(grids, SpaceDim);
         getNewVelocity(dUdt, new_vel, old_vel, adv_vel, a_oldTime, a_dt, a_dt);
+
+        // The advective form needs no GCL term.
+        if (isMovingGrid && s_nonlinearDifferencingForm == ProblemContext::NonlinearDifferencingForm::CONSERVATIVE) {
+            m_levGeoPtr->addGCLCorrection(new_vel, old_vel, a_oldTime, newTime);
+        }
         nanCheck(new_vel);
     }
 
@@ -175,8 +201,11 @@ void AMRNavierStokes::computeAdvectingVelocities (LevelData<FluxBox>&   a_advVel
 
     // Compute predicted velocities
     {
+        LevelData<FluxBox> relVel;
+        const LevelData<FluxBox>& tracingVel = relativeAdvectingVelocity(relVel, a_advVel, a_oldTime, a_dt);
+
         LevelData<FluxBox> predVel(grids, SpaceDim); // Changed from m_tracingGhosts to 0
-        predictVelocities(predVel, a_oldVel, a_advVel, a_oldTime, a_dt);
+        predictVelocities(predVel, a_oldVel, tracingVel, a_oldTime, a_dt);
 
         // Copy normal components to a_advVel. From here on, a_advVel will be
         // staggered in time.
@@ -205,6 +234,7 @@ void AMRNavierStokes::computeAdvectingVelocities (LevelData<FluxBox>&   a_advVel
                                     true,        // a_advVel is a flux
                                     true,        // isLevelSolve
                                     false);      // forceHomogSolve
+        m_projIter += m_macProjector.getNumIter();
     }
 
     // Add volume discrepancy correction to advecting velocity
@@ -269,12 +299,16 @@ void AMRNavierStokes::getNewLambda (LevelData<FArrayBox>&       a_rhs,
     Tuple<BCMethodHolder,SpaceDim> BCValues = m_physBCPtr->lambdaRiemannBC();
     Tuple<BCMethodHolder,SpaceDim> BCSlopes = m_physBCPtr->lambdaSlopeBC();
 
+    // On a moving grid, lambda is carried through the moving faces.
+    LevelData<FluxBox> relVel;
+    const LevelData<FluxBox>& transportVel = relativeAdvectingVelocity(relVel, a_advVel, a_oldTime, a_dt);
+
     // Do the tracing
     m_advectUtilLambda.predictScalar(lambda_flux,
                                      a_old_lambda,
                                      NULL,
                                      a_oldVel,
-                                     a_advVel,
+                                     transportVel,
                                      a_dt,
                                      *m_levGeoPtr,
                                      BCValues,
@@ -351,6 +385,12 @@ void AMRNavierStokes::getNewScalar (LevelData<FArrayBox>&       a_rhs,
     BCMethodHolder scalBC = m_physBCPtr->scalarTraceFuncBC(a_comp);
     setGhostsScalar(a_oldScalar, scalBC, a_oldTime, a_comp);
 
+    // On a moving grid, the scalar is carried through the moving faces. The
+    // background source below still uses the fluid velocity, since the
+    // background is a fixed function of z.
+    LevelData<FluxBox> relVel;
+    const LevelData<FluxBox>& transportVel = relativeAdvectingVelocity(relVel, a_advVel, a_oldTime, a_dt);
+
     // The background advective source term is -Div[Uad^a * backgroundScalar] where Uad is a flux.
     // TODO: This is a bit of a waste!!!
     LevelData<FArrayBox> bkgdSrc(grids, 1, IntVect::Unit);
@@ -493,7 +533,7 @@ void AMRNavierStokes::getNewScalar (LevelData<FArrayBox>&       a_rhs,
                                        a_oldScalar,
                                        (s_useScalAdvectiveSource? &diffusiveSrc: NULL),
                                        a_oldVel,
-                                       a_advVel,
+                                       transportVel,
                                        a_dt,
                                        *m_levGeoPtr,
                                        BCValues,
@@ -682,7 +722,7 @@ void AMRNavierStokes::getNewScalar (LevelData<FArrayBox>&       a_rhs,
                                        a_oldScalar,
                                        (s_useScalAdvectiveSource? &bkgdSrc: NULL),
                                        a_oldVel,
-                                       a_advVel,
+                                       transportVel,
                                        a_dt,
                                        *m_levGeoPtr,
                                        BCValues,
@@ -780,9 +820,14 @@ void AMRNavierStokes::getNewVelocity (LevelData<FArrayBox>&       a_rhs,
             setValLevel(pred_vel, s_bogus_value);
         }
 
+        // On a moving grid, the momentum is traced and carried through the
+        // moving faces. The normal components below are still the fluid's.
+        LevelData<FluxBox> relVel;
+        const LevelData<FluxBox>& transportVel = relativeAdvectingVelocity(relVel, a_advVel, a_oldTime, a_dt);
+
         // Do the prediction. All inputs and outputs of this function
         // are in the mapped basis.
-        predictVelocities(pred_vel, a_oldVel, a_advVel, a_oldTime, a_dt);
+        predictVelocities(pred_vel, a_oldVel, transportVel, a_oldTime, a_dt);
 
         // It seems copying the normal components of a_advVel into pred_vel
         // (appropriately scaled, etc) is more stable than using the normal
@@ -884,7 +929,7 @@ void AMRNavierStokes::getNewVelocity (LevelData<FArrayBox>&       a_rhs,
                 for (dit.reset(); dit.ok(); ++dit) {
                     for (int dir = 0; dir < SpaceDim; ++dir) {
                         for (int velComp = 0; velComp < SpaceDim; ++velComp) {
-                            pred_vel[dit][dir].mult(a_advVel[dit][dir], 0, velComp, 1);
+                            pred_vel[dit][dir].mult(transportVel[dit][dir], 0, velComp, 1);
                         }
                     }
                 }
@@ -920,7 +965,7 @@ void AMRNavierStokes::getNewVelocity (LevelData<FArrayBox>&       a_rhs,
 
                 // Compute Av[adv_vel / J]. Use a_newVel as a temp holder.
                 LevelData<FArrayBox>& half_vel = a_newVel;
-                EdgeToCell(a_advVel, half_vel);
+                EdgeToCell(transportVel, half_vel);
                 m_levGeoPtr->divByJ(half_vel);
 
                 // Compute the negative of the advective term, half_vel.Grad[pred_vel]
@@ -938,7 +983,7 @@ void AMRNavierStokes::getNewVelocity (LevelData<FArrayBox>&       a_rhs,
                     for (dit.reset(); dit.ok(); ++dit) {
                         for (int dir = 0; dir < SpaceDim; ++dir) {
                             for (int velComp = 0; velComp < SpaceDim; ++velComp) {
-                                pred_vel[dit][dir].mult(a_advVel[dit][dir], 0, velComp, 1);
+                                pred_vel[dit][dir].mult(transportVel[dit][dir], 0, velComp, 1);
                             }
                         }
                     }
@@ -1206,6 +1251,8 @@ void AMRNavierStokes::getNewVelocity (LevelData<FArrayBox>&       a_rhs,
                 pout() << "Level " << m_level << " visc solve on comp " << comp << ": " << flush;
             }
 
+            const int viscIterBefore = m_viscSolverPtrs[comp]->getNumIter();
+
             if (numberMGlevels == 0) {
                 // Bottom level - no coarser.
                 int ncomp = compOldVelocity.nComp();
@@ -1259,6 +1306,8 @@ void AMRNavierStokes::getNewVelocity (LevelData<FArrayBox>&       a_rhs,
                                                    true,  // already kappa weighted?
                                                    comp); // flux reg start comp
             } // end if numberMGlevels == 1
+
+            m_viscIter += m_viscSolverPtrs[comp]->getNumIter() - viscIterBefore;
         } // end loop over velocity components (comp)
 
         // Free memory
@@ -1292,6 +1341,52 @@ void AMRNavierStokes::getNewVelocity (LevelData<FArrayBox>&       a_rhs,
 }
 
 
+// -----------------------------------------------------------------------------
+// On a moving grid, returns a_advVel minus the mapped flux velocity of the
+// grid over [a_oldTime, a_oldTime + a_dt]. This is the velocity that carries
+// each field through the moving faces. The result is stored in a_relVel.
+// If the map is static, this just returns a_advVel and a_relVel is unused.
+// -----------------------------------------------------------------------------
+const LevelData<FluxBox>&
+AMRNavierStokes::relativeAdvectingVelocity (LevelData<FluxBox>&       a_relVel,
+                                            const LevelData<FluxBox>& a_advVel,
+                                            const Real                a_oldTime,
+                                            const Real                a_dt) const
+{
+    if (!LevelGeometry::isTimeDependent()) return a_advVel;
+
+    CH_TIME("AMRNavierStokes::relativeAdvectingVelocity");
+
+    a_relVel.define(a_advVel.getBoxes(), a_advVel.nComp(), a_advVel.ghostVect());
+    DataIterator dit = a_relVel.dataIterator();
+    for (dit.reset(); dit.ok(); ++dit) {
+        for (int dir = 0; dir < SpaceDim; ++dir) {
+            a_relVel[dit][dir].copy(a_advVel[dit][dir]);
+        }
+    }
+
+    m_levGeoPtr->addGridVelocity(a_relVel, a_oldTime, a_oldTime + a_dt, -1.0);
+    return a_relVel;
+}
+
+
+// -----------------------------------------------------------------------------
+// Brings this level's metric to a_time. Since the velocity is stored in the
+// mapped basis, a_mappedVel is sent through the Cartesian basis so that it
+// represents the same physical velocity on the new grid.
+// -----------------------------------------------------------------------------
+void AMRNavierStokes::moveMetric (LevelData<FArrayBox>& a_mappedVel,
+                                  const Real            a_time)
+{
+    CH_TIME("AMRNavierStokes::moveMetric");
+    CH_assert(a_mappedVel.nComp() == SpaceDim);
+
+    m_levGeoPtr->sendToCartesianBasis(a_mappedVel, true);
+    m_levGeoPtr->updateMetrics(a_time);
+    m_levGeoPtr->sendToMappedBasis(a_mappedVel, true);
+}
+
+
 // -----------------------------------------------------------------------------
 // Uses the CC velocity at a_oldTime to predict each component at all FCs at
 // time a_oldTime + 0.5 * a_dt. The exchange on the result is up to the caller.
@@ -1525,6 +1620,7 @@ void AMRNavierStokes::doCCProjection (LevelData<FArrayBox>& a_vel,
                                false,       // is vel multiplied by J?
                                true,        // initialize pressure to zero? I see better results with 'true'.
                                false);      // force homog solve?
+    m_projIter += m_ccProjector.getNumIter();
 
     // This projection (assuming it converged) validates the pressure.
     m_ccPressureState = CCPressureState::VALID;
@@ -80,9 +80,21 @@ void AMRNavierStokes::PPMIGTimeStep (const Real a_oldTime,
     fillVelocity(old_vel, a_oldTime);
     old_vel.exchange(m_tracingExCopier);
 
+    // On a moving grid, the advecting velocity is predicted with the metric at
+    // the half time. Everything after that is updated on the new grid.
+    const bool isMovingGrid = LevelGeometry::isTimeDependent();
+    const Real newTime = a_oldTime + a_dt;
+    if (isMovingGrid) {
+        moveMetric(old_vel, a_oldTime + 0.5 * a_dt);
+    }
+
     LevelData<FluxBox> adv_vel(grids, 1, IntVect::Unit); // Changed from m_tracingGhosts to 1
     computeAdvectingVelocities(adv_vel, old_vel, a_oldTime, a_dt);
 
+    if (isMovingGrid) {
+        moveMetric(old_vel, newTime);
+    }
+
     if (a_updatePassiveScalars) {
         // Lambda update
         LevelData<FArrayBox> old_lambda;
@@ -91,6 +103,9 @@ void AMRNavierStokes::PPMIGTimeStep (const Real a_oldTime,
 
         LevelData<FArrayBox> dLdt(grids, 1);
         getNewLambda(dLdt, new_lambda, old_lambda, old_vel, adv_vel, a_oldTime, a_dt, a_dt);
+        if (isMovingGrid) {
+            m_levGeoPtr->addGCLCorrection(new_lambda, old_lambda, a_oldTime, newTime);
+        }
     }
 
     LevelData<FArrayBox> old_b;
@@ -101,6 +116,9 @@ void AMRNavierStokes::PPMIGTimeStep (const Real a_oldTime,
 
         LevelData<FArrayBox> dSdt(grids, 1);
         getNewScalar(dSdt, new_b, old_b, old_vel, adv_vel, a_oldTime, a_dt, a_dt, 0);
+        if (isMovingGrid) {
+            m_levGeoPtr->addGCLCorrection(new_b, old_b, a_oldTime, newTime);
+        }
     }
 
     for (int comp = 1; comp < s_num_scal_comps; ++comp) {
@@ -111,11 +129,19 @@ void AMRNavierStokes::PPMIGTimeStep (const Real a_oldTime,
 
         LevelData<FArrayBox> dSdt(grids, 1);
         getNewScalar(dSdt, newScal(comp), old_scal, old_vel, adv_vel, a_oldTime, a_dt, a_dt, comp);
+        if (isMovingGrid) {
+            m_levGeoPtr->addGCLCorrection(newScal(comp), old_scal, a_oldTime, newTime);
+        }
     }
 
     {   // Update CC velocities
         LevelData<FArrayBox> dUdt(grids, SpaceDim);
         getNewVelocity(dUdt, new_vel, old_vel, adv_vel, a_oldTime, a_dt, a_dt);
+
+        // The advective form needs no GCL term.
+        if (isMovingGrid && s_nonlinearDifferencingForm == ProblemContext::NonlinearDifferencingForm::CONSERVATIVE) {
+            m_levGeoPtr->addGCLCorrection(new_vel, old_vel, a_oldTime, newTime);
+        }
     }
 
     if (s_num_scal_comps > 0) {
@@ -148,6 +174,7 @@ void AMRNavierStokes::doCCIGProjection (LevelData<FArrayBox>&       a_newVel,
     const Real newTime  = a_oldTime + 1.0 * a_dt;
     const Real dummyTime = -1.0e300;
     const GeoSourceInterface& geoSource = *(m_levGeoPtr->getGeoSourcePtr());
+    MapTimeScope mapTime(*m_levGeoPtr);
     const RealVect& dx = m_levGeoPtr->getDx();
     const DisjointBoxLayout& grids = a_newVel.getBoxes();
     DataIterator dit = grids.dataIterator();
@@ -235,6 +235,7 @@ void AMRNavierStokes::computeMOLSources (LevelData<FArrayBox>& a_Su,
                                         false,       // a_advVel is not a flux
                                         true,        // isLevelSolve
                                         false);      // forceHomogSolve
+            m_projIter += m_macProjector.getNumIter();
         }
 
         // Set BCs
@@ -24,6 +24,7 @@
 #include "AMRNavierStokes.H"
 #include "Constants.H"
 #include "ProblemContext.H"
+#include "DiagnosticsLog.H"
 
 
 // Initialize static variables here
@@ -47,6 +48,9 @@ Real AMRNavierStokes::s_vel_tag_tol = 0.0;
 Real AMRNavierStokes::s_buoyancy_tag_tol = 0.0;
 Real AMRNavierStokes::s_pressure_tag_tol = 0.0;
 bool AMRNavierStokes::s_vert_extrude_tags = false;
+bool AMRNavierStokes::s_bitmap_tagging = false;
+bool AMRNavierStokes::s_predictive_tagging = false;
+std::vector<TagCriterion> AMRNavierStokes::s_tagCriteria;
 
 Real AMRNavierStokes::s_init_shrink = 1.0;
 Real AMRNavierStokes::s_max_dt = 1.0e8;
@@ -170,6 +174,17 @@ bool AMRNavierStokes::s_write_level_ids = false;
 bool AMRNavierStokes::s_write_grids = false;
 bool AMRNavierStokes::s_write_displacement = true;
 bool AMRNavierStokes::s_write_geometry = false;
+std::vector<std::string> AMRNavierStokes::s_plot_fields;
+PlotWriteOptions AMRNavierStokes::s_plotWriteOptions;
+PlotWriteOptions AMRNavierStokes::s_ckptWriteOptions;
+int  AMRNavierStokes::s_ckptFullInterval = 1;
+int  AMRNavierStokes::s_ckptCount = 0;
+bool AMRNavierStokes::s_ckptIsFull = true;
+std::vector<ProbeSpec> AMRNavierStokes::s_probes;
+std::string AMRNavierStokes::s_probe_prefix;
+std::vector<std::string> AMRNavierStokes::s_stats_fields;
+std::vector<std::pair<int,int> > AMRNavierStokes::s_stats_covariances;
+Real AMRNavierStokes::s_stats_startTime = 0.0;
 
 // Total (composite) energy
 Real AMRNavierStokes::s_totalEnergy = 1e8;
@@ -209,6 +224,11 @@ AMRNavierStokes::AMRNavierStokes ()
     m_lambda_old_ptr = NULL;
     m_scal_new.resize(0);
     m_scal_old.resize(0);
+    m_stats_ptr = NULL;
+    m_tagPriorityPtr = NULL;
+    m_localMaxDiv = -1.0;
+    m_projIter = 0;
+    m_viscIter = 0;
 
     m_scal_fluxreg_ptrs.resize(0);
 
@@ -216,6 +236,7 @@ AMRNavierStokes::AMRNavierStokes ()
     m_phi0Ptr = NULL;
 
     m_regrid_smoothing_done = false;
+    m_regrid_smoothing_base = -1;
 }
 
 
@@ -249,6 +270,16 @@ AMRNavierStokes::~AMRNavierStokes ()
         m_lambda_old_ptr = NULL;
     }
 
+    if (m_stats_ptr != NULL) {
+        delete m_stats_ptr;
+        m_stats_ptr = NULL;
+    }
+
+    if (m_tagPriorityPtr != NULL) {
+        delete m_tagPriorityPtr;
+        m_tagPriorityPtr = NULL;
+    }
+
     // loop over scalars and delete
     int nScalComp = m_scal_new.size();
     for (int comp = 0; comp < nScalComp; ++comp) {
@@ -317,6 +348,17 @@ void AMRNavierStokes::define (MappedAMRLevel*       a_coarser_level_ptr,
     // Create this level's levGeo object
     m_levGeoPtr = new LevelGeometry;
 
+    // On a moving grid, the PPM steps add the grid's flux to every field,
+    // including the velocity, which needs the nonlinear advection terms.
+    if (LevelGeometry::isTimeDependent()) {
+        if (s_updateScheme != ProblemContext::UpdateScheme::FiniteVolume) {
+            MayDay::Error("Moving coordinate maps require the FiniteVolume update scheme");
+        }
+        if (s_nonlinearDifferencingForm == ProblemContext::NonlinearDifferencingForm::NONE) {
+            MayDay::Error("Moving coordinate maps require a nonlinear differencing form");
+        }
+    }
+
     // To define the new levGeo, we will need these.
     // (The coarser levGeo ptr will be reset in initialGrid and regrid though.)
     const RealVect m_dx = s_domLength / RealVect(m_problem_domain.size());
@@ -377,6 +419,9 @@ void AMRNavierStokes::readParameters ()
     s_buoyancy_tag_tol = ctx->buoyancy_tag_tol;
     s_pressure_tag_tol = ctx->pressure_tag_tol;
     s_vert_extrude_tags = ctx->vert_extrude_tags;
+    s_bitmap_tagging = ctx->bitmap_tagging;
+    s_predictive_tagging = ctx->predictive_tagging;
+    s_tagCriteria = ctx->tagCriteria;
 
     s_write_stdout = ctx->write_stdout;
     s_init_shrink = ctx->init_dt_multiplier;
@@ -504,6 +549,21 @@ void AMRNavierStokes::readParameters ()
     s_write_grids = ctx->write_grids;
     s_write_displacement = ctx->write_displacement;
     s_write_geometry = ctx->write_geometry;
+    s_plot_fields = ctx->plot_fields;
+    s_plotWriteOptions = ctx->plot_writeOptions;
+    s_ckptWriteOptions.collective = ctx->checkpoint_collective;
+    s_ckptWriteOptions.chunkSize = ctx->checkpoint_chunkBytes / int(sizeof(Real));
+    s_ckptFullInterval = ctx->checkpoint_fullInterval;
+    s_probes = ctx->probes;
+    s_probe_prefix = ctx->probe_prefix;
+    s_stats_fields = ctx->stats_fields;
+    s_stats_covariances = ctx->stats_covariances;
+    s_stats_startTime = ctx->stats_startTime;
+
+    // Open the diagnostics log. Restarted runs append to it.
+    if (!ctx->diagnostics_file.empty()) {
+        DiagnosticsLog::open(ctx->diagnostics_file, ctx->diagnostics_flushInterval);
+    }
 
     // set flag to indicate that we've done this
     s_ppInit = true;
@@ -27,6 +27,7 @@
 #include "ExtrapolationUtils.H"
 #include "computeMappedSum.H"
 #include "MappedAMRPoissonOpFactory.H"
+#include "SetValLevel.H"
 #include <iomanip>
 
 
@@ -222,6 +223,64 @@ void AMRNavierStokes::computeVorticity (LevelData<FArrayBox>& a_vorticity) const
 }
 
 
+// -----------------------------------------------------------------------------
+// Computes |vorticity|. a_magVort must have one comp.
+// -----------------------------------------------------------------------------
+void AMRNavierStokes::computeMagVorticity (LevelData<FArrayBox>& a_magVort) const
+{
+    CH_TIME("AMRNavierStokes::computeMagVorticity");
+
+    const DisjointBoxLayout& grids = a_magVort.getBoxes();
+    DataIterator dit = grids.dataIterator();
+    CH_assert(a_magVort.nComp() == 1);
+
+#   if CH_SPACEDIM == 2
+        // Compute vorticity
+        this->computeVorticity(a_magVort);
+
+        // Compute |vorticity|
+        for (dit.reset(); dit.ok(); ++dit) {
+            FArrayBox& magVortFAB = a_magVort[dit];
+            const FArrayBox& gdnFAB = m_levGeoPtr->getCCgdn()[dit];
+            const FArrayBox& JinvFAB = m_levGeoPtr->getCCJinv()[dit];
+            const Box region = magVortFAB.box();
+            const int gdnComp = LevelGeometry::symTensorCompCC(SpaceDim-1, SpaceDim-1);
+
+            FORT_TWOFORMMAG2D(
+                CHF_FRA1(magVortFAB,0),
+                CHF_CONST_FRA1(magVortFAB,0),
+                CHF_CONST_FRA1(gdnFAB,gdnComp),
+                CHF_CONST_FRA1(JinvFAB,0),
+                CHF_BOX(region));
+        }
+
+#   elif CH_SPACEDIM == 3
+        // Compute vorticity
+        LevelData<FArrayBox> vorticity(grids, 3);
+        this->computeVorticity(vorticity);
+
+        // Compute |vorticity|
+        for (dit.reset(); dit.ok(); ++dit) {
+            FArrayBox& magVortFAB = a_magVort[dit];
+            const FArrayBox& vortFAB = vorticity[dit];
+            const Box region = magVortFAB.box();
+            const Real p = 0.5;
+
+            m_levGeoPtr->contractVectors(magVortFAB,
+                                         vortFAB,
+                                         vortFAB,
+                                         dit());
+
+            FORT_POWFAB(CHF_FRA(magVortFAB),
+                        CHF_BOX(region),
+                        CHF_CONST_REAL(p));
+        }
+#   else
+#       Bad SpaceDim
+#   endif
+}
+
+
 // -----------------------------------------------------------------------------
 // Compute the stream function on this level.
 // -----------------------------------------------------------------------------
@@ -350,10 +409,34 @@ void AMRNavierStokes::computeStreamFunction (LevelData<FArrayBox>& a_stream) con
 
 
 // -----------------------------------------------------------------------------
+// Computes the energy integral
 // -----------------------------------------------------------------------------
 Real AMRNavierStokes::totalEnergy () const
 {
-    CH_TIME("AMRNavierStokes::totalEnergy");
+    Real localEnergy = this->localTotalEnergy();
+
+#ifdef CH_MPI
+    Real globalEnergy = 0.0;
+    int result = MPI_Allreduce(&localEnergy, &globalEnergy, 1, MPI_CH_REAL, MPI_SUM, Chombo_MPI::comm);
+
+    if (result != MPI_SUCCESS) {
+        MayDay::Error("Sorry, but I had a communication error in AMRNavierStokes::totalEnergy");
+    }
+
+#else
+    Real globalEnergy = localEnergy;
+#endif
+
+    return globalEnergy;
+}
+
+
+// -----------------------------------------------------------------------------
+// This rank's part of the energy integral. No MPI communication is done.
+// -----------------------------------------------------------------------------
+Real AMRNavierStokes::localTotalEnergy () const
+{
+    CH_TIME("AMRNavierStokes::localTotalEnergy");
 
     // Gather composite data
     Vector<LevelData<FArrayBox>*> amrVel(0), amrB(0);
@@ -365,7 +448,7 @@ Real AMRNavierStokes::totalEnergy () const
         levelNSPtr = levelNSPtr->fineNSPtr();
     }
 
-    Real globalEnergy;
+    Real localEnergy, localVol = 0.0;
     Vector<LevelData<FArrayBox>*> amrEnergy(0);
     const int numLevels = amrVel.size();
     const LevelGeometry* levGeoPtr = m_levGeoPtr;
@@ -419,7 +502,7 @@ Real AMRNavierStokes::totalEnergy () const
     } // end loop over levels
 
     // Now, integrate the energy
-    globalEnergy = computeMappedSum(amrEnergy, *m_levGeoPtr);
+    localEnergy = computeLocalMappedSum(localVol, amrEnergy, *m_levGeoPtr);
 
     // Free memory (we no longer need the AMR energy data holder)
     for (int ilev = 0; ilev < amrEnergy.size(); ++ilev) {
@@ -430,5 +513,84 @@ Real AMRNavierStokes::totalEnergy () const
     }
     amrEnergy.resize(0);
 
-    return globalEnergy;
+    return localEnergy;
+}
+
+
+// -----------------------------------------------------------------------------
+// The number of components in m_stats_ptr. Zero if stats are off.
+// -----------------------------------------------------------------------------
+int AMRNavierStokes::numStatsComps ()
+{
+    const int numFields = s_stats_fields.size();
+    if (numFields == 0) return 0;
+
+    return 1 + 2 * numFields + int(s_stats_covariances.size());
+}
+
+
+// -----------------------------------------------------------------------------
+// Adds the current state to the running statistics, weighted by m_dt.
+// The fields are sampled just like the probes (Cartesian velocity, scalars
+// with or without their background). The updates are Welford's, so the
+// variances stay accurate over long runs with large means.
+// -----------------------------------------------------------------------------
+void AMRNavierStokes::accumulateStats ()
+{
+    const int numComps = numStatsComps();
+    if (numComps == 0) return;
+    if (isEmpty()) return;
+    if (m_time < s_stats_startTime) return;
+    if (m_dt <= 0.0) return;
+
+    CH_TIME("AMRNavierStokes::accumulateStats");
+
+    const DisjointBoxLayout& grids = m_vel_new_ptr->getBoxes();
+    DataIterator dit = grids.dataIterator();
+
+    // The first sample on this level starts from zero.
+    if (m_stats_ptr == NULL) {
+        m_stats_ptr = new LevelData<FArrayBox>(grids, numComps);
+        setValLevel(*m_stats_ptr, 0.0);
+    }
+    CH_assert(m_stats_ptr->nComp() == numComps);
+
+    LevelData<FArrayBox> samples;
+    this->getProbeData(samples, s_stats_fields);
+
+    const int numFields = s_stats_fields.size();
+    const int numCovs = s_stats_covariances.size();
+    const int covComp0 = 1 + 2 * numFields;
+
+    for (dit.reset(); dit.ok(); ++dit) {
+        FArrayBox& statsFAB = (*m_stats_ptr)[dit];
+        const FArrayBox& sampFAB = samples[dit];
+        const Box& valid = grids[dit];
+
+        // The co-moments need the means from before this sample.
+        for (int c = 0; c < numCovs; ++c) {
+            const int fa = s_stats_covariances[c].first;
+            const int fb = s_stats_covariances[c].second;
+
+            FORT_STATSCOMOMENT(CHF_FRA1(statsFAB, covComp0 + c),
+                               CHF_CONST_FRA1(sampFAB, fa),
+                               CHF_CONST_FRA1(statsFAB, 1 + 2*fa),
+                               CHF_CONST_FRA1(sampFAB, fb),
+                               CHF_CONST_FRA1(statsFAB, 1 + 2*fb),
+                               CHF_CONST_FRA1(statsFAB, 0),
+                               CHF_CONST_REAL(m_dt),
+                               CHF_BOX(valid));
+        }
+
+        for (int f = 0; f < numFields; ++f) {
+            FORT_STATSMOMENT(CHF_FRA1(statsFAB, 1 + 2*f),
+                             CHF_FRA1(statsFAB, 2 + 2*f),
+                             CHF_CONST_FRA1(sampFAB, f),
+                             CHF_CONST_FRA1(statsFAB, 0),
+                             CHF_CONST_REAL(m_dt),
+                             CHF_BOX(valid));
+        }
+
+        statsFAB.plus(m_dt, valid, 0, 1);
+    }
 }
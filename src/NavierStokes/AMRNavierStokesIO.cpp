@@ -30,48 +30,207 @@
 #include "computeMappedNorm.H"
 #include "SetValLevel.H"
 #include "TaylorGreenBCUtil.H"
+#include "MiscUtils.H"
+#include <limits>
 
 #ifdef CH_USE_HDF5
 #include "CH_HDF5.H"
 
 
 // -----------------------------------------------------------------------------
-// Writes the checkpoint metadata.
-// The metadata written by this function will only be used to perform a sanity
-// check on the checkpoint file.
+// A cheap checksum of a_data's valid cells and layout. This is used to decide
+// if a field changed since it was last checkpointed. The result is the same
+// on all ranks. This is collective.
 // -----------------------------------------------------------------------------
-void AMRNavierStokes::writeCheckpointHeader(HDF5Handle& a_handle) const
+static unsigned long long checkpointHash (const LevelData<FArrayBox>& a_data)
 {
-    if (s_verbosity >= 5) {
-        pout() << "AMRNavierStokes::writeCheckpointHeader" << endl;
+    CH_TIME("checkpointHash");
+
+    const unsigned long long fnvPrime = 1099511628211ULL;
+    const unsigned long long fnvBasis = 14695981039346656037ULL;
+
+    const DisjointBoxLayout& grids = a_data.getBoxes();
+    const int numComps = a_data.nComp();
+    unsigned long long localSum = 0;
+
+    DataIterator dit = a_data.dataIterator();
+    for (dit.reset(); dit.ok(); ++dit) {
+        const Box& valid = grids[dit];
+        const FArrayBox& dataFAB = a_data[dit];
+
+        // FNV-1a over this box's index, extents, and valid data.
+        unsigned long long h = fnvBasis;
+        std::vector<int> boxInts(1, dit().intCode());
+        for (int d = 0; d < SpaceDim; ++d) {
+            boxInts.push_back(valid.smallEnd(d));
+            boxInts.push_back(valid.bigEnd(d));
+        }
+        const unsigned char* bytes = reinterpret_cast<const unsigned char*>(&boxInts[0]);
+        for (size_t b = 0; b < boxInts.size() * sizeof(int); ++b) {
+            h = (h ^ bytes[b]) * fnvPrime;
+        }
+
+        for (int comp = 0; comp < numComps; ++comp) {
+            BoxIterator bit(valid);
+            for (bit.reset(); bit.ok(); ++bit) {
+                const Real val = dataFAB(bit(), comp);
+                bytes = reinterpret_cast<const unsigned char*>(&val);
+                for (size_t b = 0; b < sizeof(Real); ++b) {
+                    h = (h ^ bytes[b]) * fnvPrime;
+                }
+            }
+        }
+
+        // Summing makes the result independent of the box distribution.
+        localSum += h;
     }
 
-    // Create the header. This will only store metadata
-    // about the number of fields and thier names.
-    HDF5HeaderData header;
+#ifdef CH_MPI
+    unsigned long long globalSum = 0;
+    MPI_Allreduce(&localSum, &globalSum, 1, MPI_UNSIGNED_LONG_LONG, MPI_SUM, Chombo_MPI::comm);
+    return globalSum;
+#else
+    return localSum;
+#endif
+}
+
+
+// -----------------------------------------------------------------------------
+// Reads a checkpointed field. If the level's header says the field was
+// skipped by an incremental checkpoint, it is read from the file named there.
+// Returns the status of readPlotData.
+// -----------------------------------------------------------------------------
+static int readCheckpointField (HDF5Handle&           a_handle,
+                                const HDF5HeaderData& a_header,
+                                LevelData<FArrayBox>& a_data,
+                                const std::string&    a_name)
+{
+    std::map<std::string, std::string>::const_iterator it =
+        a_header.m_string.find(a_name + "_file");
+
+    if (it == a_header.m_string.end()) {
+        return readPlotData(a_handle, a_data, a_name);
+    }
+
+    pout() << "Reading " << a_name << " from " << it->second << endl;
+    HDF5Handle refHandle(it->second, HDF5Handle::OPEN_RDONLY);
+    refHandle.setGroup(a_handle.getGroup());
+    const int status = readPlotData(refHandle, a_data, a_name);
+    refHandle.close();
+
+    return status;
+}
+
+
+// -----------------------------------------------------------------------------
+// Writes the processor assignment of every box. At restart, this lets each
+// rank read back exactly the boxes it wrote. This is collective.
+// -----------------------------------------------------------------------------
+static void writeBoxProcs (HDF5Handle&              a_handle,
+                           const DisjointBoxLayout& a_grids)
+{
+    std::vector<int> procs;
+    LayoutIterator lit = a_grids.layoutIterator();
+    for (lit.reset(); lit.ok(); ++lit) {
+        procs.push_back(a_grids.procID(lit()));
+    }
+
+    hsize_t dims[1];
+    dims[0] = procs.size();
+    hid_t procSpace = H5Screate_simple(1, dims, NULL);
+
+    hid_t procSet = H5Dcreate(a_handle.groupID(), "box_procs", H5T_NATIVE_INT, procSpace, H5P_DEFAULT);
+    if (procSet < 0) {
+        std::ostringstream msg;
+        msg << "writeBoxProcs: H5Dcreate failed to create box_procs. Return value = " << procSet;
+        MayDay::Error(msg.str().c_str());
+    }
+
+    if (procID() == 0 && procs.size() > 0) {
+        H5Dwrite(procSet, H5T_NATIVE_INT, H5S_ALL, H5S_ALL, H5P_DEFAULT, &procs[0]);
+    }
+
+    H5Dclose(procSet);
+    H5Sclose(procSpace);
+}
+
+
+// -----------------------------------------------------------------------------
+// Reads the processor assignments written by writeBoxProcs.
+// Returns 0 on success.
+// -----------------------------------------------------------------------------
+static int readBoxProcs (HDF5Handle&  a_handle,
+                         Vector<int>& a_procs)
+{
+    hid_t procSet = H5Dopen(a_handle.groupID(), "box_procs");
+    if (procSet < 0) return 1;
+
+    hid_t procSpace = H5Dget_space(procSet);
+    a_procs.resize(H5Sget_simple_extent_npoints(procSpace));
+
+    herr_t status = 0;
+    if (a_procs.size() > 0) {
+        status = H5Dread(procSet, H5T_NATIVE_INT, H5S_ALL, H5S_ALL, H5P_DEFAULT, &a_procs[0]);
+    }
+
+    H5Sclose(procSpace);
+    H5Dclose(procSet);
+
+    return ((status < 0)? 2: 0);
+}
+
+
+// -----------------------------------------------------------------------------
+// Collects the checkpoint metadata.
+// The metadata collected by this function will only be used to perform a
+// sanity check on the checkpoint file.
+// -----------------------------------------------------------------------------
+void AMRNavierStokes::getCheckpointHeader(HDF5HeaderData& a_header) const
+{
+    // This will only store metadata about the number of fields and thier names.
 
     // Scalar metadata...
-    header.m_int["num_components"] = s_num_scal_comps;
+    a_header.m_int["num_components"] = s_num_scal_comps;
     char comp_str[30];
     for (int comp = 0; comp < s_num_scal_comps; ++comp) {
         sprintf (comp_str, "component_%d", comp);
-        header.m_string[comp_str] = s_scal_names[comp];
+        a_header.m_string[comp_str] = s_scal_names[comp];
     }
 
     // Lambda metadata...
-    header.m_string["lambda_component"] = "lambda";
+    a_header.m_string["lambda_component"] = "lambda";
 
     // Velocity metadata...
     for (int comp = 0; comp < CH_SPACEDIM; ++comp) {
         sprintf (comp_str, "vel_component_%d", comp);
-        header.m_string[comp_str] = s_vel_names[comp];
+        a_header.m_string[comp_str] = s_vel_names[comp];
     }
 
     // Pressure
-    header.m_string["ccPressure_component"] = "ccPressure";
+    a_header.m_string["ccPressure_component"] = "ccPressure";
 
     // eLambda
-    header.m_string["eLambda_component"] = "eLambda";
+    a_header.m_string["eLambda_component"] = "eLambda";
+}
+
+
+// -----------------------------------------------------------------------------
+// Writes the checkpoint metadata.
+// -----------------------------------------------------------------------------
+void AMRNavierStokes::writeCheckpointHeader(HDF5Handle& a_handle) const
+{
+    if (s_verbosity >= 5) {
+        pout() << "AMRNavierStokes::writeCheckpointHeader" << endl;
+    }
+
+    HDF5HeaderData header;
+    this->getCheckpointHeader(header);
+
+    // Is this a full checkpoint? If not, the levels will only write the
+    // fields that changed since they were last written.
+    s_ckptIsFull = (s_ckptCount % s_ckptFullInterval == 0);
+    ++s_ckptCount;
+    header.m_int["is_incremental"] = (s_ckptIsFull? 0: 1);
 
     // Write the metadata to HDF5 and pout.*
     header.writeToFile(a_handle);
@@ -81,12 +240,82 @@ void AMRNavierStokes::writeCheckpointHeader(HDF5Handle& a_handle) const
 }
 
 
+// -----------------------------------------------------------------------------
+// Collects the level's checkpoint metadata and the fields that need to be
+// written. Empty levels have no fields.
+//
+// NOTE: Do not collect static data that comes from ParmParse.
+// -----------------------------------------------------------------------------
+void AMRNavierStokes::getCheckpointLevel(HDF5HeaderData&                      a_header,
+                                         Vector<std::string>&                 a_names,
+                                         Vector<const LevelData<FArrayBox>*>& a_data) const
+{
+    // Collect all metadata that will be needed at restart.
+    a_header.m_int     ["step_number"] = s_step_number;
+    a_header.m_intvect ["ref_ratio"]   = m_ref_ratio;
+    a_header.m_realvect["vec_dx"]      = m_levGeoPtr->getDx();
+    a_header.m_real    ["dt"]          = m_dt;
+    a_header.m_real    ["time"]        = m_time;
+    a_header.m_real    ["cfl"]         = m_cfl;
+
+    a_header.m_int["finest_level"] = m_finest_level;
+    a_header.m_int["is_empty"]     = m_is_empty;
+
+    a_header.m_box["prob_domain"]  = m_problem_domain.domainBox();
+
+    D_TERM(
+        a_header.m_int["is_periodic_0"] = (m_problem_domain.isPeriodic(0)? 1: 0);,
+        a_header.m_int["is_periodic_1"] = (m_problem_domain.isPeriodic(1)? 1: 0);,
+        a_header.m_int["is_periodic_2"] = (m_problem_domain.isPeriodic(2)? 1: 0);
+    )
+
+    a_names.resize(0);
+    a_data.resize(0);
+    if (isEmpty()) return;
+
+    // Velocity and lambda
+    a_names.push_back("new_velocity");
+    a_data.push_back(m_vel_new_ptr);
+    a_names.push_back("old_velocity");
+    a_data.push_back(m_vel_old_ptr);
+
+    a_names.push_back("new_lambda");
+    a_data.push_back(m_lambda_new_ptr);
+    a_names.push_back("old_lambda");
+    a_data.push_back(m_lambda_old_ptr);
+
+    // All of the scalars
+    for (int comp = 0; comp < s_num_scal_comps; ++comp) {
+        ostringstream new_scal_str;
+        new_scal_str << "new_scalar_component_" << comp;
+        a_names.push_back(new_scal_str.str());
+        a_data.push_back(m_scal_new[comp]);
+
+        ostringstream old_scal_str;
+        old_scal_str << "old_scalar_component_" << comp;
+        a_names.push_back(old_scal_str.str());
+        a_data.push_back(m_scal_old[comp]);
+    }
+
+    // Pressure and VD correction stuff
+    a_names.push_back("ccPressure");
+    a_data.push_back(&m_ccPressure);
+    a_names.push_back("eLambda");
+    a_data.push_back(&m_eLambda);
+
+    // Running statistics, if any have been accumulated.
+    if (m_stats_ptr != NULL) {
+        a_header.m_int["num_stats_comps"] = m_stats_ptr->nComp();
+        a_names.push_back("stats");
+        a_data.push_back(m_stats_ptr);
+    }
+}
+
+
 // -----------------------------------------------------------------------------
 // Writes the checkpoint data.
 // This function writes the field data to the checkpoint file. It also calls
 // writeCheckpointLevel() of all state objects owned by this level.
-//
-// NOTE: Do not write static data that comes from ParmParse.
 // -----------------------------------------------------------------------------
 void AMRNavierStokes::writeCheckpointLevel(HDF5Handle& a_handle) const
 {
@@ -100,28 +329,43 @@ void AMRNavierStokes::writeCheckpointLevel(HDF5Handle& a_handle) const
     const std::string label = std::string("level_") + level_str;
     a_handle.setGroup(label);
 
-    // Create the header for this group.
-    // This will store the level's metadata.
+    // Collect the level's metadata and the fields that need to be written.
     HDF5HeaderData header;
+    Vector<std::string> fieldNames;
+    Vector<const LevelData<FArrayBox>*> fieldPtrs;
+    this->getCheckpointLevel(header, fieldNames, fieldPtrs);
+
+    // Incremental checkpoints skip the fields that did not change since they
+    // were last written. The header records where those copies live.
+    std::vector<bool> skipField(fieldNames.size(), false);
+    if (s_ckptFullInterval > 1 && fieldNames.size() > 0) {
+        std::string thisFile;
+        {
+            const ssize_t len = H5Fget_name(a_handle.fileID(), NULL, 0);
+            std::vector<char> buf(len + 1, '\0');
+            H5Fget_name(a_handle.fileID(), &buf[0], len + 1);
+            thisFile = std::string(&buf[0]);
+        }
 
-    // Collect all metadata that will be needed at restart.
-    header.m_int     ["step_number"] = s_step_number;
-    header.m_intvect ["ref_ratio"]   = m_ref_ratio;
-    header.m_realvect["vec_dx"]      = m_levGeoPtr->getDx();
-    header.m_real    ["dt"]          = m_dt;
-    header.m_real    ["time"]        = m_time;
-    header.m_real    ["cfl"]         = m_cfl;
+        for (unsigned int idx = 0; idx < fieldNames.size(); ++idx) {
+            const unsigned long long hash = checkpointHash(*fieldPtrs[idx]);
 
-    header.m_int["finest_level"] = m_finest_level;
-    header.m_int["is_empty"]     = m_is_empty;
+            std::map<std::string, std::pair<unsigned long long, std::string> >::const_iterator it
+                = m_ckptRecords.find(fieldNames[idx]);
 
-    header.m_box["prob_domain"]  = m_problem_domain.domainBox();
+            if (!s_ckptIsFull && it != m_ckptRecords.end() && it->second.first == hash) {
+                skipField[idx] = true;
+                header.m_string[fieldNames[idx] + "_file"] = it->second.second;
+            } else {
+                m_ckptRecords[fieldNames[idx]] = std::make_pair(hash, thisFile);
+            }
+        }
+    }
 
-    D_TERM(
-        header.m_int["is_periodic_0"] = (m_problem_domain.isPeriodic(0)? 1: 0);,
-        header.m_int["is_periodic_1"] = (m_problem_domain.isPeriodic(1)? 1: 0);,
-        header.m_int["is_periodic_2"] = (m_problem_domain.isPeriodic(2)? 1: 0);
-    )
+    // The processor map is only useful to a restart on as many ranks.
+    if (!isEmpty()) {
+        header.m_int["num_procs"] = numProc();
+    }
 
     // Write the metadata to file and pout.*
     header.writeToFile(a_handle);
@@ -131,30 +375,16 @@ void AMRNavierStokes::writeCheckpointLevel(HDF5Handle& a_handle) const
 
     // If this level has valid data, we need to write it to HDF5.
     if (!isEmpty()) {
-        // First, write the grids
+        // First, write the grids and who owns them
         write (a_handle, m_vel_new_ptr->boxLayout());
+        writeBoxProcs(a_handle, m_vel_new_ptr->getBoxes());
 
-        // Then, the velocity and lambda
-        write (a_handle, *m_vel_new_ptr, "new_velocity");
-        write (a_handle, *m_vel_old_ptr, "old_velocity");
-
-        write (a_handle, *m_lambda_new_ptr, "new_lambda");
-        write (a_handle, *m_lambda_old_ptr, "old_lambda");
-
-        // Then, all of the scalars
-        for (int comp = 0; comp < s_num_scal_comps; ++comp) {
-            ostringstream old_scal_str;
-            old_scal_str << "new_scalar_component_" << comp;
-            write (a_handle, *m_scal_new[comp], old_scal_str.str().c_str());
-
-            ostringstream new_scal_str;
-            new_scal_str << "old_scalar_component_" << comp;
-            write (a_handle, *m_scal_old[comp], new_scal_str.str().c_str());
+        // Then, the fields
+        for (unsigned int idx = 0; idx < fieldNames.size(); ++idx) {
+            if (skipField[idx]) continue;
+            writePlotData(a_handle, *fieldPtrs[idx], fieldNames[idx],
+                          IntVect::Zero, s_ckptWriteOptions);
         }
-
-        // Pressure and VD correction stuff
-        write (a_handle, m_ccPressure, "ccPressure");
-        write (a_handle, m_eLambda, "eLambda");
     }
 }
 
@@ -359,8 +589,22 @@ void AMRNavierStokes::readCheckpointLevel (HDF5Handle& a_handle)
         MayDay::Error("AMRNavierStokes::readCheckpointLevel: file does not contain a Vector<Box>");
     }
 
-    // Create level grids
-    const DisjointBoxLayout grids = loadBalance(boxArrayFromFile);
+    // Create level grids. If we run on as many ranks as the checkpoint was
+    // written with, reuse its processor map so that each rank reads back
+    // exactly the boxes it wrote. Otherwise, rebalance.
+    DisjointBoxLayout grids;
+    {
+        Vector<int> procsFromFile;
+        if (header.m_int.find("num_procs") != header.m_int.end() &&
+            header.m_int["num_procs"] == numProc() &&
+            readBoxProcs(a_handle, procsFromFile) == 0 &&
+            procsFromFile.size() == boxArrayFromFile.size()) {
+
+            grids.define(boxArrayFromFile, procsFromFile, m_problem_domain);
+        } else {
+            grids = loadBalance(boxArrayFromFile);
+        }
+    }
 
     // I am not using boxArrayFromFile because loadBalance may have changed things.
     m_level_grids = grids.boxArray();
@@ -376,6 +620,12 @@ void AMRNavierStokes::readCheckpointLevel (HDF5Handle& a_handle)
         pout() << endl;
     }
 
+    // Any running statistics are replaced by the checkpoint's.
+    if (m_stats_ptr != NULL) {
+        delete m_stats_ptr;
+        m_stats_ptr = NULL;
+    }
+
     // If this level has valid data, read it now.
     if (!isEmpty()) {
         // Allocate and define fields.
@@ -410,20 +660,20 @@ void AMRNavierStokes::readCheckpointLevel (HDF5Handle& a_handle)
         // Read velocity data
         {
             LevelData<FArrayBox>& new_vel = *m_vel_new_ptr;
-            const int velData_status = read<FArrayBox>(a_handle,
-                                                       new_vel,
-                                                       "new_velocity",
-                                                       grids);
+            const int velData_status = readCheckpointField(a_handle,
+                                                            header,
+                                                            new_vel,
+                                                            "new_velocity");
             if (velData_status != 0) {
                 MayDay::Error("AMRNavierStokes::readCheckpointLevel: file does not contain new_velocity data");
             }
         }
         {
             LevelData<FArrayBox>& old_vel = *m_vel_old_ptr;
-            const int velData_status = read<FArrayBox>(a_handle,
-                                                       old_vel,
-                                                       "old_velocity",
-                                                       grids);
+            const int velData_status = readCheckpointField(a_handle,
+                                                            header,
+                                                            old_vel,
+                                                            "old_velocity");
             if (velData_status != 0) {
                 MayDay::Error("AMRNavierStokes::readCheckpointLevel: file does not contain old_velocity data");
             }
@@ -432,20 +682,20 @@ void AMRNavierStokes::readCheckpointLevel (HDF5Handle& a_handle)
         // Read lambda data
         {
             LevelData<FArrayBox>& new_lambda = *m_lambda_new_ptr;
-            const int lambdaData_status = read<FArrayBox>(a_handle,
-                                                          new_lambda,
-                                                          "new_lambda",
-                                                          grids);
+            const int lambdaData_status = readCheckpointField(a_handle,
+                                                               header,
+                                                               new_lambda,
+                                                               "new_lambda");
             if (lambdaData_status != 0) {
                 MayDay::Error("AMRNavierStokes::readCheckpointLevel: file does not contain new_lambda data");
             }
         }
         {
             LevelData<FArrayBox>& old_lambda = *m_lambda_old_ptr;
-            const int lambdaData_status = read<FArrayBox>(a_handle,
-                                                          old_lambda,
-                                                          "old_lambda",
-                                                          grids);
+            const int lambdaData_status = readCheckpointField(a_handle,
+                                                               header,
+                                                               old_lambda,
+                                                               "old_lambda");
             if (lambdaData_status != 0) {
                 MayDay::Error("AMRNavierStokes::readCheckpointLevel: file does not contain old_lambda data");
             }
@@ -454,33 +704,53 @@ void AMRNavierStokes::readCheckpointLevel (HDF5Handle& a_handle)
         // Read scalar data
         for (int comp = 0; comp < s_num_scal_comps; ++comp) {
             {
-                char scal_str[20];
+                char scal_str[40];
                 sprintf(scal_str, "new_scalar_component_%d", comp);
 
                 LevelData<FArrayBox>& new_scal = *m_scal_new[comp];
-                const int scalData_status = read<FArrayBox>(a_handle,
-                                                            new_scal,
-                                                            scal_str,
-                                                            grids);
+                const int scalData_status = readCheckpointField(a_handle,
+                                                                 header,
+                                                                 new_scal,
+                                                                 scal_str);
                 if (scalData_status != 0) {
                     MayDay::Error("AMRNavierStokes::readCheckpointLevel: file does not contain new_scalar data");
                 }
             }
             {
-                char scal_str[20];
+                char scal_str[40];
                 sprintf(scal_str, "old_scalar_component_%d", comp);
 
                 LevelData<FArrayBox>& old_scal = *m_scal_old[comp];
-                const int scalData_status = read<FArrayBox>(a_handle,
-                                                            old_scal,
-                                                            scal_str,
-                                                            grids);
+                const int scalData_status = readCheckpointField(a_handle,
+                                                                 header,
+                                                                 old_scal,
+                                                                 scal_str);
                 if (scalData_status != 0) {
                     MayDay::Error("AMRNavierStokes::readCheckpointLevel: file does not contain old_scalar data");
                 }
             }
         }
 
+        // Read the running statistics. If the stats.* parameters changed
+        // since this checkpoint was written, we start them over.
+        std::map<std::string, int>::const_iterator statsIt = header.m_int.find("num_stats_comps");
+        if (statsIt != header.m_int.end() && numStatsComps() > 0) {
+            if (statsIt->second == numStatsComps()) {
+                m_stats_ptr = new LevelData<FArrayBox>(grids, numStatsComps());
+                const int statsData_status = readCheckpointField(a_handle,
+                                                                  header,
+                                                                  *m_stats_ptr,
+                                                                  "stats");
+                if (statsData_status != 0) {
+                    MayDay::Error("AMRNavierStokes::readCheckpointLevel: file does not contain stats data");
+                }
+            } else {
+                pout() << "AMRNavierStokes::readCheckpointLevel: The stats.* parameters"
+                       << " do not match the checkpoint. Restarting the statistics."
+                       << endl;
+            }
+        }
+
     } else {
         // This level is empty.
         m_vel_new_ptr = NULL;
@@ -502,10 +772,10 @@ void AMRNavierStokes::readCheckpointLevel (HDF5Handle& a_handle)
     // We read the pressure data *after* calling levelSetup so that it
     // doesn't get clobbered.
     if (!isEmpty()) {
-        const int ccPressureData_status = read<FArrayBox>(a_handle,
-                                                          m_ccPressure,
-                                                          "ccPressure",
-                                                          grids);
+        const int ccPressureData_status = readCheckpointField(a_handle,
+                                                               header,
+                                                               m_ccPressure,
+                                                               "ccPressure");
         if (ccPressureData_status != 0) {
             MayDay::Error("AMRNavierStokes::readCheckpointLevel: file does not contain ccPressure data");
         }
@@ -536,11 +806,11 @@ void AMRNavierStokes::readCheckpointLevel (HDF5Handle& a_handle)
         // eLambda
         if (s_etaLambda > 0.0) {
             // Read eLambda from file.
-            const int eLambdaData_status = read<FArrayBox>(a_handle,
-                                                           m_eLambda,
-                                                           "eLambda",
-                                                           grids);
-            if (ccPressureData_status != 0) {
+            const int eLambdaData_status = readCheckpointField(a_handle,
+                                                                header,
+                                                                m_eLambda,
+                                                                "eLambda");
+            if (eLambdaData_status != 0) {
                 MayDay::Error("AMRNavierStokes::readCheckpointLevel: file does not contain eLambda data");
             }
 
@@ -691,6 +961,89 @@ void AMRNavierStokes::writePlotHeader (HDF5Handle& a_handle) const
     }
 
     HDF5HeaderData header;
+    getPlotHeader(header);
+
+    header.writeToFile(a_handle);
+
+    if (s_verbosity >= 5) {
+        pout () << header << endl;
+    }
+}
+
+
+// -----------------------------------------------------------------------------
+// getPlotHeader
+// -----------------------------------------------------------------------------
+void AMRNavierStokes::getPlotHeader (HDF5HeaderData& a_header) const
+{
+    HDF5HeaderData fullHeader;
+    getFullPlotHeader(fullHeader);
+
+    if (s_plot_fields.empty()) {
+        a_header = fullHeader;
+        return;
+    }
+
+    // Renumber the components that were asked for.
+    Vector<int> plotComps;
+    selectPlotComps(plotComps, fullHeader);
+
+    a_header.m_int["num_components"] = plotComps.size();
+
+    char comp_str[30];
+    char full_str[30];
+    for (int comp = 0; comp < plotComps.size(); ++comp) {
+        sprintf(comp_str, "component_%d", comp);
+        sprintf(full_str, "component_%d", plotComps[comp]);
+        a_header.m_string[comp_str] = fullHeader.m_string[full_str];
+    }
+}
+
+
+// -----------------------------------------------------------------------------
+// selectPlotComps
+// Finds the components of the full plot data whose names are in plot.fields.
+// The components keep the order of the full plot data.
+// -----------------------------------------------------------------------------
+void AMRNavierStokes::selectPlotComps (Vector<int>&          a_plotComps,
+                                       const HDF5HeaderData& a_fullHeader)
+{
+    const std::map<std::string, std::string>& names = a_fullHeader.m_string;
+    const int numFullComps = a_fullHeader.m_int.find("num_components")->second;
+
+    a_plotComps.clear();
+    char comp_str[30];
+    for (int comp = 0; comp < numFullComps; ++comp) {
+        sprintf(comp_str, "component_%d", comp);
+        const std::string& name = names.find(comp_str)->second;
+
+        for (int f = 0; f < s_plot_fields.size(); ++f) {
+            if (s_plot_fields[f] == name) {
+                a_plotComps.push_back(comp);
+                break;
+            }
+        }
+    }
+
+    if (a_plotComps.size() != s_plot_fields.size()) {
+        std::ostringstream msg;
+        msg << "plot.fields contains a name that is not among the enabled plot components:";
+        for (int comp = 0; comp < numFullComps; ++comp) {
+            sprintf(comp_str, "component_%d", comp);
+            msg << " " << names.find(comp_str)->second;
+        }
+        MayDay::Error(msg.str().c_str());
+    }
+}
+
+
+// -----------------------------------------------------------------------------
+// getFullPlotHeader
+// The names of every enabled plot component.
+// -----------------------------------------------------------------------------
+void AMRNavierStokes::getFullPlotHeader (HDF5HeaderData& a_header) const
+{
+    HDF5HeaderData& header = a_header;
 
     int numcomp = numPlotComps();
     header.m_int ["num_components"] = numcomp;
@@ -816,6 +1169,26 @@ void AMRNavierStokes::writePlotHeader (HDF5Handle& a_handle) const
         }
     }
 
+    if (!s_stats_fields.empty()) {
+        for (int f = 0; f < int(s_stats_fields.size()); ++f) {
+            sprintf(comp_str, "component_%d", comp);
+            header.m_string[comp_str] = s_stats_fields[f] + "_mean";
+            comp++;
+
+            sprintf(comp_str, "component_%d", comp);
+            header.m_string[comp_str] = s_stats_fields[f] + "_var";
+            comp++;
+        }
+
+        for (int c = 0; c < int(s_stats_covariances.size()); ++c) {
+            sprintf(comp_str, "component_%d", comp);
+            header.m_string[comp_str] = s_stats_fields[s_stats_covariances[c].first]
+                                      + "_" + s_stats_fields[s_stats_covariances[c].second]
+                                      + "_cov";
+            comp++;
+        }
+    }
+
     // write procID's
     if (s_write_proc_ids) {
         sprintf(comp_str, "component_%d", comp);
@@ -1014,12 +1387,6 @@ void AMRNavierStokes::writePlotHeader (HDF5Handle& a_handle) const
         header.m_string[comp_str] = "FofT";
         comp++;
     }
-
-    header.writeToFile(a_handle);
-
-    if (s_verbosity >= 5) {
-        pout () << header << endl;
-    }
 }
 
 
@@ -1039,25 +1406,58 @@ void AMRNavierStokes::writePlotLevel(HDF5Handle& a_handle) const
     a_handle.setGroup(label);
 
     HDF5HeaderData header;
+    LevelData<FArrayBox> plotData;
+    getPlotLevel(header, plotData);
 
-    header.m_intvect ["ref_ratio"]   = m_ref_ratio;
-    header.m_realvect["vec_dx"]      = m_levGeoPtr->getDx();
-    header.m_real    ["dt"]          = m_dt;
-    header.m_real    ["time"]        = m_time;
-    header.m_box     ["prob_domain"] = m_problem_domain.domainBox();
     header.writeToFile(a_handle);
 
     if (s_verbosity >= 3) {
         pout () << header << endl;
     }
 
+    write (a_handle, plotData.getBoxes());
+    writePlotData(a_handle, plotData, "data", plotData.ghostVect(), s_plotWriteOptions);
+}
+
+
+// -----------------------------------------------------------------------------
+// getPlotLevel
+// -----------------------------------------------------------------------------
+void AMRNavierStokes::getPlotLevel (HDF5HeaderData&       a_header,
+                                    LevelData<FArrayBox>& a_plotData) const
+{
+    a_header.m_intvect ["ref_ratio"]   = m_ref_ratio;
+    a_header.m_realvect["vec_dx"]      = m_levGeoPtr->getDx();
+    a_header.m_real    ["dt"]          = m_dt;
+    a_header.m_real    ["time"]        = m_time;
+    a_header.m_box     ["prob_domain"] = m_problem_domain.domainBox();
+
     const DisjointBoxLayout& levelGrids = m_vel_new_ptr->getBoxes();
     int numcomp = numPlotComps();
 
+    // If only some fields were asked for, assemble them in a full-sized
+    // temporary and keep what we need at the end. The fields that were
+    // left out are never computed and stay zero.
+    const bool selectComps = !s_plot_fields.empty();
+    LevelData<FArrayBox> fullData;
+    LevelData<FArrayBox>& plotData = (selectComps? fullData: a_plotData);
+
+    Vector<int> plotComps;
+    if (selectComps) {
+        HDF5HeaderData fullHeader;
+        getFullPlotHeader(fullHeader);
+        selectPlotComps(plotComps, fullHeader);
+    }
+
     // We will need one ghost in order for the displacement field to
     // do its job properly.
-    LevelData<FArrayBox> plotData(levelGrids, numcomp, IntVect::Unit);
-    getPlotData(plotData);
+    plotData.define(levelGrids, numcomp, IntVect::Unit);
+    if (selectComps) {
+        setValLevel(plotData, 0.0);
+        getPlotData(plotData, &plotComps);
+    } else {
+        getPlotData(plotData);
+    }
 
     // This will fill all ghosts of plotData, including edges and vertices so
     // that VisIt will be able to generate contour plots cleanly.
@@ -1074,8 +1474,72 @@ void AMRNavierStokes::writePlotLevel(HDF5Handle& a_handle) const
     }
 #   endif
 
-    write (a_handle, levelGrids);
-    write (a_handle, plotData, "data", plotData.ghostVect());
+    // Keep only the requested components, ghosts included.
+    if (selectComps) {
+        a_plotData.define(levelGrids, plotComps.size(), plotData.ghostVect());
+
+        DataIterator dit = levelGrids.dataIterator();
+        for (dit.reset(); dit.ok(); ++dit) {
+            for (int comp = 0; comp < plotComps.size(); ++comp) {
+                a_plotData[dit].copy(plotData[dit], plotComps[comp], comp, 1);
+            }
+        }
+    }
+}
+
+
+// -----------------------------------------------------------------------------
+// getThumbnail
+// Averages level 0's plot data onto level 0's grids coarsened by a_coarsening.
+// The synchronization has already averaged the finer levels' velocity, lambda
+// and scalars down to level 0, so only level 0's plot data is computed. This
+// spares a streamfunction solve and a metric pass on every finer level. The
+// derived fields (vorticity, pressure, divergence, ...) are therefore level 0
+// values, not averages of the composite solution.
+// -----------------------------------------------------------------------------
+void AMRNavierStokes::getThumbnail (HDF5HeaderData&       a_header,
+                                    LevelData<FArrayBox>& a_thumbData,
+                                    const IntVect&        a_coarsening) const
+{
+    CH_TIME("AMRNavierStokes::getThumbnail");
+    CH_assert(m_level == 0);
+
+    HDF5HeaderData levHeader;
+    LevelData<FArrayBox> plotData;
+    getPlotLevel(levHeader, plotData);
+    const int numComps = plotData.nComp();
+
+    // Average onto the coarsened grids. Every box stays on its rank, so
+    // this needs no communication.
+    const DisjointBoxLayout& grids = plotData.getBoxes();
+    {
+        LayoutIterator lit = grids.layoutIterator();
+        for (lit.reset(); lit.ok(); ++lit) {
+            const Box& valid = grids[lit()];
+            if (refine(coarsen(valid, a_coarsening), a_coarsening) != valid) {
+                std::ostringstream msg;
+                msg << "AMRNavierStokes::getThumbnail: level 0 box " << valid
+                    << " cannot be coarsened by " << a_coarsening
+                    << ". Adjust plot.thumbnail_coarsening or the blocking factor.";
+                MayDay::Error(msg.str().c_str());
+            }
+        }
+    }
+
+    DisjointBoxLayout thumbGrids;
+    coarsen(thumbGrids, grids, a_coarsening);
+    a_thumbData.define(thumbGrids, numComps);
+
+    MappedCoarseAverage thumbAvg(grids, numComps, a_coarsening);
+    thumbAvg.averageToCoarse(a_thumbData, plotData, m_levGeoPtr, true);
+
+    // The header of a level with the coarsened resolution.
+    const RealVect thumbDx = m_levGeoPtr->getDx() * RealVect(a_coarsening);
+    a_header.m_intvect ["ref_ratio"]   = IntVect::Unit;
+    a_header.m_realvect["vec_dx"]      = thumbDx;
+    a_header.m_real    ["dt"]          = m_dt;
+    a_header.m_real    ["time"]        = m_time;
+    a_header.m_box     ["prob_domain"] = coarsen(m_problem_domain.domainBox(), a_coarsening);
 }
 
 #endif //CH_USE_HDF5
@@ -1141,6 +1605,11 @@ int AMRNavierStokes::numPlotComps () const
         numcomp += s_num_scal_comps;
     }
 
+    // running statistics (mean and variance of each field, then covariances)
+    if (!s_stats_fields.empty()) {
+        numcomp += 2 * int(s_stats_fields.size()) + int(s_stats_covariances.size());
+    }
+
     // procID's
     if (s_write_proc_ids) {
         ++numcomp;
@@ -1184,10 +1653,33 @@ int AMRNavierStokes::numPlotComps () const
 }
 
 
+// -----------------------------------------------------------------------------
+// anyPlotComp
+// Returns true if a_plotComps is NULL or holds any of the a_num plot
+// components starting at a_first.
+// -----------------------------------------------------------------------------
+static bool anyPlotComp (const Vector<int>* a_plotComps,
+                         const int          a_first,
+                         const int          a_num)
+{
+    if (a_plotComps == NULL) return true;
+
+    for (int idx = 0; idx < a_plotComps->size(); ++idx) {
+        const int comp = (*a_plotComps)[idx];
+        if (a_first <= comp && comp < a_first + a_num) return true;
+    }
+    return false;
+}
+
+
 // -----------------------------------------------------------------------------
 // getPlotData
+// Only the components listed in a_plotComps are guaranteed to be filled.
+// The cheap fields are always written, but the ones that need a solve or
+// a pass over the metric are skipped when they were not asked for.
 // -----------------------------------------------------------------------------
-void AMRNavierStokes::getPlotData (LevelData<FArrayBox>& a_plot_data) const
+void AMRNavierStokes::getPlotData (LevelData<FArrayBox>& a_plot_data,
+                                   const Vector<int>*    a_plotComps) const
 {
 
     // Sanity checks
@@ -1263,56 +1755,61 @@ void AMRNavierStokes::getPlotData (LevelData<FArrayBox>& a_plot_data) const
 
     // Divergence
     if (s_write_divergence) {
-        // Set up Ju on this level
-        LevelData<FArrayBox> Ju(grids, SpaceDim, m_vel_new_ptr->ghostVect());
-        m_vel_new_ptr->copyTo(velComps, Ju, velComps, copier);
-        m_levGeoPtr->multByJ(Ju);
-        Ju.exchange(velComps, m_oneGhostExCopier);
-
-        // Set up coarser Ju
-        LevelData<FArrayBox>* crseJuPtr = NULL;
-        if (m_level > 0) {
-            crseJuPtr = new LevelData<FArrayBox>(crseVelPtr->getBoxes(),
-                                                 SpaceDim,
-                                                 ghostVect);
-            crseVelPtr->copyTo(velComps, *crseJuPtr, velComps);
-            crseNSPtr()->m_levGeoPtr->multByJ(*crseJuPtr);
-        }
-
-        // Set up finer Ju
-        LevelData<FArrayBox>* fineJuPtr = NULL;
-        if (!finestLevel()) {
-            fineJuPtr = new LevelData<FArrayBox>(fineVelPtr->getBoxes(),
-                                                 SpaceDim,
-                                                 fineVelPtr->ghostVect());
-            fineVelPtr->copyTo(velComps, *fineJuPtr, velComps);
-            fineNSPtr()->m_levGeoPtr->multByJ(*fineJuPtr);
-        }
-
-        // Compute divergence
-        bool isViscousDummy = true;
-        Tuple<BCMethodHolder, SpaceDim> uStarBCHolder = m_physBCPtr->uStarFuncBC(isViscousDummy);
-
-        LevelData<FArrayBox> divU(grids, 1);
-        Divergence::compDivergenceCC(divU,
-                                     Ju,
-                                     crseJuPtr,
-                                     fineJuPtr,
-                                     true,
-                                     *m_levGeoPtr,
-                                     m_time,
-                                     &uStarBCHolder);
-
-        // Free memory
-        delete crseJuPtr;
-        delete fineJuPtr;
+        const int numComps = 1;
+        if (anyPlotComp(a_plotComps, plot_data_counter, numComps)) {
+            // Set up Ju on this level
+            LevelData<FArrayBox> Ju(grids, SpaceDim, m_vel_new_ptr->ghostVect());
+            m_vel_new_ptr->copyTo(velComps, Ju, velComps, copier);
+            m_levGeoPtr->multByJ(Ju);
+            Ju.exchange(velComps, m_oneGhostExCopier);
+
+            // Set up coarser Ju
+            LevelData<FArrayBox>* crseJuPtr = NULL;
+            if (m_level > 0) {
+                crseJuPtr = new LevelData<FArrayBox>(crseVelPtr->getBoxes(),
+                                                     SpaceDim,
+                                                     ghostVect);
+                crseVelPtr->copyTo(velComps, *crseJuPtr, velComps);
+                crseNSPtr()->m_levGeoPtr->multByJ(*crseJuPtr);
+            }
 
-        // Copy
-        Interval divDestComp(plot_data_counter, plot_data_counter);
-        divU.copyTo(srcComp, a_plot_data, divDestComp);
+            // Set up finer Ju
+            LevelData<FArrayBox>* fineJuPtr = NULL;
+            if (!finestLevel()) {
+                fineJuPtr = new LevelData<FArrayBox>(fineVelPtr->getBoxes(),
+                                                     SpaceDim,
+                                                     fineVelPtr->ghostVect());
+                fineVelPtr->copyTo(velComps, *fineJuPtr, velComps);
+                fineNSPtr()->m_levGeoPtr->multByJ(*fineJuPtr);
+            }
 
-        // Increment plot counter
-        plot_data_counter += 1;
+            // Compute divergence
+            bool isViscousDummy = true;
+            Tuple<BCMethodHolder, SpaceDim> uStarBCHolder = m_physBCPtr->uStarFuncBC(isViscousDummy);
+
+            LevelData<FArrayBox> divU(grids, 1);
+            Divergence::compDivergenceCC(divU,
+                                         Ju,
+                                         crseJuPtr,
+                                         fineJuPtr,
+                                         true,
+                                         *m_levGeoPtr,
+                                         m_time,
+                                         &uStarBCHolder);
+
+            // Free memory
+            delete crseJuPtr;
+            delete fineJuPtr;
+
+            // Copy
+            Interval divDestComp(plot_data_counter, plot_data_counter);
+            divU.copyTo(srcComp, a_plot_data, divDestComp);
+
+            // Increment plot counter
+            plot_data_counter += 1;
+        } else {
+            plot_data_counter += numComps;
+        }
     } // end divergence
 
     // Lambda - 1.0
@@ -1331,27 +1828,32 @@ void AMRNavierStokes::getPlotData (LevelData<FArrayBox>& a_plot_data) const
 
     // VD correction
     if (s_write_grad_eLambda) {
-        // Write the EdgeToCell average right to the plot holder
-        for (dit.begin(); dit.ok(); ++dit) {
-            FArrayBox& thisPlotData = a_plot_data[dit];
-            const FluxBox& thisGradE = m_gradELambda[dit];
-
-            for (int dir = 0; dir < SpaceDim; ++dir) {
-                int edgeComp = 0;
-                int plotComp = plot_data_counter + dir;
-
-                EdgeToCell(thisGradE,
-                           edgeComp,
-                           thisPlotData,
-                           plotComp,
-                           dir);
-
-                m_levGeoPtr->divByJ(thisPlotData, dit(), plotComp);
+        const int numComps = SpaceDim;
+        if (anyPlotComp(a_plotComps, plot_data_counter, numComps)) {
+            // Write the EdgeToCell average right to the plot holder
+            for (dit.begin(); dit.ok(); ++dit) {
+                FArrayBox& thisPlotData = a_plot_data[dit];
+                const FluxBox& thisGradE = m_gradELambda[dit];
+
+                for (int dir = 0; dir < SpaceDim; ++dir) {
+                    int edgeComp = 0;
+                    int plotComp = plot_data_counter + dir;
+
+                    EdgeToCell(thisGradE,
+                               edgeComp,
+                               thisPlotData,
+                               plotComp,
+                               dir);
+
+                    m_levGeoPtr->divByJ(thisPlotData, dit(), plotComp);
+                }
             }
-        }
 
-        // Increment plot counter
-        plot_data_counter += SpaceDim;
+            // Increment plot counter
+            plot_data_counter += SpaceDim;
+        } else {
+            plot_data_counter += numComps;
+        }
     }
 
     // Pressure
@@ -1372,59 +1874,69 @@ void AMRNavierStokes::getPlotData (LevelData<FArrayBox>& a_plot_data) const
 
     // Vorticity and norm(vorticity)
     if (s_write_vorticity) {
-        const int numVortComps = D_TERM(0,+1,+2);
-
-        // Compute vorticity
-        LevelData<FArrayBox> vort(grids, numVortComps);
-        this->computeVorticity(vort);
+        const int numComps = D_TERM(0,+1,+2) + (SpaceDim == 3? 1: 0);
+        if (anyPlotComp(a_plotComps, plot_data_counter, numComps)) {
+            const int numVortComps = D_TERM(0,+1,+2);
 
-        // Copy vorticity
-        Interval srcVortComps(0, numVortComps-1);
-        Interval destVortComps(plot_data_counter, plot_data_counter+numVortComps-1);
-        vort.copyTo(srcVortComps, a_plot_data, destVortComps);
+            // Compute vorticity
+            LevelData<FArrayBox> vort(grids, numVortComps);
+            this->computeVorticity(vort);
 
-        // Increment plot counter
-        plot_data_counter += numVortComps;
+            // Copy vorticity
+            Interval srcVortComps(0, numVortComps-1);
+            Interval destVortComps(plot_data_counter, plot_data_counter+numVortComps-1);
+            vort.copyTo(srcVortComps, a_plot_data, destVortComps);
 
-        if (SpaceDim == 3) {
-            // Compute norm(vorticity)
-            LevelData<FArrayBox> normVort(grids, 1);
-            for (dit.reset(); dit.ok(); ++dit) {
-                m_levGeoPtr->contractVectors(normVort[dit],
-                                             vort[dit],
-                                             vort[dit],
-                                             dit());
-
-                BoxIterator bit(normVort[dit].box());
-                for (bit.reset(); bit.ok(); ++bit) {
-                    normVort[dit](bit(),0) = sqrt(normVort[dit](bit(),0));
+            // Increment plot counter
+            plot_data_counter += numVortComps;
+
+            if (SpaceDim == 3) {
+                // Compute norm(vorticity)
+                LevelData<FArrayBox> normVort(grids, 1);
+                for (dit.reset(); dit.ok(); ++dit) {
+                    m_levGeoPtr->contractVectors(normVort[dit],
+                                                 vort[dit],
+                                                 vort[dit],
+                                                 dit());
+
+                    BoxIterator bit(normVort[dit].box());
+                    for (bit.reset(); bit.ok(); ++bit) {
+                        normVort[dit](bit(),0) = sqrt(normVort[dit](bit(),0));
+                    }
                 }
-            }
 
-            // Copy norm(vorticity)
-            Interval magVortComps(plot_data_counter, plot_data_counter);
-            normVort.copyTo(srcComp, a_plot_data, magVortComps);
+                // Copy norm(vorticity)
+                Interval magVortComps(plot_data_counter, plot_data_counter);
+                normVort.copyTo(srcComp, a_plot_data, magVortComps);
 
-            // Increment plot counter
-            ++plot_data_counter;
+                // Increment plot counter
+                ++plot_data_counter;
+            }
+        } else {
+            plot_data_counter += numComps;
         }
     }
 
     // Streamfunction
     if (s_write_streamfunction) {
-        const int numStreamComps = D_TERM(0,+1,+2);
+        const int numComps = D_TERM(0,+1,+2);
+        if (anyPlotComp(a_plotComps, plot_data_counter, numComps)) {
+            const int numStreamComps = D_TERM(0,+1,+2);
 
-        // Compute streamfunction
-        LevelData<FArrayBox> streamFunction(grids, numStreamComps, IntVect::Unit);
-        this->computeStreamFunction(streamFunction);
+            // Compute streamfunction
+            LevelData<FArrayBox> streamFunction(grids, numStreamComps, IntVect::Unit);
+            this->computeStreamFunction(streamFunction);
 
-        // Copy streamfunction
-        Interval srcStreamComps(0, numStreamComps-1);
-        Interval destStreamComps(plot_data_counter, plot_data_counter+numStreamComps-1);
-        streamFunction.copyTo(srcStreamComps, a_plot_data, destStreamComps);
+            // Copy streamfunction
+            Interval srcStreamComps(0, numStreamComps-1);
+            Interval destStreamComps(plot_data_counter, plot_data_counter+numStreamComps-1);
+            streamFunction.copyTo(srcStreamComps, a_plot_data, destStreamComps);
 
-        // Increment plot counter
-        plot_data_counter += numStreamComps;
+            // Increment plot counter
+            plot_data_counter += numStreamComps;
+        } else {
+            plot_data_counter += numComps;
+        }
     }
 
     // Scalars
@@ -1434,6 +1946,12 @@ void AMRNavierStokes::getPlotData (LevelData<FArrayBox>& a_plot_data) const
             const int srcComps = src.nComp();
             const Interval srcInterval = src.interval();
 
+            // Skip scalars that plot.fields leaves out
+            if (!anyPlotComp(a_plotComps, plot_data_counter, srcComps)) {
+                plot_data_counter += srcComps;
+                continue;
+            }
+
             const Interval destInterval(plot_data_counter,
                                         plot_data_counter + srcComps - 1);
 
@@ -1456,6 +1974,12 @@ void AMRNavierStokes::getPlotData (LevelData<FArrayBox>& a_plot_data) const
             const int srcComps = src.nComp();
             const Interval srcInterval = src.interval();
 
+            // Skip scalars that plot.fields leaves out
+            if (!anyPlotComp(a_plotComps, plot_data_counter, srcComps)) {
+                plot_data_counter += srcComps;
+                continue;
+            }
+
             const Interval destInterval(plot_data_counter,
                                         plot_data_counter + srcComps - 1);
 
@@ -1467,6 +1991,46 @@ void AMRNavierStokes::getPlotData (LevelData<FArrayBox>& a_plot_data) const
         }
     }
 
+    // Running statistics. These are zero until the first sample.
+    if (!s_stats_fields.empty()) {
+        const int numFields = s_stats_fields.size();
+        const int numCovs = s_stats_covariances.size();
+        const int numComps = 2 * numFields + numCovs;
+
+        if (m_stats_ptr == NULL) {
+            for (dit.reset(); dit.ok(); ++dit) {
+                a_plot_data[dit].setVal(0.0, grids[dit], plot_data_counter, numComps);
+            }
+        } else {
+            CH_assert(m_stats_ptr->getBoxes().compatible(grids));
+
+            for (dit.reset(); dit.ok(); ++dit) {
+                FArrayBox& plotFAB = a_plot_data[dit];
+                const FArrayBox& statsFAB = (*m_stats_ptr)[dit];
+                const Box& valid = grids[dit];
+
+                for (int f = 0; f < numFields; ++f) {
+                    plotFAB.copy(statsFAB, valid, 1 + 2*f, valid, plot_data_counter + 2*f, 1);
+
+                    FORT_STATSNORMALIZE(CHF_FRA1(plotFAB, plot_data_counter + 2*f + 1),
+                                        CHF_CONST_FRA1(statsFAB, 2 + 2*f),
+                                        CHF_CONST_FRA1(statsFAB, 0),
+                                        CHF_BOX(valid));
+                }
+
+                for (int c = 0; c < numCovs; ++c) {
+                    FORT_STATSNORMALIZE(CHF_FRA1(plotFAB, plot_data_counter + 2*numFields + c),
+                                        CHF_CONST_FRA1(statsFAB, 1 + 2*numFields + c),
+                                        CHF_CONST_FRA1(statsFAB, 0),
+                                        CHF_BOX(valid));
+                }
+            }
+        }
+
+        // Increment plot counter
+        plot_data_counter += numComps;
+    }
+
     // procID's
     if (s_write_proc_ids) {
         // Write proc id directly to plot holder
@@ -1495,82 +2059,92 @@ void AMRNavierStokes::getPlotData (LevelData<FArrayBox>& a_plot_data) const
 
     // Displacement (used to visualize geometries in VisIt w/ displace operator)
     if (s_write_displacement) {
-        // Write displacements directly to plot holder
-        Interval interv(plot_data_counter, plot_data_counter + SpaceDim - 1);
-        for (dit.reset(); dit.ok(); ++dit) {
-            FArrayBox dispFAB(interv, a_plot_data[dit]);
-            m_levGeoPtr->fill_displacement(dispFAB);
-        }
+        const int numComps = SpaceDim;
+        if (anyPlotComp(a_plotComps, plot_data_counter, numComps)) {
+            // Write displacements directly to plot holder
+            Interval interv(plot_data_counter, plot_data_counter + SpaceDim - 1);
+            for (dit.reset(); dit.ok(); ++dit) {
+                FArrayBox dispFAB(interv, a_plot_data[dit]);
+                m_levGeoPtr->fill_displacement(dispFAB);
+            }
 
-        // Increment plot counter
-        plot_data_counter += SpaceDim;
+            // Increment plot counter
+            plot_data_counter += SpaceDim;
+        } else {
+            plot_data_counter += numComps;
+        }
     }
 
     // Geometry
     if (s_write_geometry) {
-        { // physCoor
-            Interval interv(plot_data_counter, plot_data_counter + SpaceDim - 1);
-            for (dit.reset(); dit.ok(); ++dit) {
-                FArrayBox physCoorFAB(interv, a_plot_data[dit]);
-                m_levGeoPtr->fill_physCoor(physCoorFAB);
+        const int numComps = SpaceDim + 2*SpaceDim*SpaceDim + 2 + SpaceDim*(SpaceDim+1);
+        if (anyPlotComp(a_plotComps, plot_data_counter, numComps)) {
+            { // physCoor
+                Interval interv(plot_data_counter, plot_data_counter + SpaceDim - 1);
+                for (dit.reset(); dit.ok(); ++dit) {
+                    FArrayBox physCoorFAB(interv, a_plot_data[dit]);
+                    m_levGeoPtr->fill_physCoor(physCoorFAB);
+                }
+                plot_data_counter += SpaceDim;
             }
-            plot_data_counter += SpaceDim;
-        }
 
-        { // dxdXi
-            Interval interv(plot_data_counter, plot_data_counter + SpaceDim*SpaceDim - 1);
-            for (dit.reset(); dit.ok(); ++dit) {
-                FArrayBox dxdXiFAB(interv, a_plot_data[dit]);
-                m_levGeoPtr->fill_dxdXi(dxdXiFAB);
+            { // dxdXi
+                Interval interv(plot_data_counter, plot_data_counter + SpaceDim*SpaceDim - 1);
+                for (dit.reset(); dit.ok(); ++dit) {
+                    FArrayBox dxdXiFAB(interv, a_plot_data[dit]);
+                    m_levGeoPtr->fill_dxdXi(dxdXiFAB);
+                }
+                plot_data_counter += SpaceDim*SpaceDim;
             }
-            plot_data_counter += SpaceDim*SpaceDim;
-        }
 
-        { // dXidx
-            Interval interv(plot_data_counter, plot_data_counter + SpaceDim*SpaceDim - 1);
-            for (dit.reset(); dit.ok(); ++dit) {
-                FArrayBox dXidxFAB(interv, a_plot_data[dit]);
-                m_levGeoPtr->fill_dXidx(dXidxFAB);
+            { // dXidx
+                Interval interv(plot_data_counter, plot_data_counter + SpaceDim*SpaceDim - 1);
+                for (dit.reset(); dit.ok(); ++dit) {
+                    FArrayBox dXidxFAB(interv, a_plot_data[dit]);
+                    m_levGeoPtr->fill_dXidx(dXidxFAB);
+                }
+                plot_data_counter += SpaceDim*SpaceDim;
             }
-            plot_data_counter += SpaceDim*SpaceDim;
-        }
 
-        { // J
-            Interval interv(plot_data_counter, plot_data_counter);
-            for (dit.reset(); dit.ok(); ++dit) {
-                FArrayBox JFAB(interv, a_plot_data[dit]);
-                m_levGeoPtr->fill_J(JFAB);
+            { // J
+                Interval interv(plot_data_counter, plot_data_counter);
+                for (dit.reset(); dit.ok(); ++dit) {
+                    FArrayBox JFAB(interv, a_plot_data[dit]);
+                    m_levGeoPtr->fill_J(JFAB);
+                }
+                plot_data_counter += 1;
             }
-            plot_data_counter += 1;
-        }
 
-        { // Jinv
-            Interval interv(plot_data_counter, plot_data_counter);
-            for (dit.reset(); dit.ok(); ++dit) {
-                FArrayBox JinvFAB(interv, a_plot_data[dit]);
-                m_levGeoPtr->fill_Jinv(JinvFAB);
+            { // Jinv
+                Interval interv(plot_data_counter, plot_data_counter);
+                for (dit.reset(); dit.ok(); ++dit) {
+                    FArrayBox JinvFAB(interv, a_plot_data[dit]);
+                    m_levGeoPtr->fill_Jinv(JinvFAB);
+                }
+                plot_data_counter += 1;
             }
-            plot_data_counter += 1;
-        }
 
-        { // gdn
-            const int ncomps = (SpaceDim * (SpaceDim + 1)) / 2;
-            Interval interv(plot_data_counter, plot_data_counter + ncomps - 1);
-            for (dit.reset(); dit.ok(); ++dit) {
-                FArrayBox gdnFAB(interv, a_plot_data[dit]);
-                m_levGeoPtr->fill_gdn(gdnFAB);
+            { // gdn
+                const int ncomps = (SpaceDim * (SpaceDim + 1)) / 2;
+                Interval interv(plot_data_counter, plot_data_counter + ncomps - 1);
+                for (dit.reset(); dit.ok(); ++dit) {
+                    FArrayBox gdnFAB(interv, a_plot_data[dit]);
+                    m_levGeoPtr->fill_gdn(gdnFAB);
+                }
+                plot_data_counter += ncomps;
             }
-            plot_data_counter += ncomps;
-        }
 
-        { // gup
-            const int ncomps = (SpaceDim * (SpaceDim + 1)) / 2;
-            Interval interv(plot_data_counter, plot_data_counter + ncomps - 1);
-            for (dit.reset(); dit.ok(); ++dit) {
-                FArrayBox gupFAB(interv, a_plot_data[dit]);
-                m_levGeoPtr->fill_gup(gupFAB);
+            { // gup
+                const int ncomps = (SpaceDim * (SpaceDim + 1)) / 2;
+                Interval interv(plot_data_counter, plot_data_counter + ncomps - 1);
+                for (dit.reset(); dit.ok(); ++dit) {
+                    FArrayBox gupFAB(interv, a_plot_data[dit]);
+                    m_levGeoPtr->fill_gup(gupFAB);
+                }
+                plot_data_counter += ncomps;
             }
-            plot_data_counter += ncomps;
+        } else {
+            plot_data_counter += numComps;
         }
     }
 
@@ -1694,3 +2268,173 @@ void AMRNavierStokes::getPlotData (LevelData<FArrayBox>& a_plot_data) const
         ++plot_data_counter;            // FofT
     } // end if TaylorGreenBCUtil
 }
+
+
+// -----------------------------------------------------------------------------
+// writeProbes
+// Samples any output probes that are due this step. This is only called on
+// level 0, so we walk the hierarchy ourselves.
+// -----------------------------------------------------------------------------
+void AMRNavierStokes::writeProbes (int  a_step,
+                                   Real a_time) const
+{
+    if (s_probes.empty()) return;
+
+    CH_TIME("AMRNavierStokes::writeProbes");
+    CH_assert(m_level == 0);
+
+    for (size_t p = 0; p < s_probes.size(); ++p) {
+        const ProbeSpec& spec = s_probes[p];
+        if (spec.interval <= 0 || a_step % spec.interval != 0) continue;
+
+        // Find the probe's level. Skip it if that level does not exist yet.
+        const AMRNavierStokes* levPtr = this;
+        for (int lev = 0; lev < spec.level && levPtr != NULL; ++lev) {
+            levPtr = (levPtr->finestLevel()? NULL: levPtr->fineNSPtr());
+        }
+        if (levPtr == NULL) continue;
+        if (!levPtr->m_vel_new_ptr->getBoxes().isClosed()) continue;
+
+        const ProblemDomain& domain = levPtr->m_problem_domain;
+        const Box region = spec.region(domain.domainBox());
+        if (region.isEmpty()) {
+            MayDay::Warning("A probe region does not intersect its level's domain");
+            continue;
+        }
+
+        // Gather the requested fields of the region onto one proc.
+        // Cells that the level's grids do not cover are left as NaN.
+        LevelData<FArrayBox> levelData;
+        levPtr->getProbeData(levelData, spec.fields, region);
+
+        DisjointBoxLayout probeGrids;
+        defineOneProcGrids(probeGrids, domain, region);
+
+        LevelData<FArrayBox> probeData(probeGrids, levelData.nComp());
+        setValLevel(probeData, std::numeric_limits<Real>::quiet_NaN());
+        levelData.copyTo(probeData);
+
+        DataIterator dit = probeGrids.dataIterator();
+        for (dit.reset(); dit.ok(); ++dit) {
+            ProbeOutput::append(spec, s_probe_prefix, region, a_step, a_time, probeData[dit]);
+        }
+    }
+}
+
+
+// -----------------------------------------------------------------------------
+// getProbeData
+// Defines a_data on the parts of this level's grids that intersect a_region
+// and fills it with the named fields. Velocities are sent to the Cartesian
+// basis and the scalars include their background, just like the plot data.
+// Every field here is pointwise, so the clipped boxes need no ghosts.
+// An empty a_region samples the whole level on the level's own layout.
+// -----------------------------------------------------------------------------
+void AMRNavierStokes::getProbeData (LevelData<FArrayBox>&           a_data,
+                                    const std::vector<std::string>& a_fields,
+                                    const Box&                      a_region) const
+{
+    const DisjointBoxLayout& levelGrids = m_vel_new_ptr->getBoxes();
+    const ProblemDomain& domain = levelGrids.physDomain();
+    const Interval srcComp(0, 0);
+    const char* velNames[] = {"x_Vel", "y_Vel", "z_Vel"};
+
+    // Clip the level's boxes to the probe region. Each piece stays on the
+    // rank that owns its box, so the copies below are local.
+    DisjointBoxLayout grids = levelGrids;
+    if (!a_region.isEmpty()) {
+        Vector<Box> boxes;
+        Vector<int> procs;
+        LayoutIterator lit = levelGrids.layoutIterator();
+        for (lit.reset(); lit.ok(); ++lit) {
+            const Box clipped = levelGrids[lit()] & a_region;
+            if (clipped.isEmpty()) continue;
+
+            boxes.push_back(clipped);
+            procs.push_back(levelGrids.procID(lit()));
+        }
+        grids = DisjointBoxLayout(boxes, procs, domain);
+    }
+
+    a_data.define(grids, a_fields.size());
+
+    // Only convert the velocity if it was asked for.
+    LevelData<FArrayBox> cartVel;
+
+    for (int f = 0; f < int(a_fields.size()); ++f) {
+        const std::string& field = a_fields[f];
+        const Interval destComp(f, f);
+        bool found = false;
+
+        for (int dir = 0; dir < SpaceDim && !found; ++dir) {
+            if (field != velNames[dir]) continue;
+
+            if (!cartVel.isDefined()) {
+                cartVel.define(grids, SpaceDim);
+                m_vel_new_ptr->copyTo(cartVel);
+                m_levGeoPtr->sendToCartesianBasis(cartVel, true);
+            }
+            cartVel.copyTo(Interval(dir, dir), a_data, destComp);
+            found = true;
+        }
+
+        if (!found && field == "pressure") {
+            m_ccPressure.copyTo(srcComp, a_data, destComp);
+            if (m_syncPressureState == SyncPressureState::SYNC) {
+                m_syncPressure.addTo(srcComp, a_data, destComp, domain);
+            }
+            found = true;
+        }
+
+        for (int scal = 0; scal < s_num_scal_comps && !found; ++scal) {
+            const LevelData<FArrayBox>& src = newScal(scal);
+            CH_assert(src.nComp() == 1);
+
+            if (field == s_scal_names[scal]) {
+                src.copyTo(srcComp, a_data, destComp);
+
+                LevelData<FArrayBox> dest;
+                aliasLevelData(dest, &a_data, destComp);
+                m_physBCPtr->addBackgroundScalar(dest, scal, m_time, *m_levGeoPtr);
+                found = true;
+
+            } else if (field == s_scal_names[scal] + "_pert") {
+                src.copyTo(srcComp, a_data, destComp);
+                found = true;
+            }
+        }
+
+        if (!found) {
+            std::ostringstream msg;
+            msg << "Unknown probe field " << field
+                << ". Probes can sample x_Vel, y_Vel, z_Vel, pressure, and each"
+                << " scalar's name with or without the _pert suffix.";
+            MayDay::Error(msg.str().c_str());
+        }
+    }
+}
+
+
+// -----------------------------------------------------------------------------
+// getInSituView
+// Points a_view at this level's state for in-situ analyses. Nothing is copied.
+// -----------------------------------------------------------------------------
+void AMRNavierStokes::getInSituView (InSituLevelView& a_view) const
+{
+    MappedAMRLevel::getInSituView(a_view);
+
+    a_view.levGeoPtr = m_levGeoPtr;
+    if (isEmpty()) return;
+
+    a_view.velPtr = m_vel_new_ptr;
+
+    a_view.scalNames.resize(s_num_scal_comps);
+    a_view.scalPtrs.resize(s_num_scal_comps);
+    for (int scal = 0; scal < s_num_scal_comps; ++scal) {
+        a_view.scalNames[scal] = s_scal_names[scal];
+        a_view.scalPtrs[scal] = m_scal_new[scal];
+    }
+
+    a_view.ccPressurePtr = &m_ccPressure;
+    a_view.syncPressurePtr = &m_syncPressure;
+}
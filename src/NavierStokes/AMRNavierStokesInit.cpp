@@ -77,6 +77,7 @@ void AMRNavierStokes::initialGrid (const Vector<Box>& a_new_grids)
     // Now that we have grids on this level, regrid the levGeo.
     m_levGeoPtr->reset();
     m_levGeoPtr->regrid(grids);
+    m_levGeoPtr->updateMetrics(m_time);
 
     // Next, define all of the data holders.
     // Do velocity first.
@@ -628,6 +629,7 @@ void AMRNavierStokes::levelSetup (const DisjointBoxLayout& a_grids)
     m_levGeoPtr->setFinerPtr(fineLevGeoPtr);
 
     m_levGeoPtr->regrid(a_grids);
+    m_levGeoPtr->updateMetrics(m_time);
     // end set levGeo hierarchy --------------------
 
 
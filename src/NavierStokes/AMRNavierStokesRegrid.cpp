@@ -25,13 +25,18 @@
 #include "AMRNSF_F.H"
 #include "StratUtils.H"
 #include "MappedFineInterp.H"
+#include "LevelDataBundle.H"
 #include "computeMappedNorm.H"
 #include "MappedAMRPoissonOpFactory.H"
 #include "BoxIterator.H"
 #include "AMRCCProjector.H"
 #include "SetValLevel.H"
 #include "ExtrapolationUtils.H"
+#include "ProblemContext.H"
+#include "RunLengthIntVectSet.H"
 #include <iomanip>
+#include <algorithm>
+#include <cmath>
 
 
 // -----------------------------------------------------------------------------
@@ -208,60 +213,21 @@ void AMRNavierStokes::tagCells (IntVectSet& a_tags)
 
     m_vel_new_ptr->exchange();
 
+    // pruneTags needs the priorities that only the mask path records.
+    if (s_bitmap_tagging || !s_tagCriteria.empty() || this->tagsMayBePruned()) {
+        this->tagCellsWithMasks(a_tags);
+        return;
+    }
+
 
     // Tag on vorticity
     // We will tag where ever |vort| / max|vort| >= s_magvort_quota
     // Note that there will always be some portion of the domain that gets
     // tagged -- that's why this is a quota.
     if (s_magvort_tag_quota > 0.0) {
-        DataIterator dit = grids.dataIterator();
-
-#       if CH_SPACEDIM == 2
-            // Compute vorticity
-            LevelData<FArrayBox> magVort(grids, 1);
-            this->computeVorticity(magVort);
-
-            // Compute |vorticity|
-            for (dit.reset(); dit.ok(); ++dit) {
-                FArrayBox& magVortFAB = magVort[dit];
-                const FArrayBox& gdnFAB = m_levGeoPtr->getCCgdn()[dit];
-                const FArrayBox& JinvFAB = m_levGeoPtr->getCCJinv()[dit];
-                const Box region = magVortFAB.box();
-                const int gdnComp = LevelGeometry::symTensorCompCC(SpaceDim-1, SpaceDim-1);
-
-                FORT_TWOFORMMAG2D(
-                    CHF_FRA1(magVortFAB,0),
-                    CHF_CONST_FRA1(magVortFAB,0),
-                    CHF_CONST_FRA1(gdnFAB,gdnComp),
-                    CHF_CONST_FRA1(JinvFAB,0),
-                    CHF_BOX(region));
-            }
-
-#       elif CH_SPACEDIM == 3
-            // Compute vorticity
-            LevelData<FArrayBox> vorticity(grids, 3);
-            this->computeVorticity(vorticity);
-
-            // Compute |vorticity|
-            LevelData<FArrayBox> magVort(grids, 1);
-            for (dit.reset(); dit.ok(); ++dit) {
-                FArrayBox& magVortFAB = magVort[dit];
-                const FArrayBox& vortFAB = vorticity[dit];
-                const Box region = magVortFAB.box();
-                const Real p = 0.5;
-
-                m_levGeoPtr->contractVectors(magVortFAB,
-                                             vortFAB,
-                                             vortFAB,
-                                             dit());
-
-                FORT_POWFAB(CHF_FRA(magVortFAB),
-                            CHF_BOX(region),
-                            CHF_CONST_REAL(p));
-            }
-#       else
-#           Bad SpaceDim
-#       endif
+        // Compute |vorticity|
+        LevelData<FArrayBox> magVort(grids, 1);
+        this->computeMagVorticity(magVort);
 
         // Calculate tagLevel = s_magvort_tag_quota * max|vort|
         Real tagLevel = computeUnmappedNorm(magVort, NULL, *m_levGeoPtr, 0);
@@ -310,7 +276,7 @@ void AMRNavierStokes::tagCells (IntVectSet& a_tags)
                 for (bit.reset(); bit.ok(); ++bit) {
                     const IntVect& cc = bit();
 
-                    if (abs(vort[dit](cc,0)) >= s_vort_tag_tol[2]) {
+                    if (s_vort_tag_tol[2] > 0.0 && abs(vort[dit](cc,0)) >= s_vort_tag_tol[2]) {
                         a_tags |= cc;
                     }
                 }
@@ -321,16 +287,17 @@ void AMRNavierStokes::tagCells (IntVectSet& a_tags)
                 vort[dit].mult(dx[2]*dx[0], 1);
                 vort[dit].mult(dx[0]*dx[1], 2);
 
-                // Tag if |vort| > s_newvort_tag_tol.
+                // Tag if |vort| > s_newvort_tag_tol. Components with a
+                // zero tolerance are skipped.
                 for (bit.reset(); bit.ok(); ++bit) {
                     const IntVect& cc = bit();
 
-                    if (abs(vort[dit](cc,0)) >= s_vort_tag_tol[0]) {
-                        a_tags |= cc;
-                    } else if (abs(vort[dit](cc,1)) >= s_vort_tag_tol[1]) {
-                        a_tags |= cc;
-                    } else if (abs(vort[dit](cc,2)) >= s_vort_tag_tol[2]) {
-                        a_tags |= cc;
+                    for (int comp = 0; comp < 3; ++comp) {
+                        if (s_vort_tag_tol[comp] <= 0.0) continue;
+                        if (abs(vort[dit](cc,comp)) >= s_vort_tag_tol[comp]) {
+                            a_tags |= cc;
+                            break;
+                        }
                     }
                 }
             }
@@ -341,28 +308,7 @@ void AMRNavierStokes::tagCells (IntVectSet& a_tags)
     // Tag on velocity differences
     if (s_vel_tag_tol > 0.0) {
         const LevelData<FArrayBox>& velocity = *m_vel_new_ptr;
-        const RealVect& dx = m_levGeoPtr->getDx();
-
-        LevelData<FArrayBox>& velRef = (LevelData<FArrayBox>&)velocity;
-        LevelData<FluxBox>& JgupRef = (LevelData<FluxBox>&)m_levGeoPtr->getFCJgup();
-        if (s_nu > 0.0) {
-            // Use viscous BCs
-            VelBCHolder velBC(m_physBCPtr->viscousVelFuncBC());
-            velBC.setGhosts(velRef,         // state
-                            NULL,           // extrap
-                            dx,             // dx
-                            &JgupRef,       // JgupPtr
-                            false);         // inhomogeneous
-        } else {
-            // Use inviscid BCs for tracing
-            VelBCHolder velBC(m_physBCPtr->tracingVelFuncBC());
-            velBC.setGhosts(velRef,         // state
-                            NULL,           // extrap
-                            dx,             // dx
-                            &JgupRef,       // JgupPtr
-                            false);         // inhomogeneous
-        }
-        // velRef.exchange();
+        this->setTaggingVelGhosts();
 
         for (DataIterator dit(grids); dit.ok(); ++dit) {
             const Box region = grids[dit];
@@ -480,33 +426,7 @@ void AMRNavierStokes::tagCells (IntVectSet& a_tags)
 
     // Tag on pressure differences
     if (s_pressure_tag_tol > 0.0) {
-        // Change this to false as soon as one reason arises.
-        bool doPresTagging = true;
-
-        // Do nothing if incompressible
-        if (doPresTagging) {
-            if (!s_isIncompressible) {
-                MayDay::Warning("Cannot tag on pressure for a compressible flow");
-                s_pressure_tag_tol = 0.0;
-                doPresTagging = false;
-            }
-        }
-
-        // Has the pressure been properly defined?
-        // I figure if the pressure data holder is defined and compatible with
-        // this level's grids, then we have initialized the pressure field. The
-        // worst case scenario is that pres = 0 everywhere and nothing gets
-        // tagged. At least it's not a seg fault.
-        if (doPresTagging) {
-            if (!m_ccPressure.isDefined()) {
-                doPresTagging = false;
-            }
-        }
-        if (doPresTagging) {
-            if (!m_ccPressure.getBoxes().compatible(grids)) {
-                doPresTagging = false;
-            }
-        }
+        const bool doPresTagging = this->canTagOnPressure();
 
         if (doPresTagging) {
             // iterate on the grids
@@ -537,9 +457,16 @@ void AMRNavierStokes::tagCells (IntVectSet& a_tags)
     } // End tagging on pressure differences
 
 
-    // Grow tags if needed
-    if (s_tags_grow > 0) {
-        a_tags.grow(s_tags_grow);
+    // Anticipate where the tagged features are going.
+    if (s_predictive_tagging) {
+        this->advectTags(a_tags);
+    }
+
+    // Grow tags if needed. This works on whole runs of tags.
+    if (s_tags_grow > 0 && !a_tags.isEmpty()) {
+        RunLengthIntVectSet rleTags(a_tags);
+        rleTags.grow(s_tags_grow * IntVect::Unit);
+        a_tags = rleTags.toIntVectSet();
     }
 
     // This fixes the problem of extrapolating ghosts over a periodic dir.
@@ -572,22 +499,13 @@ void AMRNavierStokes::tagCells (IntVectSet& a_tags)
 
 
     // Vertically extrude tags
-    if (s_vert_extrude_tags) {
+    if (s_vert_extrude_tags && !a_tags.isEmpty()) {
         const int loZ = m_problem_domain.domainBox().smallEnd(SpaceDim-1);
         const int hiZ = m_problem_domain.domainBox().bigEnd  (SpaceDim-1);
 
-        IntVectSet extrudedTags = a_tags;
-
-        IVSIterator ivsit(extrudedTags);
-        for (ivsit.reset(); ivsit.ok(); ++ivsit) {
-            const IntVect& cc = ivsit();
-
-            Box vertStrip(cc,cc);
-            vertStrip.shift(SpaceDim-1, loZ-cc[SpaceDim-1]);
-            vertStrip.setBig(SpaceDim-1, hiZ);
-
-            a_tags |= vertStrip;
-        }
+        RunLengthIntVectSet rleTags(a_tags);
+        rleTags.extrude(SpaceDim-1, loZ, hiZ);
+        a_tags = rleTags.toIntVectSet();
     }
 
     // LEAVE ME ALONE.
@@ -600,6 +518,885 @@ void AMRNavierStokes::tagCells (IntVectSet& a_tags)
 }
 
 
+// -----------------------------------------------------------------------------
+// Adds the cells flagged in a_mask over a_region to a_tags as a union of
+// boxes, one per run of tags along the first direction. If a_extrude is set,
+// a_mask must be flat in the vertical and each run is extruded over [a_loZ,
+// a_hiZ].
+// -----------------------------------------------------------------------------
+static void maskToBoxes (Vector<Box>&        a_boxes,
+                         const BaseFab<int>& a_mask,
+                         const Box&          a_region,
+                         const bool          a_extrude,
+                         const int           a_loZ,
+                         const int           a_hiZ)
+{
+    const int lo = a_region.smallEnd(0);
+    const int hi = a_region.bigEnd(0);
+
+    Box lineBox = a_region;
+    lineBox.setBig(0, lo);
+
+    for (BoxIterator bit(lineBox); bit.ok(); ++bit) {
+        IntVect iv = bit();
+        int runStart = lo - 1;
+
+        for (iv[0] = lo; iv[0] <= hi + 1; ++iv[0]) {
+            const bool isTagged = (iv[0] <= hi && a_mask(iv) != 0);
+
+            if (isTagged && runStart < lo) {
+                runStart = iv[0];
+            } else if (!isTagged && runStart >= lo) {
+                IntVect runLo = iv;
+                runLo[0] = runStart;
+                IntVect runHi = iv;
+                runHi[0] -= 1;
+
+                Box run(runLo, runHi);
+                if (a_extrude) {
+                    run.setSmall(SpaceDim-1, a_loZ);
+                    run.setBig  (SpaceDim-1, a_hiZ);
+                }
+                a_boxes.push_back(run);
+
+                runStart = lo - 1;
+            }
+        }
+    }
+}
+
+
+// -----------------------------------------------------------------------------
+// Returns how many cells a tag moving at a_vel sweeps through in a_sweepTime,
+// rounded to the nearest cell. The sign gives the direction. a_vel is in
+// mapped coordinates, so a_vel / a_dx is in cells per time.
+// -----------------------------------------------------------------------------
+static inline int sweptCells (const Real a_vel,
+                              const Real a_sweepTime,
+                              const Real a_dx)
+{
+    const Real cells = a_vel * a_sweepTime / a_dx;
+    return (cells >= 0.0)? int(floor(cells + 0.5)): -int(floor(0.5 - cells));
+}
+
+
+// -----------------------------------------------------------------------------
+// Finds how many cells any tag in a_valid can sweep through in each
+// direction. a_mask must hold a_valid grown by these extents before
+// sweepMask is called.
+// -----------------------------------------------------------------------------
+static void sweepExtents (IntVect&         a_loExt,
+                          IntVect&         a_hiExt,
+                          const FArrayBox& a_vel,
+                          const Box&       a_valid,
+                          const Real       a_sweepTime,
+                          const RealVect&  a_dx)
+{
+    a_loExt = IntVect::Zero;
+    a_hiExt = IntVect::Zero;
+
+    for (BoxIterator bit(a_valid); bit.ok(); ++bit) {
+        const IntVect& iv = bit();
+        for (int dir = 0; dir < SpaceDim; ++dir) {
+            const int cells = sweptCells(a_vel(iv,dir), a_sweepTime, a_dx[dir]);
+            a_hiExt[dir] = Max(a_hiExt[dir], cells);
+            a_loExt[dir] = Max(a_loExt[dir], -cells);
+        }
+    }
+}
+
+
+// -----------------------------------------------------------------------------
+// Flags every cell of a_mask that a tag in a_valid sweeps through in
+// a_sweepTime, assuming the velocity stays constant. This is advectTags
+// done on a mask. Only the tags in a_valid are swept, as in advectTags.
+// If a_ratioPtr is not NULL, each swept cell is raised to the ratio of the
+// tag that swept through it.
+// -----------------------------------------------------------------------------
+static void sweepMask (BaseFab<int>&    a_mask,
+                       FArrayBox*       a_ratioPtr,
+                       const FArrayBox& a_vel,
+                       const Box&       a_valid,
+                       const Real       a_sweepTime,
+                       const RealVect&  a_dx)
+{
+    // Swept cells must not be swept again.
+    BaseFab<int> srcMask(a_valid, 1);
+    srcMask.copy(a_mask);
+
+    FArrayBox srcRatio;
+    if (a_ratioPtr != NULL) {
+        srcRatio.define(a_valid, 1);
+        srcRatio.copy(*a_ratioPtr);
+    }
+
+    for (BoxIterator bit(a_valid); bit.ok(); ++bit) {
+        const IntVect& iv = bit();
+        if (srcMask(iv) == 0) continue;
+
+        IntVect lo = iv;
+        IntVect hi = iv;
+        for (int dir = 0; dir < SpaceDim; ++dir) {
+            const int cells = sweptCells(a_vel(iv,dir), a_sweepTime, a_dx[dir]);
+            if (cells > 0) {
+                hi[dir] += cells;
+            } else {
+                lo[dir] += cells;
+            }
+        }
+
+        if (lo == iv && hi == iv) continue;
+
+        const Box sweptBox(lo, hi);
+        a_mask.setVal(1, sweptBox, 0);
+
+        if (a_ratioPtr != NULL) {
+            FArrayBox& ratio = *a_ratioPtr;
+            const Real srcVal = srcRatio(iv);
+            for (BoxIterator sbit(sweptBox); sbit.ok(); ++sbit) {
+                ratio(sbit()) = Max(ratio(sbit()), srcVal);
+            }
+        }
+    }
+}
+
+
+// -----------------------------------------------------------------------------
+// The bitmap version of tagCells. This produces the same tags as the
+// IntVectSet path, but each criterion is evaluated by a kernel into a
+// per-box mask. Sweeping, growing and extruding are done on the masks as
+// well, in the same order as tagCells, so a_tags is only touched once per run
+// of tagged cells.
+// The registered (per-level) criteria are only evaluated here.
+// -----------------------------------------------------------------------------
+void AMRNavierStokes::tagCellsWithMasks (IntVectSet& a_tags)
+{
+    CH_TIME("AMRNavierStokes::tagCellsWithMasks");
+
+    const DisjointBoxLayout& grids = newVel().getBoxes();
+    DataIterator dit = grids.dataIterator();
+    const RealVect& dx = m_levGeoPtr->getDx();
+    const int loZ = m_problem_domain.domainBox().smallEnd(SpaceDim-1);
+    const int hiZ = m_problem_domain.domainBox().bigEnd  (SpaceDim-1);
+
+    // Do all of the level-wide work (BCs, exchanges, norms) up front so
+    // that the box loop below only calls kernels.
+
+    // The tolerances of the registered criteria on this level.
+    // Criteria that are off on this level get a zero tolerance.
+    const int numCriteria = s_tagCriteria.size();
+    std::vector<Real> critTol(numCriteria, 0.0);
+    bool critNeedsVort = false;
+    bool doRichardson = false;
+
+    for (int c = 0; c < numCriteria; ++c) {
+        critTol[c] = s_tagCriteria[c].tolerance(m_level);
+        if (critTol[c] <= 0.0) continue;
+
+        if (s_tagCriteria[c].type == TagCriterion::Type::VORTQUOTA) {
+            critNeedsVort = true;
+        } else if (s_tagCriteria[c].type == TagCriterion::Type::RICHARDSON) {
+            doRichardson = true;
+        }
+    }
+
+    // Gather the fields needed by the registered criteria into one holder
+    // with a ghost layer. The Richardson fields come first so that the
+    // horizontal velocity comps are contiguous.
+    std::vector<std::string> critFields;
+    std::vector<int> critComp(numCriteria, -1);
+    const char* velNames[] = {"x_Vel", "y_Vel", "z_Vel"};
+    int richBComp = -1;
+
+    if (doRichardson) {
+        if (s_num_scal_comps == 0) {
+            MayDay::Error("The richardson tagging criterion needs a buoyancy field");
+        }
+        for (int dir = 0; dir < SpaceDim-1; ++dir) {
+            critFields.push_back(velNames[dir]);
+        }
+        richBComp = critFields.size();
+        critFields.push_back(s_scal_names[0]);
+    }
+
+    for (int c = 0; c < numCriteria; ++c) {
+        if (critTol[c] <= 0.0) continue;
+
+        const int type = s_tagCriteria[c].type;
+        if (type != TagCriterion::Type::GRADIENT &&
+            type != TagCriterion::Type::UNDIVIDED) continue;
+
+        const std::string& field = s_tagCriteria[c].field;
+        for (int f = 0; f < int(critFields.size()); ++f) {
+            if (critFields[f] == field) critComp[c] = f;
+        }
+        if (critComp[c] < 0) {
+            critComp[c] = critFields.size();
+            critFields.push_back(field);
+        }
+    }
+
+    LevelData<FArrayBox> critData;
+    if (critFields.size() > 0) {
+        LevelData<FArrayBox> probeData;
+        this->getProbeData(probeData, critFields);
+
+        critData.define(grids, critFields.size(), IntVect::Unit);
+        probeData.copyTo(critData);
+        extrapAllGhosts(critData);
+        critData.exchange();
+    }
+
+    const Box& baseDomain = ProblemContext::getInstance()->domain.domainBox();
+
+    // |vort| >= s_magvort_tag_quota * max|vort|
+    LevelData<FArrayBox> magVort;
+    Real maxMagVort = 0.0;
+    Real magVortTol = 0.0;
+    if (s_magvort_tag_quota > 0.0 || critNeedsVort) {
+        magVort.define(grids, 1);
+        this->computeMagVorticity(magVort);
+
+        maxMagVort = Abs(computeUnmappedNorm(magVort, NULL, *m_levGeoPtr, 0));
+        magVortTol = maxMagVort * Max(s_magvort_tag_quota, 0.0);
+    }
+
+    // |vort[dir]*dA[dir]| >= s_vort_tag_tol[dir]
+    // Rather than scaling vort, we divide the tolerances by dA.
+    const bool doVortTagging = (s_vort_tag_tol[0] + s_vort_tag_tol[1] + s_vort_tag_tol[2] > 0.0);
+    LevelData<FArrayBox> vort;
+    Tuple<Real,3> vortTol;
+    if (doVortTagging) {
+        vort.define(grids, D_TERM(0,+1,+2));
+        this->computeVorticity(vort);
+
+        if (CH_SPACEDIM == 2) {
+            vortTol[0] = s_vort_tag_tol[2] / (dx[0]*dx[1]);
+        } else {
+            vortTol[0] = s_vort_tag_tol[0] / (dx[1]*dx[SpaceDim-1]);
+            vortTol[1] = s_vort_tag_tol[1] / (dx[SpaceDim-1]*dx[0]);
+            vortTol[2] = s_vort_tag_tol[2] / (dx[0]*dx[1]);
+        }
+    }
+
+    // Velocity differences
+    const bool doVelTagging = (s_vel_tag_tol > 0.0);
+    if (doVelTagging) {
+        this->setTaggingVelGhosts();
+    }
+
+    // Buoyancy differences
+    const bool doBuoyancyTagging = (s_buoyancy_tag_tol > 0.0 && s_num_scal_comps > 0);
+    LevelData<FArrayBox> buoyancy;
+    if (doBuoyancyTagging) {
+        CH_assert(m_scal_new[0] != NULL);
+        this->fillScalars(buoyancy, m_time, 0);
+    }
+
+    // Pressure differences
+    const bool doPresTagging = (s_pressure_tag_tol > 0.0 && this->canTagOnPressure());
+
+    // Predictive tagging
+    const Real sweepTime = this->tagSweepTime();
+
+    // If these tags may be pruned, keep each tag's strongest criterion
+    // response for pruneTags.
+    if (m_tagPriorityPtr != NULL) {
+        delete m_tagPriorityPtr;
+        m_tagPriorityPtr = NULL;
+    }
+    if (this->tagsMayBePruned()) {
+        m_tagPriorityPtr = new LayoutData<FArrayBox>(grids);
+    }
+
+    Vector<Box> tagBoxes;
+    for (dit.reset(); dit.ok(); ++dit) {
+        const Box& valid = grids[dit];
+
+        // The undivided differences tag one cell beyond the valid region.
+        // The valid tags may then be swept downstream...
+        Box tagRegion = grow(valid, 1);
+        if (sweepTime > 0.0) {
+            IntVect loExt, hiExt;
+            sweepExtents(loExt, hiExt, (*m_vel_new_ptr)[dit], valid, sweepTime, dx);
+            for (int dir = 0; dir < SpaceDim; ++dir) {
+                tagRegion.growLo(dir, loExt[dir]);
+                tagRegion.growHi(dir, hiExt[dir]);
+            }
+        }
+
+        // ...and all of them are grown by s_tags_grow.
+        const Box maskBox = grow(tagRegion, s_tags_grow);
+
+        BaseFab<int> mask(maskBox, 1);
+        mask.setVal(0);
+
+        // Each criterion's response relative to its tolerance.
+        FArrayBox ratio(maskBox, 1);
+        ratio.setVal(0.0);
+
+        if (magVortTol > 0.0) {
+            FORT_TAGABOVETOL(CHF_FIA1(mask,0),
+                             CHF_FRA1(ratio,0),
+                             CHF_CONST_FRA1(magVort[dit],0),
+                             CHF_CONST_REAL(magVortTol),
+                             CHF_BOX(valid));
+        }
+
+        if (doVortTagging) {
+            for (int comp = 0; comp < vort.nComp(); ++comp) {
+                if (vortTol[comp] <= 0.0) continue;
+
+                FORT_TAGABOVETOL(CHF_FIA1(mask,0),
+                                 CHF_FRA1(ratio,0),
+                                 CHF_CONST_FRA1(vort[dit],comp),
+                                 CHF_CONST_REAL(vortTol[comp]),
+                                 CHF_BOX(valid));
+            }
+        }
+
+        for (int idir = 0; idir < SpaceDim; ++idir) {
+            // The tags are made at the faces adjoining two cells.
+            // Alter region so it is essentially FC.
+            Box diffRegion = valid;
+            diffRegion.growHi(idir, 1);
+
+            if (doVelTagging) {
+                const FArrayBox& velFAB = (*m_vel_new_ptr)[dit];
+                for (int comp = 0; comp < SpaceDim; ++comp) {
+                    FORT_TAGUNDIVDIFF(CHF_FIA1(mask,0),
+                                      CHF_FRA1(ratio,0),
+                                      CHF_CONST_FRA1(velFAB,comp),
+                                      CHF_CONST_REAL(s_vel_tag_tol),
+                                      CHF_CONST_INT(idir),
+                                      CHF_BOX(diffRegion));
+                }
+            }
+
+            if (doBuoyancyTagging) {
+                FORT_TAGUNDIVDIFF(CHF_FIA1(mask,0),
+                                  CHF_FRA1(ratio,0),
+                                  CHF_CONST_FRA1(buoyancy[dit],0),
+                                  CHF_CONST_REAL(s_buoyancy_tag_tol),
+                                  CHF_CONST_INT(idir),
+                                  CHF_BOX(diffRegion));
+            }
+
+            if (doPresTagging) {
+                FORT_TAGUNDIVDIFF(CHF_FIA1(mask,0),
+                                  CHF_FRA1(ratio,0),
+                                  CHF_CONST_FRA1(m_ccPressure[dit],0),
+                                  CHF_CONST_REAL(s_pressure_tag_tol),
+                                  CHF_CONST_INT(idir),
+                                  CHF_BOX(diffRegion));
+            }
+        }
+
+        // The registered criteria
+        for (int c = 0; c < numCriteria; ++c) {
+            const Real tol = critTol[c];
+            if (tol <= 0.0) continue;
+
+            const TagCriterion& crit = s_tagCriteria[c];
+
+            switch (crit.type) {
+            case TagCriterion::Type::GRADIENT:
+                FORT_TAGGRADIENT(CHF_FIA1(mask,0),
+                                 CHF_FRA1(ratio,0),
+                                 CHF_CONST_FRA1(critData[dit],critComp[c]),
+                                 CHF_CONST_REALVECT(dx),
+                                 CHF_CONST_REAL(tol),
+                                 CHF_BOX(valid));
+                break;
+
+            case TagCriterion::Type::UNDIVIDED:
+                for (int idir = 0; idir < SpaceDim; ++idir) {
+                    Box diffRegion = valid;
+                    diffRegion.growHi(idir, 1);
+
+                    FORT_TAGUNDIVDIFF(CHF_FIA1(mask,0),
+                                      CHF_FRA1(ratio,0),
+                                      CHF_CONST_FRA1(critData[dit],critComp[c]),
+                                      CHF_CONST_REAL(tol),
+                                      CHF_CONST_INT(idir),
+                                      CHF_BOX(diffRegion));
+                }
+                break;
+
+            case TagCriterion::Type::VORTQUOTA:
+                {
+                    const Real vortTol = tol * maxMagVort;
+                    if (vortTol > 0.0) {
+                        FORT_TAGABOVETOL(CHF_FIA1(mask,0),
+                                         CHF_FRA1(ratio,0),
+                                         CHF_CONST_FRA1(magVort[dit],0),
+                                         CHF_CONST_REAL(vortTol),
+                                         CHF_BOX(valid));
+                    }
+                }
+                break;
+
+            case TagCriterion::Type::RICHARDSON:
+                {
+                    const GeoSourceInterface& geoSource = *(m_levGeoPtr->getGeoSourcePtr());
+                    MapTimeScope mapTime(*m_levGeoPtr);
+                    FArrayBox dXidzFAB(valid, SpaceDim);
+                    for (int dir = 0; dir < SpaceDim; ++dir) {
+                        geoSource.fill_dXidx(dXidzFAB,
+                                             dir,           // fab comp
+                                             dir,           // Xi index
+                                             SpaceDim-1,    // z index
+                                             dx);
+                    }
+
+                    FArrayBox uhFAB(Interval(0, SpaceDim-2), critData[dit]);
+
+                    FORT_TAGRICHARDSON(CHF_FIA1(mask,0),
+                                       CHF_CONST_FRA1(critData[dit],richBComp),
+                                       CHF_CONST_FRA(uhFAB),
+                                       CHF_CONST_FRA(dXidzFAB),
+                                       CHF_CONST_REALVECT(dx),
+                                       CHF_CONST_REAL(tol),
+                                       CHF_BOX(valid));
+                }
+                break;
+
+            case TagCriterion::Type::REGION:
+                {
+                    Box regionBox = crit.region(m_problem_domain.domainBox(), baseDomain);
+                    regionBox &= valid;
+                    if (!regionBox.isEmpty()) {
+                        mask.setVal(1, regionBox, 0);
+                    }
+                }
+                break;
+
+            default:
+                MayDay::Error("tagCellsWithMasks received a bad tagging criterion type");
+            }
+        }
+
+        // The criteria without a tolerance to compare against (REGION and
+        // RICHARDSON) rank their tags at 1, the weakest a tag can be.
+        FArrayBox* ratioPtr = NULL;
+        if (m_tagPriorityPtr != NULL) {
+            for (BoxIterator bit(maskBox); bit.ok(); ++bit) {
+                const IntVect& iv = bit();
+                if (mask(iv) != 0) ratio(iv) = Max(ratio(iv), Real(1.0));
+            }
+            ratioPtr = &ratio;
+        }
+
+        // Anticipate where the tagged features are going. The swept cells
+        // take the rank of the tags they were swept from.
+        if (sweepTime > 0.0) {
+            sweepMask(mask, ratioPtr, (*m_vel_new_ptr)[dit], valid, sweepTime, dx);
+        }
+
+        if (m_tagPriorityPtr != NULL) {
+            FArrayBox& prioFAB = (*m_tagPriorityPtr)[dit];
+            prioFAB.define(maskBox, 1);
+            prioFAB.copy(ratio);
+        }
+
+        // Grow tags one direction at a time.
+        if (s_tags_grow > 0) {
+            BaseFab<int> srcMask(maskBox, 1);
+
+            for (int idir = 0; idir < SpaceDim; ++idir) {
+                srcMask.copy(mask, tagRegion);
+
+                FORT_TAGDILATE(CHF_FIA1(mask,0),
+                               CHF_CONST_FIA1(srcMask,0),
+                               CHF_CONST_INT(idir),
+                               CHF_CONST_INT(s_tags_grow),
+                               CHF_BOX(tagRegion));
+
+                tagRegion.grow(idir, s_tags_grow);
+            }
+        }
+
+        // Convert to boxes, vertically extruding if needed.
+        if (s_vert_extrude_tags) {
+            Box flatBox = tagRegion;
+            flatBox.setBig(SpaceDim-1, flatBox.smallEnd(SpaceDim-1));
+
+            BaseFab<int> flatMask(flatBox, 1);
+            flatMask.setVal(0);
+
+            FORT_TAGCOLLAPSE(CHF_FIA1(flatMask,0),
+                             CHF_CONST_FIA1(mask,0),
+                             CHF_BOX(tagRegion));
+
+            maskToBoxes(tagBoxes, flatMask, flatBox, true, loZ, hiZ);
+        } else {
+            maskToBoxes(tagBoxes, mask, tagRegion, false, loZ, hiZ);
+        }
+    } // end loop over grids (dit)
+
+    // This is the only place we touch the IntVectSet.
+    for (int idx = 0; idx < tagBoxes.size(); ++idx) {
+        a_tags |= tagBoxes[idx];
+    }
+
+    // Mirror the tags across periodic boundaries. See tagCells. This
+    // commutes with the vertical extrusion, so doing it last is fine.
+    for (int dir = 0; dir < SpaceDim; ++dir) {
+        if (!m_problem_domain.isPeriodic(dir)) continue;
+
+        SideIterator sit;
+        for (sit.reset(); sit.ok(); ++sit) {
+            const Side::LoHiSide iside = sit();
+            const int isign = sign(iside);
+            const Box& domBox = m_problem_domain.domainBox();
+
+            Box ccBdry = bdryBox(domBox, dir, iside, 1);
+            ccBdry.shiftHalf(dir, -isign);
+
+            IntVectSet bdryTags = ccBdry & a_tags;
+            bdryTags.shift(BASISV(dir) * (domBox.sideEnd(flip(iside))[dir] - ccBdry.smallEnd(dir)));
+            a_tags |= bdryTags;
+        }
+    }
+
+    // See the note at the end of tagCells.
+    a_tags &= m_problem_domain;
+}
+
+
+// -----------------------------------------------------------------------------
+// Adds the cells that each tag will sweep through before this level
+// regrids again, assuming the local velocity stays constant.
+// -----------------------------------------------------------------------------
+void AMRNavierStokes::advectTags (IntVectSet& a_tags) const
+{
+    CH_TIME("AMRNavierStokes::advectTags");
+
+    const Real sweepTime = this->tagSweepTime();
+    if (sweepTime <= 0.0) return;
+
+    const RealVect& dx = m_levGeoPtr->getDx();
+    const DisjointBoxLayout& grids = m_vel_new_ptr->getBoxes();
+
+    // Each tag sweeps a straight path. We add the path's bounding box.
+    Vector<Box> sweptBoxes;
+    DataIterator dit = grids.dataIterator();
+    for (dit.reset(); dit.ok(); ++dit) {
+        const FArrayBox& velFAB = (*m_vel_new_ptr)[dit];
+        const Box& valid = grids[dit];
+
+        IntVectSet localTags = a_tags & valid;
+        IVSIterator ivsit(localTags);
+        for (ivsit.reset(); ivsit.ok(); ++ivsit) {
+            const IntVect& iv = ivsit();
+
+            IntVect lo = iv;
+            IntVect hi = iv;
+            for (int dir = 0; dir < SpaceDim; ++dir) {
+                const int cells = sweptCells(velFAB(iv,dir), sweepTime, dx[dir]);
+                if (cells > 0) {
+                    hi[dir] += cells;
+                } else {
+                    lo[dir] += cells;
+                }
+            }
+
+            if (lo != iv || hi != iv) {
+                sweptBoxes.push_back(Box(lo, hi));
+            }
+        }
+    }
+
+    for (int idx = 0; idx < sweptBoxes.size(); ++idx) {
+        a_tags |= sweptBoxes[idx];
+    }
+    a_tags &= m_problem_domain;
+}
+
+
+// -----------------------------------------------------------------------------
+// How long the new grids need to hold this level's tags, or zero if the
+// tags should not be swept. See advectTags.
+// -----------------------------------------------------------------------------
+Real AMRNavierStokes::tagSweepTime () const
+{
+    if (!s_predictive_tagging) return 0.0;
+
+    const Vector<int>& regridIntervals = ProblemContext::getInstance()->regrid_intervals;
+    if (m_level >= regridIntervals.size()) return 0.0;
+    if (regridIntervals[m_level] <= 0) return 0.0;
+
+    return Max(Real(regridIntervals[m_level]) * m_dt, 0.0);
+}
+
+
+// -----------------------------------------------------------------------------
+// Will LepticAMR prune this level's tags to fit a cell budget? If so,
+// tagCellsWithMasks keeps the priority field that pruneTags needs.
+// -----------------------------------------------------------------------------
+bool AMRNavierStokes::tagsMayBePruned () const
+{
+    return (this->cellBudget() > 0.0);
+}
+
+
+// -----------------------------------------------------------------------------
+// Returns the strongest priority within a_grow cells of a_iv (or in its
+// column, if a_extrude is set) that a_prioFAB holds, or a negative value if
+// a_prioFAB holds none of them.
+// -----------------------------------------------------------------------------
+static Real tagRank (const FArrayBox& a_prioFAB,
+                     const IntVect&   a_iv,
+                     const int        a_grow,
+                     const bool       a_extrude)
+{
+    const Box& prioBox = a_prioFAB.box();
+
+    Box window(a_iv, a_iv);
+    window.grow(a_grow);
+    if (a_extrude) {
+        window.setSmall(SpaceDim-1, prioBox.smallEnd(SpaceDim-1));
+        window.setBig  (SpaceDim-1, prioBox.bigEnd  (SpaceDim-1));
+    }
+    window &= prioBox;
+    if (window.isEmpty()) return -1.0;
+
+    return a_prioFAB.max(window, 0);
+}
+
+
+// -----------------------------------------------------------------------------
+// Used to look up tags by cell.
+// -----------------------------------------------------------------------------
+struct TagLT {
+    bool operator() (const IntVect& a_lhs, const IntVect& a_rhs) const {
+        return a_lhs.lexLT(a_rhs);
+    }
+};
+
+
+// -----------------------------------------------------------------------------
+// Drops this level's weakest tags until at most a_maxTags remain over all
+// ranks. A tag is ranked by the strongest criterion response that
+// tagCellsWithMasks recorded within s_tags_grow cells of it (or in its
+// column, if the tags are extruded), so a grown tag is as strong as the tag
+// it was grown from, and a swept tag as strong as the tag that swept it.
+// Each box's priorities cover its whole mask, so every tag this rank made
+// is ranked, once, by the strongest box that reaches it. Tags from
+// elsewhere (mirrored tags or old tags added by the caller) are not ranked
+// and are always kept. The ranks agree on a single cutoff by bisection.
+// -----------------------------------------------------------------------------
+void AMRNavierStokes::pruneTags (IntVectSet& a_tags, long long a_maxTags)
+{
+    CH_TIME("AMRNavierStokes::pruneTags");
+
+    const DisjointBoxLayout& grids = newVel().getBoxes();
+    DataIterator dit = grids.dataIterator();
+    const int grow = Max(s_tags_grow, 0);
+    const Box& domBox = m_problem_domain.domainBox();
+
+    // pruneTags runs on every rank, so they must all agree to give up.
+    int havePriority = (m_tagPriorityPtr != NULL && m_tagPriorityPtr->boxLayout() == grids)? 1: 0;
+#ifdef CH_MPI
+    {
+        int localHavePriority = havePriority;
+        MPI_Allreduce(&localHavePriority, &havePriority, 1, MPI_INT, MPI_MIN, Chombo_MPI::comm);
+    }
+#endif
+    if (havePriority == 0) {
+        if (s_verbosity >= 1) {
+            pout() << "AMRNavierStokes::pruneTags: level " << m_level
+                   << " has no tag priorities. Leaving the tags alone." << endl;
+        }
+        return;
+    }
+
+    const LayoutData<FArrayBox>& priority = *m_tagPriorityPtr;
+
+    // Rank each tag by the strongest box that reaches it.
+    typedef std::map<IntVect, Real, TagLT> RankMap;
+    RankMap tagRanks;
+
+    for (dit.reset(); dit.ok(); ++dit) {
+        const FArrayBox& prioFAB = priority[dit];
+
+        Box searchBox = prioFAB.box();
+        if (s_vert_extrude_tags) {
+            searchBox.setSmall(SpaceDim-1, domBox.smallEnd(SpaceDim-1));
+            searchBox.setBig  (SpaceDim-1, domBox.bigEnd  (SpaceDim-1));
+        }
+
+        IntVectSet localTags = a_tags & searchBox;
+        IVSIterator ivsit(localTags);
+        for (ivsit.reset(); ivsit.ok(); ++ivsit) {
+            const Real rank = tagRank(prioFAB, ivsit(), grow, s_vert_extrude_tags);
+            if (rank < 0.0) continue;
+
+            RankMap::iterator it = tagRanks.find(ivsit());
+            if (it == tagRanks.end()) {
+                tagRanks[ivsit()] = rank;
+            } else {
+                it->second = Max(it->second, rank);
+            }
+        }
+    }
+
+    // Find the smallest cutoff that keeps at most a_maxTags, counting the
+    // unranked tags, which are always kept.
+    std::vector<Real> sortedPriority;
+    sortedPriority.reserve(tagRanks.size());
+    for (RankMap::const_iterator it = tagRanks.begin(); it != tagRanks.end(); ++it) {
+        sortedPriority.push_back(it->second);
+    }
+    std::sort(sortedPriority.begin(), sortedPriority.end());
+
+    Real maxPriority = (sortedPriority.empty()? 0.0: sortedPriority.back());
+    long long numUnranked = (long long)a_tags.numPts() - (long long)tagRanks.size();
+#ifdef CH_MPI
+    {
+        Real localMax = maxPriority;
+        MPI_Allreduce(&localMax, &maxPriority, 1, MPI_CH_REAL, MPI_MAX, Chombo_MPI::comm);
+
+        long long localNumUnranked = numUnranked;
+        MPI_Allreduce(&localNumUnranked, &numUnranked, 1, MPI_LONG_LONG, MPI_SUM, Chombo_MPI::comm);
+    }
+#endif
+
+    if (numUnranked > a_maxTags) {
+        pout() << "AMRNavierStokes::pruneTags: level " << m_level << " has "
+               << numUnranked << " tags that cannot be ranked, more than the "
+               << a_maxTags << " allowed. The budget will be exceeded." << endl;
+        MayDay::Warning("AMRNavierStokes::pruneTags: the unranked tags exceed the cell budget");
+    }
+
+    if (maxPriority <= 0.0) {
+        if (s_verbosity >= 1) {
+            pout() << "AMRNavierStokes::pruneTags: level " << m_level
+                   << " has no ranked tags. Leaving the tags alone." << endl;
+        }
+        return;
+    }
+
+    Real loCutoff = 0.0;
+    Real hiCutoff = maxPriority * (1.0 + 1.0e-6);
+    for (int iter = 0; iter < 64; ++iter) {
+        const Real cutoff = 0.5 * (loCutoff + hiCutoff);
+
+        long long numKept = sortedPriority.end()
+            - std::lower_bound(sortedPriority.begin(), sortedPriority.end(), cutoff);
+#ifdef CH_MPI
+        long long localNumKept = numKept;
+        MPI_Allreduce(&localNumKept, &numKept, 1, MPI_LONG_LONG, MPI_SUM, Chombo_MPI::comm);
+#endif
+
+        if (numKept + numUnranked > a_maxTags) {
+            loCutoff = cutoff;
+        } else {
+            hiCutoff = cutoff;
+        }
+        if (hiCutoff - loCutoff <= 1.0e-6 * hiCutoff) break;
+    }
+
+    // Rebuild the tags from the survivors and the unranked tags.
+    IntVectSet keptTags;
+    IVSIterator ivsit(a_tags);
+    for (ivsit.reset(); ivsit.ok(); ++ivsit) {
+        RankMap::const_iterator it = tagRanks.find(ivsit());
+        if (it == tagRanks.end() || it->second >= hiCutoff) {
+            keptTags |= ivsit();
+        }
+    }
+    a_tags = keptTags;
+
+    if (s_verbosity >= 2) {
+        pout() << "AMRNavierStokes::pruneTags: level " << m_level
+               << " kept tags with priority >= " << hiCutoff
+               << " and " << numUnranked << " unranked tags" << endl;
+    }
+}
+
+
+// -----------------------------------------------------------------------------
+// Adds a criterion to the tagging registry. The tag.* criteria from the
+// input file are registered during setup.
+// -----------------------------------------------------------------------------
+void AMRNavierStokes::addTagCriterion (const TagCriterion& a_crit)
+{
+    CH_assert(0 <= a_crit.type && a_crit.type < TagCriterion::Type::_NUM_TYPES);
+    s_tagCriteria.push_back(a_crit);
+}
+
+
+// -----------------------------------------------------------------------------
+// Sets the velocity ghosts needed by the velocity difference criterion.
+// -----------------------------------------------------------------------------
+void AMRNavierStokes::setTaggingVelGhosts ()
+{
+    const RealVect& dx = m_levGeoPtr->getDx();
+
+    LevelData<FArrayBox>& velRef = *m_vel_new_ptr;
+    LevelData<FluxBox>& JgupRef = (LevelData<FluxBox>&)m_levGeoPtr->getFCJgup();
+    if (s_nu > 0.0) {
+        // Use viscous BCs
+        VelBCHolder velBC(m_physBCPtr->viscousVelFuncBC());
+        velBC.setGhosts(velRef,         // state
+                        NULL,           // extrap
+                        dx,             // dx
+                        &JgupRef,       // JgupPtr
+                        false);         // inhomogeneous
+    } else {
+        // Use inviscid BCs for tracing
+        VelBCHolder velBC(m_physBCPtr->tracingVelFuncBC());
+        velBC.setGhosts(velRef,         // state
+                        NULL,           // extrap
+                        dx,             // dx
+                        &JgupRef,       // JgupPtr
+                        false);         // inhomogeneous
+    }
+    // velRef.exchange();
+}
+
+
+// -----------------------------------------------------------------------------
+// Returns false (and may turn off s_pressure_tag_tol) if the pressure
+// cannot be used for tagging.
+// -----------------------------------------------------------------------------
+bool AMRNavierStokes::canTagOnPressure ()
+{
+    const DisjointBoxLayout& grids = newVel().getBoxes();
+
+    // Change this to false as soon as one reason arises.
+    bool doPresTagging = true;
+
+    // Do nothing if incompressible
+    if (doPresTagging) {
+        if (!s_isIncompressible) {
+            MayDay::Warning("Cannot tag on pressure for a compressible flow");
+            s_pressure_tag_tol = 0.0;
+            doPresTagging = false;
+        }
+    }
+
+    // Has the pressure been properly defined?
+    // I figure if the pressure data holder is defined and compatible with
+    // this level's grids, then we have initialized the pressure field. The
+    // worst case scenario is that pres = 0 everywhere and nothing gets
+    // tagged. At least it's not a seg fault.
+    if (doPresTagging) {
+        if (!m_ccPressure.isDefined()) {
+            doPresTagging = false;
+        }
+    }
+    if (doPresTagging) {
+        if (!m_ccPressure.getBoxes().compatible(grids)) {
+            doPresTagging = false;
+        }
+    }
+
+    return doPresTagging;
+}
+
+
 // -----------------------------------------------------------------------------
 // Perform any pre-regridding ops -- lBase is the finest unchanged level.
 // This function will be called from the finest level downward to a_lBase.
@@ -608,7 +1405,59 @@ void AMRNavierStokes::tagCells (IntVectSet& a_tags)
 // -----------------------------------------------------------------------------
 void AMRNavierStokes::preRegrid (int a_lBase, const Vector<Vector<Box> >& a_newGrids)
 {
-    // Do nothing.
+    // Everything happens on lBase, which is called last.
+    if (m_level != a_lBase) return;
+    if (!s_smooth_after_regrid) return;
+
+    CH_TIME("AMRNavierStokes::preRegrid");
+
+    // Find the first level whose grids change. The new grids are not in
+    // Morton order yet, so compare sorted copies.
+    m_regrid_smoothing_base = -1;
+    bool firstChangeIsRemoval = false;
+
+    AMRNavierStokes* levPtr = this->fineNSPtr();
+    while (levPtr != NULL) {
+        const int lev = levPtr->m_level;
+
+        Vector<Box> newGrids;
+        if (lev < a_newGrids.size()) newGrids = a_newGrids[lev];
+        Vector<Box> oldGrids = levPtr->m_level_grids;
+        if (levPtr->isEmpty()) oldGrids.resize(0);
+
+        std::sort(newGrids.stdVector().begin(), newGrids.stdVector().end());
+        std::sort(oldGrids.stdVector().begin(), oldGrids.stdVector().end());
+
+        if (newGrids.stdVector() != oldGrids.stdVector()) {
+            m_regrid_smoothing_base = lev - 1;
+            firstChangeIsRemoval = (newGrids.size() == 0);
+            break;
+        }
+
+        levPtr = levPtr->fineNSPtr();
+    }
+
+    // Smoothing only matters where new data was interpolated.
+    if (firstChangeIsRemoval) m_regrid_smoothing_base = -1;
+
+    if (s_verbosity >= 4) {
+        if (m_regrid_smoothing_base < 0) {
+            pout() << "Post-regrid smoothing is not needed." << endl;
+        } else if (m_regrid_smoothing_base > a_lBase) {
+            pout() << "Levels " << a_lBase + 1 << " to " << m_regrid_smoothing_base
+                   << " are unchanged and will not be smoothed." << endl;
+        }
+    }
+
+    // Set up the smoother while the old data is still around.
+    if (m_regrid_smoothing_base >= 0) {
+        AMRNavierStokes* baseNSPtr = this;
+        while (baseNSPtr->m_level < m_regrid_smoothing_base) {
+            baseNSPtr = baseNSPtr->fineNSPtr();
+        }
+        CH_assert(baseNSPtr->m_regrid_smoothing_done == false);
+        baseNSPtr->setupPostRegridSmoothing(m_regrid_smoothing_base);
+    }
 }
 
 
@@ -666,15 +1515,6 @@ void AMRNavierStokes::regrid (const Vector<Box>& a_new_grids)
         crseNSPtr()->finestLevel(false);
 
 
-        if (s_smooth_after_regrid) {
-            AMRNavierStokes* baseNSPtr = this;
-            if (m_level > 0) baseNSPtr = baseNSPtr->crseNSPtr();
-
-            if (baseNSPtr->m_regrid_smoothing_done == false) {
-                baseNSPtr->setupPostRegridSmoothing(baseNSPtr->m_level);
-            }
-        }
-
         // since we're using pointers here, it's easy to save old
         // data -- then clean up afterwards
         LevelData<FArrayBox>* old_newVelPtr = m_vel_new_ptr;
@@ -690,6 +1530,17 @@ void AMRNavierStokes::regrid (const Vector<Box>& a_new_grids)
             old_newScals[comp] = m_scal_new[comp];
         }
 
+        // The running statistics are only remapped if some level has them.
+        LevelData<FArrayBox>* old_statsPtr = m_stats_ptr;
+        const LevelData<FArrayBox>* crseStatsPtr = NULL;
+        if (m_level > 0) crseStatsPtr = crseNSPtr()->m_stats_ptr;
+
+        m_stats_ptr = NULL;
+        if (old_statsPtr != NULL || crseStatsPtr != NULL) {
+            m_stats_ptr = new LevelData<FArrayBox>(grids, numStatsComps());
+            setValLevel(*m_stats_ptr, 0.0);
+        }
+
         // reshape state with new grids
         IntVect ghostVect(D_DECL(1,1,1));
         m_vel_new_ptr = new LevelData<FArrayBox>(grids, CH_SPACEDIM, ghostVect);
@@ -728,59 +1579,81 @@ void AMRNavierStokes::regrid (const Vector<Box>& a_new_grids)
             const IntVect& nRefCrse = amrns_ptr->m_ref_ratio;
             const bool considerCellVols = true;
 
-            { // velocity
-                MappedFineInterp fine_interp(grids, CH_SPACEDIM, nRefCrse, m_problem_domain,
-                                             m_levGeoPtr,
-                                             considerCellVols);
-                fine_interp.interpToFine(newVel(), amrns_ptr->newVel());
-                fine_interp.interpToFine(oldVel(), amrns_ptr->oldVel());
+            // Interpolate every field at once. This needs one Copier and one
+            // message per pair of ranks instead of one per field.
+            LevelDataBundle fineBundle, crseBundle;
+
+            fineBundle.add(&newVel());
+            crseBundle.add(&amrns_ptr->newVel());
+            fineBundle.add(&oldVel());
+            crseBundle.add(&amrns_ptr->oldVel());
+            fineBundle.add(&newLambda());
+            crseBundle.add(&amrns_ptr->newLambda());
+
+            for (int comp = 0; comp < s_num_scal_comps; ++comp) {
+                fineBundle.add(&newScal(comp));
+                crseBundle.add(&amrns_ptr->newScal(comp));
+                fineBundle.add(&oldScal(comp));
+                crseBundle.add(&amrns_ptr->oldScal(comp));
             }
 
-            { // scalars
-                MappedFineInterp fine_interp_scal(grids, 1, nRefCrse, m_problem_domain,
-                                                  m_levGeoPtr,
-                                                  considerCellVols);
-                fine_interp_scal.interpToFine(newLambda(), amrns_ptr->newLambda());
-
-                for (int comp = 0; comp < s_num_scal_comps; ++comp) {
-                    fine_interp_scal.interpToFine(newScal(comp), amrns_ptr->newScal(comp));
-                    fine_interp_scal.interpToFine(oldScal(comp), amrns_ptr->oldScal(comp));
-                }
+            if (crseStatsPtr != NULL) { // running statistics
+                fineBundle.add(m_stats_ptr);
+                crseBundle.add(amrns_ptr->m_stats_ptr);
             }
+
+            LevelData<FArrayBox> crsePacked, finePacked;
+            crseBundle.definePacked(crsePacked, IntVect::Zero);
+            crseBundle.pack(crsePacked);
+            fineBundle.definePacked(finePacked, IntVect::Zero);
+
+            MappedFineInterp fine_interp(grids, fineBundle.numComps(), nRefCrse,
+                                         m_problem_domain,
+                                         m_levGeoPtr,
+                                         considerCellVols);
+            fine_interp.interpToFine(finePacked, crsePacked);
+
+            fineBundle.unpack(finePacked);
         } // end if there is a coarser level
 
-        // copy from old state
-        if (old_newVelPtr != NULL) {
-            old_newVelPtr->copyTo(old_newVelPtr->interval(),
-                                  newVel(),
-                                  newVel().interval());
-        }
+        // copy from old state. All fields are sent together.
+        {
+            LevelDataBundle oldBundle, newBundle;
 
-        if (old_oldVelPtr != NULL) {
-            old_oldVelPtr->copyTo(old_oldVelPtr->interval(),
-                                  oldVel(),
-                                  oldVel().interval());
-        }
+            if (old_newVelPtr != NULL) {
+                oldBundle.add(old_newVelPtr);
+                newBundle.add(&newVel());
+            }
 
-        if (old_newLambdaPtr != NULL) {
-            old_newLambdaPtr->copyTo(old_newLambdaPtr->interval(),
-                                     newLambda(),
-                                     newLambda().interval());
-        }
+            if (old_oldVelPtr != NULL) {
+                oldBundle.add(old_oldVelPtr);
+                newBundle.add(&oldVel());
+            }
 
-        for (int comp = 0; comp < s_num_scal_comps; ++comp) {
-            if (old_oldScals[comp] != NULL) {
-                old_oldScals[comp]->copyTo(old_oldScals[comp]->interval(),
-                                           *m_scal_old[comp],
-                                           m_scal_old[comp]->interval());
+            if (old_newLambdaPtr != NULL) {
+                oldBundle.add(old_newLambdaPtr);
+                newBundle.add(&newLambda());
             }
 
-            if (old_newScals[comp] != NULL) {
-                old_newScals[comp]->copyTo(old_newScals[comp]->interval(),
-                                           *m_scal_new[comp],
-                                           m_scal_new[comp]->interval());
+            for (int comp = 0; comp < s_num_scal_comps; ++comp) {
+                if (old_oldScals[comp] != NULL) {
+                    oldBundle.add(old_oldScals[comp]);
+                    newBundle.add(m_scal_old[comp]);
+                }
+
+                if (old_newScals[comp] != NULL) {
+                    oldBundle.add(old_newScals[comp]);
+                    newBundle.add(m_scal_new[comp]);
+                }
+            } // end loop over scalar components
+
+            if (old_statsPtr != NULL) {
+                oldBundle.add(old_statsPtr);
+                newBundle.add(m_stats_ptr);
             }
-        } // end loop over scalar components
+
+            LevelDataBundle::copyTo(oldBundle, newBundle);
+        }
 
         // clean up before these pointers go out of scope...
         if (old_newVelPtr != 0) {
@@ -815,6 +1688,11 @@ void AMRNavierStokes::regrid (const Vector<Box>& a_new_grids)
             }
         } // end loop over components for scalars
 
+        if (old_statsPtr != NULL) {
+            delete old_statsPtr;
+            old_statsPtr = NULL;
+        }
+
     } else {
         // The new level is empty -- just clear everything
 
@@ -855,6 +1733,11 @@ void AMRNavierStokes::regrid (const Vector<Box>& a_new_grids)
             }
         } // end loop over scalar components
 
+        if (m_stats_ptr != NULL) {
+            delete m_stats_ptr;
+            m_stats_ptr = NULL;
+        }
+
         m_macPressure.clear();
         m_ccPressure.clear();
         m_syncPressure.clear();
@@ -923,10 +1806,17 @@ void AMRNavierStokes::postRegrid (int a_lBase)
 
         // 1. Smoothing...
 
-        // Smooth the composite velocity field (from lbase up) if needed
-        if (s_smooth_after_regrid) {
-            lBaseAMRNavierStokes->doPostRegridSmoothing(a_lBase);
+        // Smooth the composite velocity field (from the finest unchanged
+        // level up) if needed. preRegrid decided where to start.
+        const int smoothingBase = lBaseAMRNavierStokes->m_regrid_smoothing_base;
+        if (s_smooth_after_regrid && smoothingBase >= 0) {
+            AMRNavierStokes* baseNSPtr = lBaseAMRNavierStokes;
+            while (baseNSPtr->m_level < smoothingBase) {
+                baseNSPtr = baseNSPtr->fineNSPtr();
+            }
+            baseNSPtr->doPostRegridSmoothing(smoothingBase);
         }
+        lBaseAMRNavierStokes->m_regrid_smoothing_base = -1;
 
 
         // 2. Projection...
@@ -1445,16 +2335,22 @@ void AMRNavierStokes::doPostRegridSmoothing (int a_lBase)
         thisNSPtr = thisNSPtr->fineNSPtr();
     }
 
+    // The velocity solver is kept around and reused by any scalar that has
+    // the same diffusion coefficient. Defining these is not cheap.
+    MappedAMRPoissonOpFactory velPoissonOpFactory;
+    BiCGStabSolver<LevelData<FArrayBox> > velBottomSolver;
+    MappedAMRMultiGrid<LevelData<FArrayBox> > velSolver;
+
     if (s_nu > 0) {
         // Begin velocity smoothing block...
 
         // Define velocity smoothing op factory. Remember, defineRegridOp needs to know
         // what level to take dt from...which should be the finest unchanged level, a_lBase.
-        MappedAMRPoissonOpFactory localPoissonOpFactory;
+        MappedAMRPoissonOpFactory& localPoissonOpFactory = velPoissonOpFactory;
         defineRegridAMROp(localPoissonOpFactory, a_lBase, s_nu);
 
         // Set up bottom solver for AMRMultigrid.
-        BiCGStabSolver<LevelData<FArrayBox> > bottomSolver;
+        BiCGStabSolver<LevelData<FArrayBox> >& bottomSolver = velBottomSolver;
         bottomSolver.m_eps = s_viscous_bottom_eps;
         bottomSolver.m_reps = s_viscous_bottom_reps;
         bottomSolver.m_imax = s_viscous_bottom_imax;
@@ -1465,7 +2361,7 @@ void AMRNavierStokes::doPostRegridSmoothing (int a_lBase)
         bottomSolver.m_normType = s_viscous_bottom_normType;
 
         // Set up the AMRMultigrid solver.
-        MappedAMRMultiGrid<LevelData<FArrayBox> > streamSolver;
+        MappedAMRMultiGrid<LevelData<FArrayBox> >& streamSolver = velSolver;
         streamSolver.define(*crseDomainPtr,
                             localPoissonOpFactory,
                             &bottomSolver,
@@ -1579,38 +2475,44 @@ void AMRNavierStokes::doPostRegridSmoothing (int a_lBase)
                 newS[lev]->exchange(excp);
             }
 
-            // Define scalar smoothing op factory. Remember, defineRegridOp needs to know
-            // what level to take dt from...which should be the finest unchanged level, a_lBase.
+            // Reuse the velocity solver if we can.
             MappedAMRPoissonOpFactory localPoissonOpFactory;
-            defineRegridAMROp(localPoissonOpFactory, a_lBase, s_scal_coeffs[scalComp]);
-
-            // Set up bottom solver for AMRMultigrid.
             BiCGStabSolver<LevelData<FArrayBox> > bottomSolver;
-            bottomSolver.m_eps = s_viscous_bottom_eps;
-            bottomSolver.m_reps = s_viscous_bottom_reps;
-            bottomSolver.m_imax = s_viscous_bottom_imax;
-            bottomSolver.m_numRestarts = s_viscous_bottom_numRestarts;
-            bottomSolver.m_hang = s_viscous_bottom_hang;
-            bottomSolver.m_small = s_viscous_bottom_small;
-            bottomSolver.m_verbosity = s_viscous_bottom_verbosity;
-            bottomSolver.m_normType = s_viscous_bottom_normType;
-
-            // Set up AMRMultigrid solver.
-            MappedAMRMultiGrid<LevelData<FArrayBox> > streamSolver;
-            streamSolver.define(*crseDomainPtr,
-                                localPoissonOpFactory,
-                                &bottomSolver,
-                                finestLevel + 1);
-            streamSolver.m_verbosity = s_viscous_AMRMG_verbosity;
-            streamSolver.m_imin = s_viscous_AMRMG_imin;
-            streamSolver.setSolverParameters(s_viscous_AMRMG_num_smooth_down,
-                                             s_viscous_AMRMG_num_smooth_up,
-                                             s_viscous_AMRMG_num_smooth_bottom,
-                                             s_viscous_AMRMG_numMG,
-                                             s_viscous_AMRMG_imax,
-                                             s_viscous_AMRMG_eps,
-                                             s_viscous_AMRMG_hang,
-                                             s_viscous_AMRMG_normThresh);
+            MappedAMRMultiGrid<LevelData<FArrayBox> > localSolver;
+            MappedAMRMultiGrid<LevelData<FArrayBox> >* streamSolverPtr = &velSolver;
+
+            if (s_nu <= 0.0 || s_scal_coeffs[scalComp] != s_nu) {
+                // Define scalar smoothing op factory. Remember, defineRegridOp needs to know
+                // what level to take dt from...which should be the finest unchanged level, a_lBase.
+                defineRegridAMROp(localPoissonOpFactory, a_lBase, s_scal_coeffs[scalComp]);
+
+                // Set up bottom solver for AMRMultigrid.
+                bottomSolver.m_eps = s_viscous_bottom_eps;
+                bottomSolver.m_reps = s_viscous_bottom_reps;
+                bottomSolver.m_imax = s_viscous_bottom_imax;
+                bottomSolver.m_numRestarts = s_viscous_bottom_numRestarts;
+                bottomSolver.m_hang = s_viscous_bottom_hang;
+                bottomSolver.m_small = s_viscous_bottom_small;
+                bottomSolver.m_verbosity = s_viscous_bottom_verbosity;
+                bottomSolver.m_normType = s_viscous_bottom_normType;
+
+                // Set up AMRMultigrid solver.
+                localSolver.define(*crseDomainPtr,
+                                   localPoissonOpFactory,
+                                   &bottomSolver,
+                                   finestLevel + 1);
+                localSolver.m_verbosity = s_viscous_AMRMG_verbosity;
+                localSolver.m_imin = s_viscous_AMRMG_imin;
+                localSolver.setSolverParameters(s_viscous_AMRMG_num_smooth_down,
+                                                s_viscous_AMRMG_num_smooth_up,
+                                                s_viscous_AMRMG_num_smooth_bottom,
+                                                s_viscous_AMRMG_numMG,
+                                                s_viscous_AMRMG_imax,
+                                                s_viscous_AMRMG_eps,
+                                                s_viscous_AMRMG_hang,
+                                                s_viscous_AMRMG_normThresh);
+                streamSolverPtr = &localSolver;
+            }
 
             // Post notice of the solve.
             if (s_verbosity >= 1) {
@@ -1620,8 +2522,8 @@ void AMRNavierStokes::doPostRegridSmoothing (int a_lBase)
             }
 
             // Solve! (Last two args are max level and base level)
-            streamSolver.solve(newS, oldS, finestLevel, a_lBase,
-                               false); // dont initialize newS to zero
+            streamSolverPtr->solve(newS, oldS, finestLevel, a_lBase,
+                                   false); // dont initialize newS to zero
 
             // Average new s down to invalid regions
             {
@@ -31,7 +31,9 @@
 #include "AMRLESMeta.H"
 #include "Printing.H"
 #include "AMRCCProjector.H"
+#include "DiagnosticsLog.H"
 #include <iomanip>
+#include <sys/time.h>
 
 
 // -----------------------------------------------------------------------------
@@ -53,6 +55,7 @@ void AMRNavierStokes::postTimeStep()
             this->syncSingleGridDiagnostics();
         }
         this->syncTermDiagnostics();
+        this->accumulateStats();
 
         return;
     }
@@ -292,6 +295,7 @@ void AMRNavierStokes::postTimeStep()
                                     false,          // velIsFlux,
                                     false,          // zero-out pressure
                                     false);         // force homogeneous
+                    m_projIter += projObj.getNumIter();
                 }
             }
         } // end sync projection
@@ -336,6 +340,9 @@ void AMRNavierStokes::postTimeStep()
 
     // 4.) Write terminal output
     this->syncTermDiagnostics();
+
+    // 5.) Add the synced state to the running statistics
+    this->accumulateStats();
 }
 
 
@@ -1107,6 +1114,15 @@ void AMRNavierStokes::syncSingleGridDiagnostics()
                                  true,
                                  *m_levGeoPtr);
 
+    // If syncTermDiagnostics will write a composite row, leave this rank's
+    // max|Divergence| for it to reduce along with the rest of the step's
+    // diagnostics. Otherwise, reduce and print it here.
+    if (s_write_stdout || DiagnosticsLog::isOpen()) {
+        m_localMaxDiv = computeLocalUnmappedNormPow(thisDiv, NULL, *m_levGeoPtr,
+                                                    0);  // norm type
+        return;
+    }
+
     // Compute max|Divergence|
     const Real maxDiv = computeMappedNorm(thisDiv, NULL, *m_levGeoPtr,
                                           0);  // norm type
@@ -1120,7 +1136,20 @@ void AMRNavierStokes::syncSingleGridDiagnostics()
 
 
 // -----------------------------------------------------------------------------
-// Write diagnostic info to stdout
+// Seconds since some fixed point in the past.
+// -----------------------------------------------------------------------------
+static Real wallClock ()
+{
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return Real(tv.tv_sec) + 1.0e-6 * Real(tv.tv_usec);
+}
+
+
+// -----------------------------------------------------------------------------
+// Write diagnostic info to stdout and the diagnostics log.
+// Each call does at most one global reduction per output line. The values
+// are computed locally, then reduced together in a DiagnosticsRow.
 // -----------------------------------------------------------------------------
 void AMRNavierStokes::syncTermDiagnostics()
 {
@@ -1129,10 +1158,19 @@ void AMRNavierStokes::syncTermDiagnostics()
     }
     CH_TIME("AMRNavierStokes::syncTermDiagnostics");
 
-    if (!s_write_stdout) return;
+    // The step count goes into checkpoints, so it does not depend on
+    // what we write.
+    if (m_level == 0) {
+        ++s_step_number;
+    }
+
+    if (!s_write_stdout && !DiagnosticsLog::isOpen()) return;
+
+    const char* velNames[] = {"max_u", "max_v", "max_w"};
+    const char* momNames[] = {"sum_u", "sum_v", "sum_w"};
 
     // Write level output
-    {
+    if (s_write_stdout) {
         // Get reference to finer grids
         const DisjointBoxLayout* fineGridsPtr = NULL;
         const LevelGeometry* fineLevGeoPtr = m_levGeoPtr->getFinerPtr();
@@ -1140,17 +1178,21 @@ void AMRNavierStokes::syncTermDiagnostics()
             fineGridsPtr = &(fineLevGeoPtr->getBoxes());
         }
 
-        // Compute max|velocity|
-        D_TERM(
-        const Real unorm = computeUnmappedNorm(*m_vel_new_ptr, fineGridsPtr, *m_levGeoPtr, 0, 0);,
-        const Real vnorm = computeUnmappedNorm(*m_vel_new_ptr, fineGridsPtr, *m_levGeoPtr, 0, 1);,
-        const Real wnorm = computeUnmappedNorm(*m_vel_new_ptr, fineGridsPtr, *m_levGeoPtr, 0, 2);)
+        // Compute max|velocity| and max|buoyancy|
+        DiagnosticsRow row;
+        for (int dir = 0; dir < SpaceDim; ++dir) {
+            row.add(velNames[dir],
+                    computeLocalUnmappedNormPow(*m_vel_new_ptr, fineGridsPtr, *m_levGeoPtr, 0, dir),
+                    DiagnosticsRow::Op::MAX);
+        }
 
-        // Compute max|buoyancy|
-        Real bnorm = 0.0;
+        Real localBNorm = 0.0;
         if (s_num_scal_comps > 0) {
-            bnorm = computeUnmappedNorm(*m_scal_new[0], fineGridsPtr, *m_levGeoPtr, 0, 0);
+            localBNorm = computeLocalUnmappedNormPow(*m_scal_new[0], fineGridsPtr, *m_levGeoPtr, 0, 0);
         }
+        row.add("max_b", localBNorm, DiagnosticsRow::Op::MAX);
+
+        row.reduce();
 
         // Print results to terminal
         if (procID() == 0) {
@@ -1161,10 +1203,10 @@ void AMRNavierStokes::syncTermDiagnostics()
                       << std::left << setiosflags(ios::fixed) << setprecision(8) << setw(18) << ((m_dt < tol)? m_dt: -123)
                       << color::green
                       D_TERM(
-                      << std::left << setiosflags(ios::scientific) << setprecision(8) << setw(18) << unorm,
-                      << std::left << setiosflags(ios::scientific) << setprecision(8) << setw(18) << vnorm,
-                      << std::left << setiosflags(ios::scientific) << setprecision(8) << setw(18) << wnorm)
-                      << std::left << setiosflags(ios::scientific) << setprecision(8) << setw(18) << bnorm
+                      << std::left << setiosflags(ios::scientific) << setprecision(8) << setw(18) << row.get("max_u"),
+                      << std::left << setiosflags(ios::scientific) << setprecision(8) << setw(18) << row.get("max_v"),
+                      << std::left << setiosflags(ios::scientific) << setprecision(8) << setw(18) << row.get("max_w"))
+                      << std::left << setiosflags(ios::scientific) << setprecision(8) << setw(18) << row.get("max_b")
                       << color::none
                       << std::endl;
         }
@@ -1174,11 +1216,17 @@ void AMRNavierStokes::syncTermDiagnostics()
     if (m_level == 0) {
         // Collect AMR data
         Vector<LevelData<FArrayBox>*> amrVel(0), amrB(0);
+        int projIter = 0, viscIter = 0;
         AMRNavierStokes* levelNSPtr = this;
         while(levelNSPtr != NULL) {
             amrVel.push_back(levelNSPtr->m_vel_new_ptr);
             if (s_num_scal_comps > 0) amrB.push_back(levelNSPtr->m_scal_new[0]);
 
+            projIter += levelNSPtr->m_projIter;
+            viscIter += levelNSPtr->m_viscIter;
+            levelNSPtr->m_projIter = 0;
+            levelNSPtr->m_viscIter = 0;
+
             if (levelNSPtr->m_finer_level_ptr != NULL) {
                 levelNSPtr = dynamic_cast<AMRNavierStokes*>(levelNSPtr->m_finer_level_ptr);
             } else {
@@ -1186,53 +1234,107 @@ void AMRNavierStokes::syncTermDiagnostics()
             }
         }
 
-        // Compute max|velocity|
-        D_TERM(
-        const Real unorm = computeUnmappedNorm(amrVel, *m_levGeoPtr, 0, 0);,
-        const Real vnorm = computeUnmappedNorm(amrVel, *m_levGeoPtr, 0, 1);,
-        const Real wnorm = computeUnmappedNorm(amrVel, *m_levGeoPtr, 0, 2);)
+        DiagnosticsRow row;
+        row.set("step", Real(s_step_number));
+        row.set("time", m_time);
+        row.set("dt", m_dt);
 
-        // Compute max|buoyancy|
-        Real bnorm = 0.0;
-        if (s_num_scal_comps > 0) {
-            bnorm = computeUnmappedNorm(amrB, *m_levGeoPtr, 0, 0);
+        // Solver iterations over all levels since the last row. Every rank
+        // takes the same number of iterations.
+        row.set("proj_iters", Real(projIter));
+        row.set("visc_iters", Real(viscIter));
+
+        // Compute max|velocity|
+        for (int dir = 0; dir < SpaceDim; ++dir) {
+            row.add(velNames[dir],
+                    computeLocalUnmappedNormPow(amrVel, *m_levGeoPtr, 0, dir),
+                    DiagnosticsRow::Op::MAX);
         }
 
-        // Compute total mass
-        Real mass = 0.0;
+        // Compute max|buoyancy| and total mass
+        Real localBNorm = 0.0;
+        Real localMass = 0.0;
         if (s_num_scal_comps > 0) {
-            mass = computeMappedSum(amrB, *m_levGeoPtr);
+            Real vol = 0.0;
+            localBNorm = computeLocalUnmappedNormPow(amrB, *m_levGeoPtr, 0, 0);
+            localMass = computeLocalMappedSum(vol, amrB, *m_levGeoPtr);
         }
+        row.add("max_b", localBNorm, DiagnosticsRow::Op::MAX);
+        row.add("sum_b", localMass, DiagnosticsRow::Op::SUM);
 
         // Compute total momenta
-        const RealVect totalMom(D_DECL(
-            computeMappedSum(amrVel, *m_levGeoPtr, 0),
-            computeMappedSum(amrVel, *m_levGeoPtr, 1),
-            computeMappedSum(amrVel, *m_levGeoPtr, 2)
-        ));
+        for (int dir = 0; dir < SpaceDim; ++dir) {
+            Real vol = 0.0;
+            row.add(momNames[dir],
+                    computeLocalMappedSum(vol, amrVel, *m_levGeoPtr, dir),
+                    DiagnosticsRow::Op::SUM);
+        }
 
         // Compute total energy
-        const Real globalEnergy = this->totalEnergy();
+        row.add("energy", this->localTotalEnergy(), DiagnosticsRow::Op::SUM);
+
+        // Compute the largest CFL number over all levels
+        Real localCFL = 0.0;
+        levelNSPtr = this;
+        while (levelNSPtr != NULL && !levelNSPtr->isEmpty()) {
+            const RealVect& levelDx = levelNSPtr->m_levGeoPtr->getDx();
+            for (int dir = 0; dir < SpaceDim; ++dir) {
+                const Real levelVel = computeLocalUnmappedNormPow(*levelNSPtr->m_vel_new_ptr,
+                                                                  NULL,
+                                                                  *levelNSPtr->m_levGeoPtr,
+                                                                  0, dir);
+                localCFL = Max(localCFL, levelNSPtr->m_dt * levelVel / levelDx[dir]);
+            }
+            levelNSPtr = levelNSPtr->fineNSPtr();
+        }
+        row.add("cfl", localCFL, DiagnosticsRow::Op::MAX);
 
-        if (procID() == 0) {
+        // max|div(u)| is only computed on single-level runs.
+        if (m_localMaxDiv >= 0.0) {
+            row.add("max_div", m_localMaxDiv, DiagnosticsRow::Op::MAX);
+        }
+
+        // Wall time since the last composite output
+        static Real lastWallTime = -1.0;
+        const Real thisWallTime = wallClock();
+        row.add("wall_dt", ((lastWallTime < 0.0)? 0.0: thisWallTime - lastWallTime),
+                DiagnosticsRow::Op::MAX);
+        lastWallTime = thisWallTime;
+
+        // This is the only communication of the step's diagnostics.
+        row.reduce();
+        DiagnosticsLog::append(row);
+
+        const Real globalEnergy = row.get("energy");
+
+        if (m_localMaxDiv >= 0.0) {
+            pout() << setiosflags(ios::scientific) << setprecision(15);
+            pout() << "Time = " << setw(15) << m_time
+                   << setw(30) << " Max Div(u) = "
+                   << setw(23)  << row.get("max_div") << endl;
+            pout() << setiosflags(ios::scientific) << setprecision(8) << std::flush;
+            m_localMaxDiv = -1.0;
+        }
+
+        if (s_write_stdout && procID() == 0) {
             const Real tol = 1e8;
 
-            std::cout << color::hiwhite << std::left << setw(6) << ++s_step_number
+            std::cout << color::hiwhite << std::left << setw(6) << s_step_number
                       << "---     "
                       << std::left << setiosflags(ios::fixed) << setprecision(8) << setw(18) << m_time
                       << std::left << setiosflags(ios::fixed) << setprecision(8) << setw(18) << ((m_dt < tol)? m_dt: -123)
                       << color::higreen
                       D_TERM(
-                      << std::left << setiosflags(ios::scientific) << setprecision(8) << setw(18) << unorm,
-                      << std::left << setiosflags(ios::scientific) << setprecision(8) << setw(18) << vnorm,
-                      << std::left << setiosflags(ios::scientific) << setprecision(8) << setw(18) << wnorm)
-                      << std::left << setiosflags(ios::scientific) << setprecision(8) << setw(18) << bnorm
+                      << std::left << setiosflags(ios::scientific) << setprecision(8) << setw(18) << row.get("max_u"),
+                      << std::left << setiosflags(ios::scientific) << setprecision(8) << setw(18) << row.get("max_v"),
+                      << std::left << setiosflags(ios::scientific) << setprecision(8) << setw(18) << row.get("max_w"))
+                      << std::left << setiosflags(ios::scientific) << setprecision(8) << setw(18) << row.get("max_b")
                       << color::hiblue
-                      << std::left << setiosflags(ios::scientific) << setprecision(8) << setw(18) << mass
+                      << std::left << setiosflags(ios::scientific) << setprecision(8) << setw(18) << row.get("sum_b")
                       D_TERM(
-                      << std::left << setiosflags(ios::scientific) << setprecision(8) << setw(18) << totalMom[0],
-                      << std::left << setiosflags(ios::scientific) << setprecision(8) << setw(18) << totalMom[1],
-                      << std::left << setiosflags(ios::scientific) << setprecision(8) << setw(18) << totalMom[2])
+                      << std::left << setiosflags(ios::scientific) << setprecision(8) << setw(18) << row.get("sum_u"),
+                      << std::left << setiosflags(ios::scientific) << setprecision(8) << setw(18) << row.get("sum_v"),
+                      << std::left << setiosflags(ios::scientific) << setprecision(8) << setw(18) << row.get("sum_w"))
                       << ((s_totalEnergy < globalEnergy)? color::red: color::hiblue)
                       << std::left << setiosflags(ios::scientific) << setprecision(8) << setw(18) << globalEnergy
                       << color::none
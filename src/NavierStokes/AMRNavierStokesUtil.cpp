@@ -531,6 +531,9 @@ void AMRNavierStokes::resetStates (const Real a_time)
     }
 
     time(a_time);
+
+    // A moving metric goes back with the states.
+    m_levGeoPtr->updateMetrics(a_time);
 }
 
 
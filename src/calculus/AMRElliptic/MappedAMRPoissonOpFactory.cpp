@@ -1092,6 +1092,7 @@ void MappedAMRPoissonOpFactory::fill_MGfields(const int      a_AMRlevel,
     // Grab the geometry data
     const LevelGeometry& levGeo = *m_vlevGeoPtr[a_AMRlevel];
     const GeoSourceInterface& geoSource = *levGeo.getGeoSourcePtr();
+    MapTimeScope mapTime(levGeo);
     Real scale;
 
     // Compute dx
@@ -1110,11 +1111,7 @@ void MappedAMRPoissonOpFactory::fill_MGfields(const int      a_AMRlevel,
             if (m_customFillJgupPtr == NULL) {
                 // Use the levGeo's version of Jgup.
                 for (int adir = 0; adir < SpaceDim; ++adir) {
-                    for (int bdir = 0; bdir < SpaceDim; ++bdir) {
-                        geoSource.fill_Jgup(JgupFAB[adir],
-                                            bdir, adir, bdir,
-                                            mgDx);
-                    }
+                    geoSource.fill_JgupRow(JgupFAB[adir], adir, mgDx);
                 }
             } else {
                 // Use a custom Jgup
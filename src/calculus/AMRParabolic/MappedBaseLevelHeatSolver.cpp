@@ -37,7 +37,8 @@ MappedBaseLevelHeatSolver::MappedBaseLevelHeatSolver (const Vector<DisjointBoxLa
   m_refRat(a_refRat),
   m_level0Domain(a_level0Domain),
   m_ops(),
-  m_solver(a_solver)
+  m_solver(a_solver),
+  m_numIter(0)
 {
     m_ops.resize(a_grids.size());
     Vector< MappedAMRLevelOp<LevelDataType> * >& amrops =  m_solver->getAMROperators();
@@ -238,6 +239,7 @@ void MappedBaseLevelHeatSolver::solveHelm (LevelDataType& a_phi,
     resetSolverAlphaAndBeta(1.0, factor);
 
     m_solver->solve(phi, rhs, a_level, a_level, a_zeroPhi);
+    m_numIter += m_solver->getNumIter();
     int solverExitStatus = m_solver->m_exitStatus;
     if (solverExitStatus == 2 || solverExitStatus == 4 || solverExitStatus == 6) {
         // These status codes correspond to the cases in which
@@ -292,6 +294,15 @@ int MappedBaseLevelHeatSolver::size () const
 }
 
 
+// -----------------------------------------------------------------------------
+// The total number of multigrid iterations taken by solveHelm.
+// -----------------------------------------------------------------------------
+int MappedBaseLevelHeatSolver::getNumIter () const
+{
+    return m_numIter;
+}
+
+
 // -----------------------------------------------------------------------------
 // Interpolates a given quantity linearly in time using its beginning- and
 // end-of-step values and placing the result in \a a_data.
@@ -35,7 +35,8 @@ AMRLepticSolver::AMRLepticSolver ()
   m_iterMax(20),
   m_verbosity(3),
   m_numMG(1),
-  m_convergenceMetric(0.)
+  m_convergenceMetric(0.),
+  m_numIter(0)
 {
     this->clear();
 }
@@ -388,6 +389,7 @@ void AMRLepticSolver::solveNoInitResid (Vector<LevelData<FArrayBox>*>&       a_p
 
     // The solver has finished. Figure out the final state of the solution.
     m_exitStatus = int(!goRedu) + int(!goIter) * 2 + int(!goHang) * 4 + int(!goNorm) * 8;
+    m_numIter = iter;
 
     if (m_verbosity == 2) {
         if (initial_rnorm != 0.0) {
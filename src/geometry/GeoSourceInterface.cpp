@@ -29,6 +29,14 @@
 #include "LevelGeometry.H"
 
 
+// -----------------------------------------------------------------------------
+// Default constructor
+// -----------------------------------------------------------------------------
+GeoSourceInterface::GeoSourceInterface ()
+: m_time(0.0)
+{;}
+
+
 // -----------------------------------------------------------------------------
 // Default destructor
 // -----------------------------------------------------------------------------
@@ -450,6 +458,84 @@ void GeoSourceInterface::fill_Jgup (FArrayBox&       a_dest,
 }
 
 
+// -----------------------------------------------------------------------------
+// Fills an FArrayBox with one row of the contravariant metric, gup^{a_mu,*}.
+// -----------------------------------------------------------------------------
+void GeoSourceInterface::fill_gupRow (FArrayBox&       a_dest,
+                                      const int        a_mu,
+                                      const RealVect&  a_dXi,
+                                      const Real       a_scale) const
+{
+    CH_TIME("GeoSourceInterface::fill_gupRow");
+    this->fill_gupRowFromJacobian(a_dest, a_mu, 2, a_dXi, a_scale);
+}
+
+
+// -----------------------------------------------------------------------------
+// Fills an FArrayBox with one row of J * gup, Jgup^{a_mu,*}.
+// -----------------------------------------------------------------------------
+void GeoSourceInterface::fill_JgupRow (FArrayBox&       a_dest,
+                                       const int        a_mu,
+                                       const RealVect&  a_dXi,
+                                       const Real       a_scale) const
+{
+    CH_TIME("GeoSourceInterface::fill_JgupRow");
+    this->fill_gupRowFromJacobian(a_dest, a_mu, 1, a_dXi, a_scale);
+}
+
+
+// -----------------------------------------------------------------------------
+// Does the work for fill_gupRow and fill_JgupRow.
+// fill_gup needs 2*SpaceDim calls to fill_dXidx per element, and each of those
+// rebuilds several Jacobian matrix elements and J. Here, we fill the entire
+// Jacobian matrix into one contiguous FAB, fill J once, and let a single
+// kernel form the cofactors and all SpaceDim elements of the row.
+// -----------------------------------------------------------------------------
+void GeoSourceInterface::fill_gupRowFromJacobian (FArrayBox&       a_dest,
+                                                  const int        a_mu,
+                                                  const int        a_Jpow,
+                                                  const RealVect&  a_dXi,
+                                                  const Real       a_scale) const
+{
+    // Sanity checks
+    CH_assert(a_dest.nComp() == SpaceDim);
+    CH_assert((0 <= a_mu) && (a_mu < SpaceDim));
+    CH_assert(a_Jpow == 1 || a_Jpow == 2);
+
+    const Box& destBox = a_dest.box();
+
+    // Fill the Jacobian matrix, dx^a/dXi^b, and J.
+    FArrayBox dxdXi(destBox, SpaceDim*SpaceDim);
+    for (int a = 0; a < SpaceDim; ++a) {
+        for (int b = 0; b < SpaceDim; ++b) {
+            const int comp = LevelGeometry::tensorCompCC(a, b);
+            this->fill_dxdXi(dxdXi, comp, a, b, a_dXi);
+        }
+    }
+
+    FArrayBox detJ(destBox, 1);
+    this->fill_J(detJ, 0, a_dXi);
+
+    // Compute the row
+    FORT_FILL_GUPROW(
+        CHF_FRA(a_dest),
+        CHF_CONST_FRA(dxdXi),
+        CHF_CONST_FRA1(detJ,0),
+        CHF_CONST_INT(a_mu),
+        CHF_CONST_INT(a_Jpow),
+        CHF_CONST_REAL(a_scale),
+        CHF_BOX(destBox));
+
+    // Off-diagonal elements of diagonal metrics must be exactly zero.
+    if (this->isDiagonal()) {
+        for (int nu = 0; nu < SpaceDim; ++nu) {
+            if (nu == a_mu) continue;
+            a_dest.setVal(0.0, nu);
+        }
+    }
+}
+
+
 // -----------------------------------------------------------------------------
 // Fills an FArrayBox with the connection elements.
 // Note that although this function is provided and works, it is never used
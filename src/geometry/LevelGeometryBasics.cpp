@@ -75,6 +75,9 @@ RealVect LevelGeometry::s_domainLength = RealVect::Zero;
 const IntVect LevelGeometry::s_ghostVectFC = IntVect::Unit;
 const IntVect LevelGeometry::s_ghostVectCC = IntVect::Unit;
 
+// The metric caches' memory budget, in bytes. Set by staticDefine.
+Real LevelGeometry::s_cacheBudget = -1.0;
+
 RealVect              LevelGeometry::s_lev0dXi = RealVect::Zero; // dXi at the base level.
 LevelData<NodeFArrayBox>* LevelGeometry::s_lev0xPtr = NULL;      // physCoor on the base level.
 LevelData<NodeFArrayBox>* LevelGeometry::s_lev0d2xPtr = NULL;    // The spline's 2nd derivatives.
@@ -85,8 +88,20 @@ LevelGeometry::t_CCJinvMap    LevelGeometry::s_CCJinvMap;
 LevelGeometry::t_FCgupMap     LevelGeometry::s_FCgupMap;
 LevelGeometry::t_FCJgupMap    LevelGeometry::s_FCJgupMap;
 LevelGeometry::t_CCgdnMap     LevelGeometry::s_CCgdnMap;
+LevelGeometry::t_CCJinvMap    LevelGeometry::s_vertAvgCCJinvMap;
+LevelGeometry::t_FCJgupMap    LevelGeometry::s_vertAvgFCJgupMap;
 LevelGeometry::t_bdryNormMaps LevelGeometry::s_bdryNormMaps;
 
+// The number of vertical planes filled at a time by createVertAvgFCJgupPtr.
+const int LevelGeometry::s_vertAvgSlabPlanes = 8;
+
+// Cache bookkeeping
+LevelGeometry::t_cacheTickMap LevelGeometry::s_cacheTickMap;
+long                          LevelGeometry::s_cacheTick = 0;
+long                          LevelGeometry::s_cacheHits = 0;
+long                          LevelGeometry::s_cacheMisses = 0;
+long                          LevelGeometry::s_cacheEvictions = 0;
+
 
 // -----------------------------------------------------------------------------
 // Sets the coordinate system.
@@ -102,6 +117,7 @@ void LevelGeometry::staticDefine ()
     s_lev0dXi = s_domainLength / RealVect(ctx->nx);
     s_coordMap = ctx->coordMap;
     s_metricSourcePtr = RefCountedPtr<GeoSourceInterface>(ctx->newGeoSourceInterface());
+    s_cacheBudget = ctx->metricCacheBudget * 1048576.0;
 
     // Sanity check
     CH_assert(isStaticDefined());
@@ -133,7 +149,15 @@ void LevelGeometry::staticUndefine ()
     s_FCgupMap.clear();
     s_FCJgupMap.clear();
     s_CCgdnMap.clear();
+    s_vertAvgCCJinvMap.clear();
+    s_vertAvgFCJgupMap.clear();
     s_bdryNormMaps.clear();
+
+    s_cacheTickMap.clear();
+    s_cacheTick = 0;
+    s_cacheHits = 0;
+    s_cacheMisses = 0;
+    s_cacheEvictions = 0;
 }
 
 
@@ -148,6 +172,7 @@ LevelGeometry::LevelGeometry ()
 
     m_finerPtr = NULL;
     m_coarserPtr = NULL;
+    m_mapTime = s_metricSourcePtr->getTime();
     m_dXi = RealVect::Zero; // This will be used by define().
     m_refToLev0 = IntVect::Zero;
     m_fineRefRatio = IntVect::Unit;
@@ -166,6 +191,7 @@ LevelGeometry::LevelGeometry (const RealVect& a_dXi)
 
     m_finerPtr = NULL;
     m_coarserPtr = NULL;
+    m_mapTime = s_metricSourcePtr->getTime();
 
     this->define(a_dXi);
 }
@@ -251,11 +277,7 @@ void LevelGeometry::regrid (const DisjointBoxLayout& a_newGrids)
     // It is assumed that these RefCountedPtrs are unique. It may be nice to
     // check this by including a !isNonUnique() assert, but I'll save that
     // for the day I begin dereferencing NULL pointers.
-    s_CCJMap.erase(m_grids);
-    s_CCJinvMap.erase(m_grids);
-    s_FCgupMap.erase(m_grids);
-    s_FCJgupMap.erase(m_grids);
-    s_CCgdnMap.erase(m_grids);
+    eraseFromCache(m_grids);
 
     // This flushes the entire cache. I could only erase elements that belong to the
     // regridded levels, but I tried that and it requires a lot of code refactoring.
@@ -270,13 +292,14 @@ void LevelGeometry::regrid (const DisjointBoxLayout& a_newGrids)
         s_metricSourcePtr->suggestLev0Grids(m_grids);
     }
 
-    // Check if the fields are in the field map.
-    // If not, create new ones.
-    m_CCJPtr      = this->createCCJPtr(m_grids);
-    m_CCJinvPtr   = this->createCCJinvPtr(m_grids);
-    m_FCgupPtr    = this->createFCgupPtr(m_grids);
-    m_FCJgupPtr   = this->createFCJgupPtr(m_grids);
-    m_CCgdnPtr    = this->createCCgdnPtr(m_grids);
+    // Drop our old fields. The get*Ptr functions will search the field
+    // maps for the new ones (or create them) when they are first needed.
+    m_vertAvgDomainBox = Box();
+    m_CCJPtr      = t_CCJPtr(NULL);
+    m_CCJinvPtr   = t_CCJinvPtr(NULL);
+    m_FCgupPtr    = t_FCgupPtr(NULL);
+    m_FCJgupPtr   = t_FCJgupPtr(NULL);
+    m_CCgdnPtr    = t_CCgdnPtr(NULL);
 }
 
 
@@ -302,11 +325,7 @@ void LevelGeometry::regridVertAvg (const DisjointBoxLayout& a_newGrids,
     // It is assumed that these RefCountedPtrs are unique. It may be nice to
     // check this by including a !isNonUnique() assert, but I'll save that
     // for the day I begin dereferencing NULL pointers.
-    s_CCJMap.erase(m_grids);
-    s_CCJinvMap.erase(m_grids);
-    s_FCgupMap.erase(m_grids);
-    s_FCJgupMap.erase(m_grids);
-    s_CCgdnMap.erase(m_grids);
+    eraseFromCache(m_grids);
 
     // This flushes the entire cache. I could only erase elements that belong to the
     // regridded levels, but I tried that and it requires a lot of code refactoring.
@@ -316,13 +335,14 @@ void LevelGeometry::regridVertAvg (const DisjointBoxLayout& a_newGrids,
     // Redefine using the new grids
     m_grids = a_newGrids;
 
-    // Check if the fields are in the field map.
-    // If not, create new ones.
+    // Drop our old fields. Only the vertically averaged CCJinv and FCJgup
+    // fields are available on this level. They will be created when needed.
+    m_vertAvgDomainBox = a_fullDomainBox;
     m_CCJPtr      = t_CCJPtr(NULL);
+    m_CCJinvPtr   = t_CCJinvPtr(NULL);
     m_FCgupPtr    = t_FCgupPtr(NULL);
+    m_FCJgupPtr   = t_FCJgupPtr(NULL);
     m_CCgdnPtr    = t_CCgdnPtr(NULL);
-    m_CCJinvPtr   = this->createVertAvgCCJinvPtr(m_grids, a_fullDomainBox);
-    m_FCJgupPtr   = this->createVertAvgFCJgupPtr(m_grids, a_fullDomainBox);
 }
 
 
@@ -332,18 +352,281 @@ void LevelGeometry::regridVertAvg (const DisjointBoxLayout& a_newGrids,
 void LevelGeometry::reset ()
 {
     m_grids       = DisjointBoxLayout();
+    m_vertAvgDomainBox = Box();
     m_CCJPtr      = t_CCJPtr(NULL);
     m_CCJinvPtr   = t_CCJinvPtr(NULL);
+    m_FCgupPtr    = t_FCgupPtr(NULL);
     m_FCJgupPtr   = t_FCJgupPtr(NULL);
     m_CCgdnPtr    = t_CCgdnPtr(NULL);
     s_bdryNormMaps.clear();
 }
 
 
+// -----------------------------------------------------------------------------
+// Re-evaluates this level's metric fields at a_time.
+// Only the fields that have already been created are touched. The rest will
+// be created at the new time when they are first needed.
+// -----------------------------------------------------------------------------
+void LevelGeometry::updateMetrics (const Real a_time)
+{
+    if (!s_metricSourcePtr->isTimeDependent()) return;
+
+    CH_TIME("LevelGeometry::updateMetrics");
+    CH_assert(this->isDefined());
+
+    m_mapTime = a_time;
+    MapTimeScope mapTime(*this);
+
+    // The boundary normals may have moved.
+    s_bdryNormMaps.clear();
+
+    const bool vertOnly = s_metricSourcePtr->isVerticalMotionOnly();
+    DataIterator dit = m_grids.dataIterator();
+
+    if (!m_vertAvgDomainBox.isEmpty()) {
+        // Vertically averaged levels only have Jgup. (CCJinv is just 1.)
+        if (!m_FCJgupPtr.isNull()) {
+            this->fillVertAvgFCJgup(*m_FCJgupPtr, m_vertAvgDomainBox);
+        }
+        return;
+    }
+
+    if (!m_CCJPtr.isNull()) {
+        for (dit.reset(); dit.ok(); ++dit) {
+            this->fill_J((*m_CCJPtr)[dit]);
+        }
+    }
+
+    if (!m_CCJinvPtr.isNull()) {
+        for (dit.reset(); dit.ok(); ++dit) {
+            this->fill_Jinv((*m_CCJinvPtr)[dit]);
+        }
+    }
+
+    if (!m_FCgupPtr.isNull()) {
+        for (dit.reset(); dit.ok(); ++dit) {
+            FluxBox& gupFlub = (*m_FCgupPtr)[dit];
+
+            for (int adir = 0; adir < SpaceDim; ++adir) {
+                if (vertOnly && adir < SpaceDim-1) {
+                    // dXi^a/dx^b is fixed for horizontal a and b, so only
+                    // gup^{a,z} can change on the horizontal faces.
+                    s_metricSourcePtr->fill_gup(gupFlub[adir], SpaceDim-1,
+                                                adir, SpaceDim-1,
+                                                m_dXi);
+                } else {
+                    s_metricSourcePtr->fill_gupRow(gupFlub[adir], adir, m_dXi);
+                }
+            }
+        }
+    }
+
+    if (!m_FCJgupPtr.isNull()) {
+        // J changes everywhere, so every element of Jgup must be refilled.
+        for (dit.reset(); dit.ok(); ++dit) {
+            this->fill_Jgup((*m_FCJgupPtr)[dit]);
+        }
+    }
+
+    if (!m_CCgdnPtr.isNull()) {
+        for (dit.reset(); dit.ok(); ++dit) {
+            this->fill_gdn((*m_CCgdnPtr)[dit]);
+        }
+    }
+}
+
+
+// -----------------------------------------------------------------------------
+// Sets the coordinate map's time to a_levGeo's map time.
+// -----------------------------------------------------------------------------
+MapTimeScope::MapTimeScope (const LevelGeometry& a_levGeo)
+: m_geoSourcePtr(a_levGeo.getGeoSourcePtr()),
+  m_savedTime(0.0)
+{
+    if (!m_geoSourcePtr->isTimeDependent()) return;
+
+    m_savedTime = m_geoSourcePtr->getTime();
+    m_geoSourcePtr->setTime(a_levGeo.getMapTime());
+}
+
+
+// -----------------------------------------------------------------------------
+// Restores the coordinate map's time.
+// -----------------------------------------------------------------------------
+MapTimeScope::~MapTimeScope ()
+{
+    if (!m_geoSourcePtr->isTimeDependent()) return;
+
+    m_geoSourcePtr->setTime(m_savedTime);
+}
+
+
+// -----------------------------------------------------------------------------
+// Returns the number of bytes this rank uses to store a cached CC field.
+// -----------------------------------------------------------------------------
+static Real localCacheBytes (const LevelData<FArrayBox>& a_data)
+{
+    Real bytes = 0.0;
+    DataIterator dit = a_data.dataIterator();
+    for (dit.reset(); dit.ok(); ++dit) {
+        bytes += Real(a_data[dit].box().numPts()) * Real(a_data[dit].nComp());
+    }
+    return bytes * Real(sizeof(Real));
+}
+
+
+// -----------------------------------------------------------------------------
+// Returns the number of bytes this rank uses to store a cached FC field.
+// -----------------------------------------------------------------------------
+static Real localCacheBytes (const LevelData<FluxBox>& a_data)
+{
+    Real bytes = 0.0;
+    DataIterator dit = a_data.dataIterator();
+    for (dit.reset(); dit.ok(); ++dit) {
+        for (int dir = 0; dir < SpaceDim; ++dir) {
+            const FArrayBox& faceFAB = a_data[dit][dir];
+            bytes += Real(faceFAB.box().numPts()) * Real(faceFAB.nComp());
+        }
+    }
+    return bytes * Real(sizeof(Real));
+}
+
+
+// -----------------------------------------------------------------------------
+// Adds the local memory used by each layout in a metric map to a_layoutBytes
+// and marks the layouts whose fields are referenced outside of the map.
+// -----------------------------------------------------------------------------
+template <class MapType>
+static void tallyCacheMap (const MapType&              a_map,
+                           map<const BoxLayout, Real>& a_layoutBytes,
+                           map<const BoxLayout, bool>& a_layoutIsLive,
+                           Real&                       a_totalBytes)
+{
+    typename MapType::const_iterator it;
+    for (it = a_map.begin(); it != a_map.end(); ++it) {
+        if (it->second.isNull()) continue;
+
+        const Real bytes = localCacheBytes(*(it->second));
+        a_layoutBytes[it->first] += bytes;
+        a_totalBytes += bytes;
+
+        if (it->second.isNonUnique()) {
+            a_layoutIsLive[it->first] = true;
+        }
+    }
+}
+
+
+// -----------------------------------------------------------------------------
+// Writes the metric cache's hit/miss/eviction counts to pout().
+// -----------------------------------------------------------------------------
+void LevelGeometry::printCacheStats ()
+{
+    const long numLookups = s_cacheHits + s_cacheMisses;
+    const Real hitRate = (numLookups > 0)? Real(s_cacheHits) / Real(numLookups): 0.0;
+
+    pout() << "LevelGeometry metric cache:"
+           << "\n\thits = " << s_cacheHits
+           << "\n\tmisses = " << s_cacheMisses
+           << "\n\thit rate = " << 100.0 * hitRate << "%"
+           << "\n\tevictions = " << s_cacheEvictions
+           << "\n\tlayouts in cache = " << s_cacheTickMap.size()
+           << endl;
+}
+
+
+// -----------------------------------------------------------------------------
+// Records a lookup of a_grids in the metric maps.
+// -----------------------------------------------------------------------------
+void LevelGeometry::touchCache (const BoxLayout& a_grids,
+                                const bool       a_hit)
+{
+    s_cacheTickMap[a_grids] = ++s_cacheTick;
+    if (a_hit) {
+        ++s_cacheHits;
+    } else {
+        ++s_cacheMisses;
+    }
+}
+
+
+// -----------------------------------------------------------------------------
+// Erases all metric fields that use a_grids.
+// -----------------------------------------------------------------------------
+void LevelGeometry::eraseFromCache (const BoxLayout& a_grids)
+{
+    s_CCJMap.erase(a_grids);
+    s_CCJinvMap.erase(a_grids);
+    s_FCgupMap.erase(a_grids);
+    s_FCJgupMap.erase(a_grids);
+    s_CCgdnMap.erase(a_grids);
+    s_vertAvgCCJinvMap.erase(a_grids);
+    s_vertAvgFCJgupMap.erase(a_grids);
+    s_cacheTickMap.erase(a_grids);
+}
+
+
+// -----------------------------------------------------------------------------
+// Evicts unreferenced layouts, oldest first, until the cached metric data
+// fits in s_cacheBudget. a_keepGrids is never evicted.
+//
+// A layout is only evicted if the maps hold the sole reference to each of its
+// fields. Anything still in use by a LevelGeometry (or a solver that grabbed
+// a get*Ptr) stays put, so the budget may be exceeded if every layout is live.
+// The budget is per rank, so this decision is purely local.
+// -----------------------------------------------------------------------------
+void LevelGeometry::enforceCacheBudget (const BoxLayout& a_keepGrids)
+{
+    if (s_cacheBudget < 0.0) return;
+
+    CH_TIME("LevelGeometry::enforceCacheBudget");
+
+    // Tally the memory used by each layout and find out which are in use.
+    map<const BoxLayout, Real> layoutBytes;
+    map<const BoxLayout, bool> layoutIsLive;
+    Real totalBytes = 0.0;
+
+    tallyCacheMap(s_CCJMap,    layoutBytes, layoutIsLive, totalBytes);
+    tallyCacheMap(s_CCJinvMap, layoutBytes, layoutIsLive, totalBytes);
+    tallyCacheMap(s_FCgupMap,  layoutBytes, layoutIsLive, totalBytes);
+    tallyCacheMap(s_FCJgupMap, layoutBytes, layoutIsLive, totalBytes);
+    tallyCacheMap(s_CCgdnMap,  layoutBytes, layoutIsLive, totalBytes);
+    tallyCacheMap(s_vertAvgCCJinvMap, layoutBytes, layoutIsLive, totalBytes);
+    tallyCacheMap(s_vertAvgFCJgupMap, layoutBytes, layoutIsLive, totalBytes);
+
+    // Evict the least recently used, unreferenced layouts.
+    while (totalBytes > s_cacheBudget) {
+        map<const BoxLayout, Real>::iterator oldestIt = layoutBytes.end();
+        long oldestTick = s_cacheTick + 1;
+
+        map<const BoxLayout, Real>::iterator it;
+        for (it = layoutBytes.begin(); it != layoutBytes.end(); ++it) {
+            const BoxLayout& layout = it->first;
+            if (layout == a_keepGrids) continue;
+            if (layoutIsLive[layout]) continue;
+
+            const long tick = s_cacheTickMap[layout];
+            if (tick < oldestTick) {
+                oldestTick = tick;
+                oldestIt = it;
+            }
+        }
+
+        // If everything left is in use, there is nothing more we can do.
+        if (oldestIt == layoutBytes.end()) break;
+
+        totalBytes -= oldestIt->second;
+        eraseFromCache(oldestIt->first);
+        layoutBytes.erase(oldestIt);
+        ++s_cacheEvictions;
+    }
+}
+
+
 // -----------------------------------------------------------------------------
 // Find the J field in the map or create a new one.
 // -----------------------------------------------------------------------------
-LevelGeometry::t_CCJPtr LevelGeometry::createCCJPtr(const DisjointBoxLayout& a_grids)
+LevelGeometry::t_CCJPtr LevelGeometry::createCCJPtr(const DisjointBoxLayout& a_grids) const
 {
     CH_TIME("LevelGeometry::createCCJPtr");
 
@@ -351,6 +634,7 @@ LevelGeometry::t_CCJPtr LevelGeometry::createCCJPtr(const DisjointBoxLayout& a_g
     t_CCJPtr& thisFieldPtr = s_CCJMap[a_grids];
 
     // If the field exists in the map, just return it's pointer.
+    touchCache(a_grids, !thisFieldPtr.isNull());
     if (!thisFieldPtr.isNull()) return thisFieldPtr;
 
     Box dombox = a_grids.physDomain().domainBox();
@@ -365,6 +649,9 @@ LevelGeometry::t_CCJPtr LevelGeometry::createCCJPtr(const DisjointBoxLayout& a_g
         this->fill_J((*thisFieldPtr)[dit]);
     }
 
+    // Make room for the new field, if needed.
+    enforceCacheBudget(a_grids);
+
     // Return the new field pointer.
     return thisFieldPtr;
 }
@@ -373,7 +660,7 @@ LevelGeometry::t_CCJPtr LevelGeometry::createCCJPtr(const DisjointBoxLayout& a_g
 // -----------------------------------------------------------------------------
 // Find the 1/J field in the map or create a new one.
 // -----------------------------------------------------------------------------
-LevelGeometry::t_CCJinvPtr LevelGeometry::createCCJinvPtr(const DisjointBoxLayout& a_grids)
+LevelGeometry::t_CCJinvPtr LevelGeometry::createCCJinvPtr(const DisjointBoxLayout& a_grids) const
 {
     CH_TIME("LevelGeometry::createCCJinvPtr");
 
@@ -381,6 +668,7 @@ LevelGeometry::t_CCJinvPtr LevelGeometry::createCCJinvPtr(const DisjointBoxLayou
     t_CCJinvPtr& thisFieldPtr = s_CCJinvMap[a_grids];
 
     // If the field exists in the map, just return it's pointer.
+    touchCache(a_grids, !thisFieldPtr.isNull());
     if (!thisFieldPtr.isNull()) return thisFieldPtr;
 
     Box dombox = a_grids.physDomain().domainBox();
@@ -395,6 +683,9 @@ LevelGeometry::t_CCJinvPtr LevelGeometry::createCCJinvPtr(const DisjointBoxLayou
         this->fill_Jinv((*thisFieldPtr)[dit]);
     }
 
+    // Make room for the new field, if needed.
+    enforceCacheBudget(a_grids);
+
     // Return the new field pointer.
     return thisFieldPtr;
 }
@@ -404,14 +695,15 @@ LevelGeometry::t_CCJinvPtr LevelGeometry::createCCJinvPtr(const DisjointBoxLayou
 // Find the 1/J field in the map or create a new one.
 // -----------------------------------------------------------------------------
 LevelGeometry::t_CCJinvPtr LevelGeometry::createVertAvgCCJinvPtr(const DisjointBoxLayout& a_grids,
-                                                                 const Box&               a_fullDomainBox)
+                                                                 const Box&               a_fullDomainBox) const
 {
     CH_TIME("LevelGeometry::createVertAvgCCJinvPtr");
 
     // Search for the field int the map.
-    t_CCJinvPtr& thisFieldPtr = s_CCJinvMap[a_grids];
+    t_CCJinvPtr& thisFieldPtr = s_vertAvgCCJinvMap[a_grids];
 
     // If the field exists in the map, just return it's pointer.
+    touchCache(a_grids, !thisFieldPtr.isNull());
     if (!thisFieldPtr.isNull()) return thisFieldPtr;
 
     Box dombox = a_grids.physDomain().domainBox();
@@ -426,6 +718,9 @@ LevelGeometry::t_CCJinvPtr LevelGeometry::createVertAvgCCJinvPtr(const DisjointB
         (*thisFieldPtr)[dit].setVal(1.0);   // Because we are solving L[phi] = J*rhs.
     }
 
+    // Make room for the new field, if needed.
+    enforceCacheBudget(a_grids);
+
     // Return the new field pointer.
     return thisFieldPtr;
 }
@@ -434,7 +729,7 @@ LevelGeometry::t_CCJinvPtr LevelGeometry::createVertAvgCCJinvPtr(const DisjointB
 // -----------------------------------------------------------------------------
 // Find the gup field in the map or create a new one.
 // -----------------------------------------------------------------------------
-LevelGeometry::t_FCgupPtr LevelGeometry::createFCgupPtr(const DisjointBoxLayout& a_grids)
+LevelGeometry::t_FCgupPtr LevelGeometry::createFCgupPtr(const DisjointBoxLayout& a_grids) const
 {
     CH_TIME("LevelGeometry::createFCgupPtr");
 
@@ -442,6 +737,7 @@ LevelGeometry::t_FCgupPtr LevelGeometry::createFCgupPtr(const DisjointBoxLayout&
     t_FCgupPtr& thisFieldPtr = s_FCgupMap[a_grids];
 
     // If the field exists in the map, just return it's pointer.
+    touchCache(a_grids, !thisFieldPtr.isNull());
     if (!thisFieldPtr.isNull()) return thisFieldPtr;
 
     Box dombox = a_grids.physDomain().domainBox();
@@ -456,6 +752,9 @@ LevelGeometry::t_FCgupPtr LevelGeometry::createFCgupPtr(const DisjointBoxLayout&
         this->fill_gup((*thisFieldPtr)[dit]);
     }
 
+    // Make room for the new field, if needed.
+    enforceCacheBudget(a_grids);
+
     // Return the new field pointer.
     return thisFieldPtr;
 }
@@ -464,7 +763,7 @@ LevelGeometry::t_FCgupPtr LevelGeometry::createFCgupPtr(const DisjointBoxLayout&
 // -----------------------------------------------------------------------------
 // Find the Jgup field in the map or create a new one.
 // -----------------------------------------------------------------------------
-LevelGeometry::t_FCJgupPtr LevelGeometry::createFCJgupPtr(const DisjointBoxLayout& a_grids)
+LevelGeometry::t_FCJgupPtr LevelGeometry::createFCJgupPtr(const DisjointBoxLayout& a_grids) const
 {
     CH_TIME("LevelGeometry::createFCJgupPtr");
 
@@ -472,6 +771,7 @@ LevelGeometry::t_FCJgupPtr LevelGeometry::createFCJgupPtr(const DisjointBoxLayou
     t_FCJgupPtr& thisFieldPtr = s_FCJgupMap[a_grids];
 
     // If the field exists in the map, just return it's pointer.
+    touchCache(a_grids, !thisFieldPtr.isNull());
     if (!thisFieldPtr.isNull()) return thisFieldPtr;
 
     Box dombox = a_grids.physDomain().domainBox();
@@ -486,6 +786,9 @@ LevelGeometry::t_FCJgupPtr LevelGeometry::createFCJgupPtr(const DisjointBoxLayou
         this->fill_Jgup((*thisFieldPtr)[dit]);
     }
 
+    // Make room for the new field, if needed.
+    enforceCacheBudget(a_grids);
+
     // Return the new field pointer.
     return thisFieldPtr;
 }
@@ -495,14 +798,15 @@ LevelGeometry::t_FCJgupPtr LevelGeometry::createFCJgupPtr(const DisjointBoxLayou
 // Find the Jgup field in the map or create a new one.
 // -----------------------------------------------------------------------------
 LevelGeometry::t_FCJgupPtr LevelGeometry::createVertAvgFCJgupPtr(const DisjointBoxLayout& a_grids,
-                                                                 const Box&               a_fullDomainBox)
+                                                                 const Box&               a_fullDomainBox) const
 {
     CH_TIME("LevelGeometry::createVertAvgFCJgupPtr");
 
     // Search for the field int the map.
-    t_FCJgupPtr& thisFieldPtr = s_FCJgupMap[a_grids];
+    t_FCJgupPtr& thisFieldPtr = s_vertAvgFCJgupMap[a_grids];
 
     // If the field exists in the map, just return it's pointer.
+    touchCache(a_grids, !thisFieldPtr.isNull());
     if (!thisFieldPtr.isNull()) return thisFieldPtr;
 
     Box dombox = a_grids.physDomain().domainBox();
@@ -513,19 +817,39 @@ LevelGeometry::t_FCJgupPtr LevelGeometry::createVertAvgFCJgupPtr(const DisjointB
            CH_assert(a_fullDomainBox.smallEnd(0) <= dombox.smallEnd(0) && dombox.bigEnd(0) <= a_fullDomainBox.bigEnd(0));,
            CH_assert(a_fullDomainBox.smallEnd(1) <= dombox.smallEnd(1) && dombox.bigEnd(1) <= a_fullDomainBox.bigEnd(1));)
 
-    const IntVect vmask = BASISV(SpaceDim-1);
-    const IntVect hmask = IntVect::Unit - vmask;
-
     // The field did not exist. Allocate and define a new one.
     thisFieldPtr = t_FCJgupPtr(new LevelData<FluxBox>);
     thisFieldPtr->define(a_grids, SpaceDim);// Changed from s_ghostVectFC on Mar 23, 2014
 
     // Fill the new field.
-    DataIterator dit = thisFieldPtr->dataIterator();
+    this->fillVertAvgFCJgup(*thisFieldPtr, a_fullDomainBox);
+
+    // Make room for the new field, if needed.
+    enforceCacheBudget(a_grids);
+
+    // Return the new field pointer.
+    return thisFieldPtr;
+}
+
+
+// -----------------------------------------------------------------------------
+// Fills a_dest with the vertical average of Jgup over a_fullDomainBox.
+// a_dest must be defined over flat grids.
+// -----------------------------------------------------------------------------
+void LevelGeometry::fillVertAvgFCJgup (LevelData<FluxBox>& a_dest,
+                                       const Box&          a_fullDomainBox) const
+{
+    CH_TIME("LevelGeometry::fillVertAvgFCJgup");
+
+    const DisjointBoxLayout& grids = a_dest.getBoxes();
+    const IntVect vmask = BASISV(SpaceDim-1);
+    MapTimeScope mapTime(*this);
+
+    DataIterator dit = a_dest.dataIterator();
     for (dit.reset(); dit.ok(); ++dit) {
-        FluxBox& JgupFlub = (*thisFieldPtr)[dit];
+        FluxBox& JgupFlub = a_dest[dit];
 
-        const Box& flatValid = a_grids[dit];
+        const Box& flatValid = grids[dit];
         const IntVect flatShift = flatValid.smallEnd() * vmask;
         CH_assert(flatValid.size(SpaceDim-1) == 1);
 
@@ -542,39 +866,44 @@ LevelGeometry::t_FCJgupPtr LevelGeometry::createVertAvgFCJgupPtr(const DisjointB
         // const Real scale = m_dXi[SpaceDim-1] / s_domainLength[SpaceDim-1];
         const Real scale = 1.0 / Real(fullValid.size(SpaceDim-1));
 
-        for (int adir = 0; adir < SpaceDim-1; ++adir) {
-            Box FCFullValid = surroundingNodes(fullValid, adir);
-            FArrayBox fullFAB(FCFullValid, 1);
+        const int fullLo = fullValid.smallEnd(SpaceDim-1);
+        const int fullHi = fullValid.bigEnd(SpaceDim-1);
 
+        for (int adir = 0; adir < SpaceDim-1; ++adir) {
             for (int bdir = 0; bdir < SpaceDim-1; ++bdir) {
-                // Fill the metric over the full domain.
-                s_metricSourcePtr->fill_Jgup(fullFAB, 0,
-                                             adir, bdir,
-                                             m_dXi);
-
-                // Average vertically onto the flat domain.
-                Interval interv(bdir, bdir);
-                FArrayBox flatJgupComp(interv, JgupFlub[adir]);
-                flatJgupComp.setVal(0.0);
-
-                FORT_UNMAPPEDVERTINTEGRAL(
-                    CHF_FRA1_SHIFT(flatJgupComp, 0, flatShift),
-                    CHF_CONST_FRA1(fullFAB, 0),
-                    CHF_BOX(FCFullValid),
-                    CHF_CONST_REAL(scale));
+                JgupFlub[adir].setVal(0.0, bdir);
+            }
+
+            // Integrate the columns a few planes at a time. Each slab gets
+            // one fill_JgupRow call, which computes the Jacobian once for all
+            // bdir. This way, we never hold the full 3D metric in memory.
+            for (int slabLo = fullLo; slabLo <= fullHi; slabLo += s_vertAvgSlabPlanes) {
+                Box slabBox = fullValid;
+                slabBox.setSmall(SpaceDim-1, slabLo);
+                slabBox.setBig(SpaceDim-1, Min(slabLo + s_vertAvgSlabPlanes - 1, fullHi));
+
+                const Box FCSlabBox = surroundingNodes(slabBox, adir);
+                FArrayBox slabJgupRow(FCSlabBox, SpaceDim);
+                s_metricSourcePtr->fill_JgupRow(slabJgupRow, adir, m_dXi);
+
+                // Add this slab's contribution to the flat average.
+                for (int bdir = 0; bdir < SpaceDim-1; ++bdir) {
+                    FORT_UNMAPPEDVERTINTEGRAL(
+                        CHF_FRA1_SHIFT(JgupFlub[adir], bdir, flatShift),
+                        CHF_CONST_FRA1(slabJgupRow, bdir),
+                        CHF_BOX(FCSlabBox),
+                        CHF_CONST_REAL(scale));
+                }
             }
         }
     }
-
-    // Return the new field pointer.
-    return thisFieldPtr;
 }
 
 
 // -----------------------------------------------------------------------------
 // Find the gdn field in the map or create a new one.
 // -----------------------------------------------------------------------------
-LevelGeometry::t_CCgdnPtr LevelGeometry::createCCgdnPtr(const DisjointBoxLayout& a_grids)
+LevelGeometry::t_CCgdnPtr LevelGeometry::createCCgdnPtr(const DisjointBoxLayout& a_grids) const
 {
     CH_TIME("LevelGeometry::createCCgdnPtr");
 
@@ -582,6 +911,7 @@ LevelGeometry::t_CCgdnPtr LevelGeometry::createCCgdnPtr(const DisjointBoxLayout&
     t_CCgdnPtr& thisFieldPtr = s_CCgdnMap[a_grids];
 
     // If the field exists in the map, just return it's pointer.
+    touchCache(a_grids, !thisFieldPtr.isNull());
     if (!thisFieldPtr.isNull()) return thisFieldPtr;
 
     Box dombox = a_grids.physDomain().domainBox();
@@ -597,6 +927,9 @@ LevelGeometry::t_CCgdnPtr LevelGeometry::createCCgdnPtr(const DisjointBoxLayout&
         this->fill_gdn((*thisFieldPtr)[dit]);
     }
 
+    // Make room for the new field, if needed.
+    enforceCacheBudget(a_grids);
+
     // Return the new field pointer.
     return thisFieldPtr;
 }
@@ -68,6 +68,7 @@ void LevelGeometry::fill_physCoor (FArrayBox& a_dest) const
     CH_assert(a_dest.nComp() == SpaceDim);
 
     // Fill data holder
+    MapTimeScope mapTime(*this);
     s_metricSourcePtr->fill_physCoor(a_dest, m_dXi);
 }
 
@@ -86,6 +87,7 @@ void LevelGeometry::fill_dxdXi (FArrayBox& a_dest) const
     CH_assert(a_dest.nComp() == SpaceDim*SpaceDim);
 
     // Fill data holder
+    MapTimeScope mapTime(*this);
     for (int bdir = 0; bdir < SpaceDim; ++bdir) {
         for (int adir = 0; adir < SpaceDim; ++adir) {
             const int comp = this->tensorCompCC(adir, bdir);
@@ -112,6 +114,7 @@ void LevelGeometry::fill_dXidx (FArrayBox& a_dest) const
     CH_assert(a_dest.nComp() == SpaceDim*SpaceDim);
 
     // Fill data holder
+    MapTimeScope mapTime(*this);
     for (int bdir = 0; bdir < SpaceDim; ++bdir) {
         for (int adir = 0; adir < SpaceDim; ++adir) {
             const int comp = this->tensorCompCC(adir, bdir);
@@ -137,6 +140,7 @@ void LevelGeometry::fill_J (FArrayBox& a_dest) const
     CH_assert(a_dest.nComp() == 1);
 
     // Fill data holder
+    MapTimeScope mapTime(*this);
     s_metricSourcePtr->fill_J(a_dest, 0, m_dXi);
 }
 
@@ -153,6 +157,7 @@ void LevelGeometry::fill_J (FluxBox& a_dest) const
     CH_assert(a_dest.nComp() == 1);
 
     // Fill data holder
+    MapTimeScope mapTime(*this);
     for (int adir = 0; adir < SpaceDim; ++adir) {
         s_metricSourcePtr->fill_J(a_dest[adir], 0, m_dXi);
     }
@@ -171,6 +176,7 @@ void LevelGeometry::fill_Jinv (FArrayBox& a_dest) const
     CH_assert(a_dest.nComp() == 1);
 
     // Fill data holder
+    MapTimeScope mapTime(*this);
     s_metricSourcePtr->fill_Jinv(a_dest, 0, m_dXi);
 }
 
@@ -212,6 +218,7 @@ void LevelGeometry::fill_gdn (FArrayBox& a_dest) const
     CH_assert(a_dest.nComp() == (SpaceDim * (SpaceDim + 1)) / 2);
 
     // Fill data holder
+    MapTimeScope mapTime(*this);
     for (int adir = 0; adir < SpaceDim; ++adir) {
         for (int bdir = adir; bdir < SpaceDim; ++bdir) {
             const int comp = this->symTensorCompCC(adir, bdir);
@@ -262,6 +269,7 @@ void LevelGeometry::fill_gup (FArrayBox& a_dest) const
     CH_assert(a_dest.nComp() == (SpaceDim * (SpaceDim + 1)) / 2);
 
     // Fill data holder
+    MapTimeScope mapTime(*this);
     for (int adir = 0; adir < SpaceDim; ++adir) {
         for (int bdir = adir; bdir < SpaceDim; ++bdir) {
             const int comp = this->symTensorCompCC(adir, bdir);
@@ -287,12 +295,9 @@ void LevelGeometry::fill_gup (FluxBox& a_dest) const
     CH_assert(a_dest.nComp() == SpaceDim);
 
     // Fill data holder
+    MapTimeScope mapTime(*this);
     for (int adir = 0; adir < SpaceDim; ++adir) {
-        for (int bdir = 0; bdir < SpaceDim; ++bdir) {
-            s_metricSourcePtr->fill_gup(a_dest[adir], bdir,
-                                        adir, bdir,
-                                        m_dXi);
-        }
+        s_metricSourcePtr->fill_gupRow(a_dest[adir], adir, m_dXi);
     }
 }
 
@@ -311,6 +316,7 @@ void LevelGeometry::fill_gup (FArrayBox& a_dest, int a_1, int a_2) const
     CH_assert(0 <= a_2 && a_2 < SpaceDim);
 
     // Fill data holder
+    MapTimeScope mapTime(*this);
     s_metricSourcePtr->fill_gup(a_dest, 0,
                                 a_1, a_2,
                                 m_dXi);
@@ -329,12 +335,9 @@ void LevelGeometry::fill_Jgup (FluxBox& a_dest) const
     CH_assert(a_dest.nComp() == SpaceDim);
 
     // Fill data holder
+    MapTimeScope mapTime(*this);
     for (int adir = 0; adir < SpaceDim; ++adir) {
-        for (int bdir = 0; bdir < SpaceDim; ++bdir) {
-            s_metricSourcePtr->fill_Jgup(a_dest[adir], bdir,
-                                         adir, bdir,
-                                         m_dXi);
-        }
+        s_metricSourcePtr->fill_JgupRow(a_dest[adir], adir, m_dXi);
     }
 }
 
@@ -355,11 +358,58 @@ void LevelGeometry::fill_Jgup (FArrayBox& a_dest, int a_mu) const
     CH_assert(0 <= a_mu && a_mu < SpaceDim);
 
     // Fill data holder
-    for (int nu = 0; nu < SpaceDim; ++nu) {
-        s_metricSourcePtr->fill_Jgup(a_dest, nu,
-                                     a_mu, nu,
-                                     m_dXi);
+    MapTimeScope mapTime(*this);
+    s_metricSourcePtr->fill_JgupRow(a_dest, a_mu, m_dXi);
+}
+
+
+// -----------------------------------------------------------------------------
+// Fills a FAB on vertical faces with the physical volume swept by each face
+// as the map moves from a_oldTime to a_newTime, per unit mapped volume.
+//
+// Since only z moves, the swept volume is the face's vertical displacement
+// times its (fixed) horizontal area. Dividing by the mapped cell volume gives
+//   gridFlux = [z(a_newTime) - z(a_oldTime)] * (dx/dXi) * (dy/dNu) / dZeta.
+// With this definition, the difference of gridFlux across a cell is exactly
+// the change in J, which is the discrete geometric conservation law.
+// -----------------------------------------------------------------------------
+void LevelGeometry::fill_gridFlux (FArrayBox& a_dest,
+                                   const Real a_oldTime,
+                                   const Real a_newTime) const
+{
+    CH_TIME("LevelGeometry::fill_gridFlux");
+
+    // Sanity checks
+    CH_assert(this->isDefined());
+    CH_assert(a_dest.nComp() == 1);
+    CH_assert(a_dest.box().type() == BASISV(SpaceDim-1));
+
+    if (!s_metricSourcePtr->isVerticalMotionOnly()) {
+        MayDay::Error("LevelGeometry::fill_gridFlux: "
+                      "Only maps with vertical motion are supported");
+    }
+
+    const Box& destBox = a_dest.box();
+    const Real curTime = s_metricSourcePtr->getTime();
+
+    // Vertical displacement of each face.
+    FArrayBox oldZ(destBox, 1);
+    s_metricSourcePtr->setTime(a_oldTime);
+    s_metricSourcePtr->fill_physCoor(oldZ, 0, SpaceDim-1, m_dXi);
+
+    s_metricSourcePtr->setTime(a_newTime);
+    s_metricSourcePtr->fill_physCoor(a_dest, 0, SpaceDim-1, m_dXi);
+    a_dest.minus(oldZ, 0, 0, 1);
+
+    s_metricSourcePtr->setTime(curTime);
+
+    // Scale by the horizontal area and the inverse mapped height.
+    FArrayBox dxdXiFAB(destBox, 1);
+    for (int dir = 0; dir < SpaceDim-1; ++dir) {
+        s_metricSourcePtr->fill_dxdXi(dxdXiFAB, 0, dir, dir, m_dXi);
+        a_dest.mult(dxdXiFAB, 0, 0, 1);
     }
+    a_dest.mult(1.0 / m_dXi[SpaceDim-1]);
 }
 
 
@@ -377,6 +427,7 @@ void LevelGeometry::fill_Gamma (FArrayBox& a_dest, int a_1, int a_2, int a_3) co
     // CH_assert(!isUniform()); // Should be handled as a special case.
 
     // Fill data holder
+    MapTimeScope mapTime(*this);
     s_metricSourcePtr->fill_Gamma(a_dest,
                                   0,  // a_dest comp
                                   a_1, a_2, a_3,
@@ -404,30 +455,37 @@ void LevelGeometry::averageMetricsDown ()
         int ncomps;
 
         { // CC J
-            t_CCJPtr crseMetricPtr = crseLevGeoPtr->m_CCJPtr;
-            const t_CCJPtr fineMetricPtr = fineLevGeoPtr->m_CCJPtr;
+            t_CCJPtr crseMetricPtr = crseLevGeoPtr->getCCJPtr();
+            const t_CCJPtr fineMetricPtr = fineLevGeoPtr->getCCJPtr();
             ncomps = fineMetricPtr->nComp();
             crseAvgObj.define(fineGrids, ncomps, refToCrse);
             crseAvgObj.averageToCoarse(*crseMetricPtr, *fineMetricPtr);
         }
 
         { // CC Jinv
-            t_CCJinvPtr crseMetricPtr = crseLevGeoPtr->m_CCJinvPtr;
-            const t_CCJinvPtr fineMetricPtr = fineLevGeoPtr->m_CCJinvPtr;
+            t_CCJinvPtr crseMetricPtr = crseLevGeoPtr->getCCJinvPtr();
+            const t_CCJinvPtr fineMetricPtr = fineLevGeoPtr->getCCJinvPtr();
             ncomps = fineMetricPtr->nComp();
             crseAvgObj.define(fineGrids, ncomps, refToCrse);
             crseAvgObj.averageToCoarseHarmonic(*crseMetricPtr, *fineMetricPtr);
         }
 
         { // CC gdn
-            t_CCgdnPtr crseMetricPtr = crseLevGeoPtr->m_CCgdnPtr;
-            const t_CCgdnPtr fineMetricPtr = fineLevGeoPtr->m_CCgdnPtr;
+            t_CCgdnPtr crseMetricPtr = crseLevGeoPtr->getCCgdnPtr();
+            const t_CCgdnPtr fineMetricPtr = fineLevGeoPtr->getCCgdnPtr();
             ncomps = fineMetricPtr->nComp();
             crseAvgObj.define(fineGrids, ncomps, refToCrse);
             crseAvgObj.averageToCoarse(*crseMetricPtr, *fineMetricPtr);
         }
 
         { // FC gup
+            // getFCgupPtr() is guarded by an assert, so create these directly.
+            if (crseLevGeoPtr->m_FCgupPtr.isNull()) {
+                crseLevGeoPtr->m_FCgupPtr = crseLevGeoPtr->createFCgupPtr(crseLevGeoPtr->m_grids);
+            }
+            if (fineLevGeoPtr->m_FCgupPtr.isNull()) {
+                fineLevGeoPtr->m_FCgupPtr = fineLevGeoPtr->createFCgupPtr(fineLevGeoPtr->m_grids);
+            }
             t_FCgupPtr crseMetricPtr = crseLevGeoPtr->m_FCgupPtr;
             const t_FCgupPtr fineMetricPtr = fineLevGeoPtr->m_FCgupPtr;
             ncomps = fineMetricPtr->nComp();
@@ -436,8 +494,8 @@ void LevelGeometry::averageMetricsDown ()
         }
 
         { // FC Jgup
-            t_FCJgupPtr crseMetricPtr = crseLevGeoPtr->m_FCJgupPtr;
-            const t_FCJgupPtr fineMetricPtr = fineLevGeoPtr->m_FCJgupPtr;
+            t_FCJgupPtr crseMetricPtr = crseLevGeoPtr->getFCJgupPtr();
+            const t_FCJgupPtr fineMetricPtr = fineLevGeoPtr->getFCJgupPtr();
             ncomps = fineMetricPtr->nComp();
             crseAvgFaceObj.define(fineGrids, ncomps, refToCrse);
             crseAvgFaceObj.averageToCoarseHarmonic(*crseMetricPtr, *fineMetricPtr);
@@ -600,6 +600,90 @@ void LevelGeometry::makeCovariant (FArrayBox&       a_coVect,
 }
 
 
+// -----------------------------------------------------------------------------
+// Adds a_scale times the mapped flux velocity of the grid to the vertical
+// faces of a_advVel, ghosts included. This is gridFlux (see fill_gridFlux)
+// times dZeta / dt, so the flux a_advVel - W moves each field through the
+// faces as they move from a_oldTime to a_newTime.
+// -----------------------------------------------------------------------------
+void LevelGeometry::addGridVelocity (LevelData<FluxBox>& a_advVel,
+                                     const Real          a_oldTime,
+                                     const Real          a_newTime,
+                                     const Real          a_scale) const
+{
+    CH_TIME("LevelGeometry::addGridVelocity");
+
+    // Sanity checks
+    CH_assert(this->isDefined());
+    CH_assert(a_advVel.getBoxes().compatible(m_grids));
+    CH_assert(a_newTime > a_oldTime);
+
+    const int vdir = SpaceDim-1;
+    const Real scale = a_scale * m_dXi[vdir] / (a_newTime - a_oldTime);
+
+    DataIterator dit = a_advVel.dataIterator();
+    for (dit.reset(); dit.ok(); ++dit) {
+        FArrayBox& advVelFAB = a_advVel[dit][vdir];
+
+        FArrayBox gridFlux(advVelFAB.box(), 1);
+        this->fill_gridFlux(gridFlux, a_oldTime, a_newTime);
+
+        for (int comp = 0; comp < advVelFAB.nComp(); ++comp) {
+            advVelFAB.plus(gridFlux, scale, 0, comp, 1);
+        }
+    }
+}
+
+
+// -----------------------------------------------------------------------------
+// Adds the geometric conservation law term to a_newState.
+//
+// a_newState was updated with the fluxes relative to the moving faces (see
+// addGridVelocity), but as if J were fixed at a_newTime,
+//   J^{n+1} q^* = J^{n+1} q^n - dt Div[(U - W) q].
+// The conservative update is J^{n+1} q^{n+1} = J^n q^n - dt Div[(U - W) q],
+// so q^{n+1} = q^* - (J^{n+1} - J^n) q^n / J^{n+1}. The change in J is the
+// difference of gridFlux across each cell. With Div[U] = 0, a uniform state
+// is preserved exactly.
+// -----------------------------------------------------------------------------
+void LevelGeometry::addGCLCorrection (LevelData<FArrayBox>&       a_newState,
+                                      const LevelData<FArrayBox>& a_oldState,
+                                      const Real                  a_oldTime,
+                                      const Real                  a_newTime) const
+{
+    CH_TIME("LevelGeometry::addGCLCorrection");
+
+    // Sanity checks
+    CH_assert(this->isDefined());
+    CH_assert(a_newState.getBoxes().compatible(m_grids));
+    CH_assert(a_oldState.getBoxes().compatible(m_grids));
+    CH_assert(a_newState.nComp() == a_oldState.nComp());
+
+    if (a_newTime == a_oldTime) return;
+
+    const int vdir = SpaceDim-1;
+    const int ncomps = a_newState.nComp();
+    const LevelData<FArrayBox>& Jinv = this->getCCJinv();
+
+    DataIterator dit = m_grids.dataIterator();
+    for (dit.reset(); dit.ok(); ++dit) {
+        const Box& valid = m_grids[dit];
+
+        FArrayBox gridFlux(surroundingNodes(valid, vdir), 1);
+        this->fill_gridFlux(gridFlux, a_oldTime, a_newTime);
+
+        for (int comp = 0; comp < ncomps; ++comp) {
+            FORT_ADDGCLCORRECTION(
+                CHF_FRA1(a_newState[dit], comp),
+                CHF_CONST_FRA1(a_oldState[dit], comp),
+                CHF_CONST_FRA1(gridFlux, 0),
+                CHF_CONST_FRA1(Jinv[dit], 0),
+                CHF_BOX(valid));
+        }
+    }
+}
+
+
 // -----------------------------------------------------------------------------
 // Contracts a CC covariant one-form with gup, making it a contravariant vector.
 // (static, single-grid version)
@@ -24,6 +24,7 @@
 #include "BathymetricBaseMap.H"
 #include "BathymetricBaseMapF_F.H"
 #include "ProblemContext.H"
+#include "Constants.H"
 #include "NodeInterpF_F.H"
 #include "ConvertFABF_F.H"
 #include "Subspace.H"
@@ -38,6 +39,8 @@ BathymetricBaseMap::BathymetricBaseMap ()
     const ProblemContext* ctx = ProblemContext::getInstance();
     m_L = ctx->domainLength;
     m_lev0DXi = m_L / RealVect(ctx->nx);
+    m_tidalAmplitude = ctx->tidalAmplitude;
+    m_tidalPeriod = ctx->tidalPeriod;
 }
 
 
@@ -48,6 +51,41 @@ BathymetricBaseMap::~BathymetricBaseMap ()
 {;}
 
 
+// -----------------------------------------------------------------------------
+// The free surface moves if a tidal amplitude was given.
+// -----------------------------------------------------------------------------
+bool BathymetricBaseMap::isTimeDependent () const
+{
+    return (m_tidalAmplitude != 0.0);
+}
+
+
+// -----------------------------------------------------------------------------
+// The horizontal coordinates never move.
+// -----------------------------------------------------------------------------
+bool BathymetricBaseMap::isVerticalMotionOnly () const
+{
+    return true;
+}
+
+
+// -----------------------------------------------------------------------------
+// Returns (H + eta(t)) / H, where eta = A sin(2 pi t / T) is the elevation of
+// the free surface above z = H.
+//
+// The vertical map z = d + (H + eta - d) * Zeta / H is just the static map
+// z = d' + (H - d') * Zeta / H with d' = d / stretch, scaled by stretch. So,
+// the Fortran kernels can be reused as long as we rescale their inputs.
+// -----------------------------------------------------------------------------
+Real BathymetricBaseMap::surfaceStretch () const
+{
+    if (m_tidalAmplitude == 0.0) return 1.0;
+
+    const Real eta = m_tidalAmplitude * sin(2.0 * PI * m_time / m_tidalPeriod);
+    return 1.0 + eta / m_L[SpaceDim-1];
+}
+
+
 // -----------------------------------------------------------------------------
 // Fills a mapped box with Cartesian locations.
 // This new code tries to generate a grid on AMR level 0, then perform
@@ -104,6 +142,12 @@ void BathymetricBaseMap::fill_physCoor (FArrayBox&      a_dest,
             // Get the node-centered local depths.
             this->fill_bathymetry(seaFloorFAB, SpaceDim-1, seaFloorFAB, a_dXi);
 
+            // Account for the free surface.
+            const Real stretch = this->surfaceStretch();
+            if (stretch != 1.0) {
+                seaFloorFAB.mult(1.0 / stretch, SpaceDim-1, 1);
+            }
+
             // Calculate the z-coordinate at each node.
             FArrayBox nodeZFAB(nodeBox, 1);
             FORT_FILL_BATHYVERTMAP(
@@ -114,6 +158,10 @@ void BathymetricBaseMap::fill_physCoor (FArrayBox&      a_dest,
                 CHF_CONST_REALVECT(m_L),
                 CHF_CONST_REALVECT(a_dXi));
 
+            if (stretch != 1.0) {
+                nodeZFAB.mult(stretch);
+            }
+
             // Convert data to destBoxType.
             FORT_CONVERTFAB(
                 CHF_FRA1(a_dest, a_destComp),
@@ -195,6 +243,13 @@ void BathymetricBaseMap::fill_dxdXi (FArrayBox&      a_dest,
             FArrayBox seaFloorFAB(bottomNodeBox, 1);
             this->fill_bathymetry(seaFloorFAB, 0, cartPosFAB, a_dXi);
 
+            // Account for the free surface.
+            const Real stretch = this->surfaceStretch();
+            const Real scale = a_scale * stretch;
+            if (stretch != 1.0) {
+                seaFloorFAB.mult(1.0 / stretch);
+            }
+
             // Compute the Jacobian element at edges in the a_nu-direction.
             if (destBoxType == edgeBoxType) {
                 FORT_FILL_BATHYDZDXI(
@@ -204,7 +259,7 @@ void BathymetricBaseMap::fill_dxdXi (FArrayBox&      a_dest,
                     CHF_CONST_FRA1(seaFloorFAB,0),
                     CHF_CONST_REALVECT(m_L),
                     CHF_CONST_REALVECT(a_dXi),
-                    CHF_CONST_REAL(a_scale));
+                    CHF_CONST_REAL(scale));
             } else {
                 const Box edgeBox(enclosedCells(nodeBox, a_nu));
                 FArrayBox edgeElemFAB(edgeBox, 1);
@@ -215,7 +270,7 @@ void BathymetricBaseMap::fill_dxdXi (FArrayBox&      a_dest,
                     CHF_CONST_FRA1(seaFloorFAB,0),
                     CHF_CONST_REALVECT(m_L),
                     CHF_CONST_REALVECT(a_dXi),
-                    CHF_CONST_REAL(a_scale));
+                    CHF_CONST_REAL(scale));
 
                 // Convert to the desired centering
                 FORT_CONVERTFAB(
@@ -247,6 +302,13 @@ void BathymetricBaseMap::fill_dxdXi (FArrayBox&      a_dest,
             FArrayBox seaFloorFAB(bottomNodeBox, 1);
             this->fill_bathymetry(seaFloorFAB, 0, cartPosFAB, a_dXi);
 
+            // Account for the free surface.
+            const Real stretch = this->surfaceStretch();
+            const Real scale = a_scale * stretch;
+            if (stretch != 1.0) {
+                seaFloorFAB.mult(1.0 / stretch);
+            }
+
             // Calculate the Jacobian element at the nodes
             if (destBoxType == nodeBoxType) {
                 FORT_FILL_BATHYDZDZETA(
@@ -255,7 +317,7 @@ void BathymetricBaseMap::fill_dxdXi (FArrayBox&      a_dest,
                     CHF_CONST_FRA1(seaFloorFAB, 0),
                     CHF_CONST_REALVECT(m_L),
                     CHF_CONST_REALVECT(a_dXi),
-                    CHF_CONST_REAL(a_scale));
+                    CHF_CONST_REAL(scale));
             } else {
                 FArrayBox nodeVals(nodeBox, 1);
                 FORT_FILL_BATHYDZDZETA(
@@ -264,7 +326,7 @@ void BathymetricBaseMap::fill_dxdXi (FArrayBox&      a_dest,
                     CHF_CONST_FRA1(seaFloorFAB, 0),
                     CHF_CONST_REALVECT(m_L),
                     CHF_CONST_REALVECT(a_dXi),
-                    CHF_CONST_REAL(a_scale));
+                    CHF_CONST_REAL(scale));
 
                 // Convert to the desired centering
                 FORT_CONVERTFAB(
@@ -280,6 +280,44 @@ void CartesianMap::fill_Jgup (FArrayBox&      a_dest,
 }
 
 
+// -----------------------------------------------------------------------------
+// Fills an FArrayBox with one row of the contravariant metric, gup^{a_mu,*}
+// -----------------------------------------------------------------------------
+void CartesianMap::fill_gupRow (FArrayBox&      a_dest,
+                                const int       a_mu,
+                                const RealVect& a_dXi,
+                                const Real      a_scale) const
+{
+    CH_TIME("CartesianMap::fill_gupRow");
+
+    // Sanity checks
+    CH_assert(a_dest.nComp() == SpaceDim);
+    CH_assert((0 <= a_mu) && (a_mu < SpaceDim));
+
+    a_dest.setVal(0.0);
+    a_dest.setVal(a_scale, a_mu);
+}
+
+
+// -----------------------------------------------------------------------------
+// Fills an FArrayBox with one row of J * gup, Jgup^{a_mu,*}
+// -----------------------------------------------------------------------------
+void CartesianMap::fill_JgupRow (FArrayBox&      a_dest,
+                                 const int       a_mu,
+                                 const RealVect& a_dXi,
+                                 const Real      a_scale) const
+{
+    CH_TIME("CartesianMap::fill_JgupRow");
+
+    // Sanity checks
+    CH_assert(a_dest.nComp() == SpaceDim);
+    CH_assert((0 <= a_mu) && (a_mu < SpaceDim));
+
+    a_dest.setVal(0.0);
+    a_dest.setVal(a_scale, a_mu);
+}
+
+
 // -----------------------------------------------------------------------------
 // Fills an FArrayBox with the connection elements
 // Note that although this function is provided and works, it is never used
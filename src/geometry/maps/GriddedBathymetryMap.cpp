@@ -0,0 +1,334 @@
+/*******************************************************************************
+ *  SOMAR - Stratified Ocean Model with Adaptive Refinement
+ *  Developed by Ed Santilli & Alberto Scotti
+ *  Copyright (C) 2014 University of North Carolina at Chapel Hill
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301
+ *  USA
+ *
+ *  For up-to-date contact information, please visit the repository homepage,
+ *  https://github.com/somarhub.
+ ******************************************************************************/
+#include "GriddedBathymetryMap.H"
+#include "ProblemContext.H"
+#include "Subspace.H"
+#include "BoxIterator.H"
+#include "CH_HDF5.H"
+#include "Constants.H"
+#include "Debug.H"
+#include <sstream>
+
+
+// Static variables
+bool                              GriddedBathymetryMap::s_headerIsRead = false;
+std::string                       GriddedBathymetryMap::s_filename;
+Vector<IntVect>                   GriddedBathymetryMap::s_pyrN;
+Vector<RealVect>                  GriddedBathymetryMap::s_pyrDx;
+Vector<RealVect>                  GriddedBathymetryMap::s_pyrX0;
+Vector<RefCountedPtr<FArrayBox> > GriddedBathymetryMap::s_pyrElevPtr;
+
+
+// -----------------------------------------------------------------------------
+// Construtor
+// -----------------------------------------------------------------------------
+GriddedBathymetryMap::GriddedBathymetryMap ()
+: BathymetricBaseMap()
+{
+    if (!s_headerIsRead) {
+        const ProblemContext* ctx = ProblemContext::getInstance();
+        s_filename = ctx->bathymetryFile;
+
+        readPyramidHeader();
+        s_headerIsRead = true;
+    }
+}
+
+
+// -----------------------------------------------------------------------------
+// Destructor
+// -----------------------------------------------------------------------------
+GriddedBathymetryMap::~GriddedBathymetryMap ()
+{;}
+
+
+// -----------------------------------------------------------------------------
+// Must return the name of the coordinate mapping
+// -----------------------------------------------------------------------------
+const char* GriddedBathymetryMap::getCoorMapName () const
+{
+    return "GriddedBathymetryMap";
+}
+
+
+// -----------------------------------------------------------------------------
+// Must return whether or not this metric is diagonal
+// -----------------------------------------------------------------------------
+bool GriddedBathymetryMap::isDiagonal () const
+{
+    return false;
+}
+
+
+// -----------------------------------------------------------------------------
+// Fills a NodeFAB with the bathymetric data. a_dest must be flat in the
+// vertical. Upon return, each point in the horizontal (Xi,Eta) of a_dest
+// will contain the (positive) local depth.
+// NOTE: This vertical distance is measured in a straight line perpendicular
+// to the surface. We are measuring this distance along the Cartesian
+// vertical coordinate line, not the mapped vertical coordinate line.
+// -----------------------------------------------------------------------------
+void GriddedBathymetryMap::fill_bathymetry (FArrayBox&       a_dest,
+                                            const int        a_destComp,
+                                            const FArrayBox& a_cartPos,
+                                            const RealVect&  a_dXi) const
+{
+    CH_TIME("GriddedBathymetryMap::fill_bathymetry");
+
+    const Box& destBox = a_dest.box();
+    const IntVect destBoxType = destBox.type();
+
+    // The holder needs to be flat and nodal in the vertical.
+    CH_assert(destBox == horizontalDataBox(destBox));
+    CH_assert(destBoxType[SpaceDim-1] == 1);
+    CH_assert(a_cartPos.box().contains(destBox));
+    CH_assert(a_cartPos.nComp() >= SpaceDim-1);
+
+    // Choose the pyramid level and make sure it is in memory.
+    const int pyrLev = selectPyramidLevel(a_dXi);
+    readPyramidLevel(pyrLev);
+
+    const IntVect&   n = s_pyrN[pyrLev];
+    const RealVect&  dx = s_pyrDx[pyrLev];
+    const RealVect&  x0 = s_pyrX0[pyrLev];
+    const FArrayBox& elevFAB = *s_pyrElevPtr[pyrLev];
+
+    // Bilinear interpolation of the nodal elevations. Points outside of the
+    // pyramid's extents receive the value at the nearest edge.
+    IntVect lo = IntVect::Zero;
+    Real frac[CH_SPACEDIM];
+    frac[SpaceDim-1] = 0.0;
+
+    BoxIterator bit(destBox);
+    for (bit.reset(); bit.ok(); ++bit) {
+        const IntVect& iv = bit();
+
+        for (int dir = 0; dir < SpaceDim-1; ++dir) {
+            Real pos = (a_cartPos(iv,dir) - x0[dir]) / dx[dir];
+            pos = Max(pos, 0.0);
+            pos = Min(pos, Real(n[dir]-1));
+
+            lo[dir] = Min(int(floor(pos)), n[dir]-2);
+            frac[dir] = pos - Real(lo[dir]);
+        }
+
+#if CH_SPACEDIM == 2
+        a_dest(iv,a_destComp) = (1.0-frac[0]) * elevFAB(lo)
+                              +      frac[0]  * elevFAB(lo + BASISV(0));
+#else
+        a_dest(iv,a_destComp) = (1.0-frac[0]) * (1.0-frac[1]) * elevFAB(lo)
+                              +      frac[0]  * (1.0-frac[1]) * elevFAB(lo + BASISV(0))
+                              + (1.0-frac[0]) *      frac[1]  * elevFAB(lo + BASISV(1))
+                              +      frac[0]  *      frac[1]  * elevFAB(lo + BASISV(0) + BASISV(1));
+#endif
+    }
+}
+
+
+// -----------------------------------------------------------------------------
+// Returns the index of the coarsest pyramid level whose horizontal
+// resolution is at least as fine as a_dXi. If no such level exists,
+// the finest level is returned.
+// -----------------------------------------------------------------------------
+int GriddedBathymetryMap::selectPyramidLevel (const RealVect& a_dXi)
+{
+    CH_assert(s_headerIsRead);
+
+    const int numPyrLevels = s_pyrN.size();
+    for (int pyrLev = 0; pyrLev < numPyrLevels; ++pyrLev) {
+        bool resolves = true;
+        for (int dir = 0; dir < SpaceDim-1; ++dir) {
+            resolves &= (s_pyrDx[pyrLev][dir] <= a_dXi[dir] * (1.0 + 1.0e-10));
+        }
+        if (resolves) return pyrLev;
+    }
+    return numPyrLevels - 1;
+}
+
+
+// -----------------------------------------------------------------------------
+// Reads the pyramid's metadata (number of levels, extents, resolutions).
+// -----------------------------------------------------------------------------
+void GriddedBathymetryMap::readPyramidHeader ()
+{
+    CH_TIME("GriddedBathymetryMap::readPyramidHeader");
+
+    hid_t fileID = H5Fopen(s_filename.c_str(), H5F_ACC_RDONLY, H5P_DEFAULT);
+    if (fileID < 0) {
+        ostringstream msg;
+        msg << "H5Fopen failed to open " << s_filename << ". Return value = " << fileID;
+        MayDay::Error(msg.str().c_str());
+    }
+
+    // How many levels are in the pyramid?
+    int numPyrLevels = 0;
+    {
+        hid_t rootID = H5Gopen(fileID, "/");
+        hid_t attrID = H5Aopen_name(rootID, "num_levels");
+        if (attrID < 0) {
+            MayDay::Error("GriddedBathymetryMap: could not find the num_levels attribute");
+        }
+        H5Aread(attrID, H5T_NATIVE_INT, &numPyrLevels);
+        H5Aclose(attrID);
+        H5Gclose(rootID);
+    }
+    if (numPyrLevels < 1) {
+        MayDay::Error("GriddedBathymetryMap: pyramid must have at least one level");
+    }
+
+    s_pyrN.resize(numPyrLevels);
+    s_pyrDx.resize(numPyrLevels);
+    s_pyrX0.resize(numPyrLevels);
+    s_pyrElevPtr.resize(numPyrLevels);
+
+    pout() << "GriddedBathymetryMap: reading " << s_filename << endl;
+
+    // Read each level's metadata.
+    for (int pyrLev = 0; pyrLev < numPyrLevels; ++pyrLev) {
+        ostringstream groupName;
+        groupName << "/level_" << pyrLev;
+
+        hid_t groupID = H5Gopen(fileID, groupName.str().c_str());
+        if (groupID < 0) {
+            ostringstream msg;
+            msg << "H5Gopen failed to open " << groupName.str() << ". Return value = " << groupID;
+            MayDay::Error(msg.str().c_str());
+        }
+
+        int n[CH_SPACEDIM-1];
+        double dx[CH_SPACEDIM-1];
+        double x0[CH_SPACEDIM-1];
+        {
+            hid_t attrID = H5Aopen_name(groupID, "n");
+            H5Aread(attrID, H5T_NATIVE_INT, n);
+            H5Aclose(attrID);
+
+            attrID = H5Aopen_name(groupID, "dx");
+            H5Aread(attrID, H5T_NATIVE_DOUBLE, dx);
+            H5Aclose(attrID);
+
+            attrID = H5Aopen_name(groupID, "x0");
+            H5Aread(attrID, H5T_NATIVE_DOUBLE, x0);
+            H5Aclose(attrID);
+        }
+        H5Gclose(groupID);
+
+        s_pyrN[pyrLev] = IntVect::Unit;
+        s_pyrDx[pyrLev] = RealVect::Unit;
+        s_pyrX0[pyrLev] = RealVect::Zero;
+        for (int dir = 0; dir < SpaceDim-1; ++dir) {
+            s_pyrN[pyrLev][dir] = n[dir];
+            s_pyrDx[pyrLev][dir] = dx[dir];
+            s_pyrX0[pyrLev][dir] = x0[dir];
+
+            if (n[dir] < 2 || dx[dir] <= 0.0) {
+                ostringstream msg;
+                msg << "GriddedBathymetryMap: " << groupName.str()
+                    << " has a bad n or dx in direction " << dir;
+                MayDay::Error(msg.str().c_str());
+            }
+            if (pyrLev > 0 && !(dx[dir] < s_pyrDx[pyrLev-1][dir])) {
+                ostringstream msg;
+                msg << "GriddedBathymetryMap: " << groupName.str()
+                    << " is not finer than the previous pyramid level";
+                MayDay::Error(msg.str().c_str());
+            }
+        }
+
+        pout() << "\tlevel " << pyrLev
+               << ": n = " << s_pyrN[pyrLev]
+               << ", dx = " << s_pyrDx[pyrLev]
+               << ", x0 = " << s_pyrX0[pyrLev] << endl;
+    }
+
+    H5Fclose(fileID);
+}
+
+
+// -----------------------------------------------------------------------------
+// Reads the elevations of pyramid level a_pyrLev, if not already cached.
+// -----------------------------------------------------------------------------
+void GriddedBathymetryMap::readPyramidLevel (const int a_pyrLev)
+{
+    CH_assert(s_headerIsRead);
+    CH_assert(0 <= a_pyrLev && a_pyrLev < s_pyrN.size());
+
+    if (!s_pyrElevPtr[a_pyrLev].isNull()) return;
+
+    CH_TIME("GriddedBathymetryMap::readPyramidLevel");
+
+    const IntVect& n = s_pyrN[a_pyrLev];
+    const Box pyrBox(IntVect::Zero, n - IntVect::Unit);
+    CH_assert(pyrBox == horizontalDataBox(pyrBox));
+
+    // Read the elevations into a flat buffer.
+    Vector<double> elevVect(pyrBox.numPts(), quietNAN);
+    {
+        hid_t fileID = H5Fopen(s_filename.c_str(), H5F_ACC_RDONLY, H5P_DEFAULT);
+        if (fileID < 0) {
+            ostringstream msg;
+            msg << "H5Fopen failed to open " << s_filename << ". Return value = " << fileID;
+            MayDay::Error(msg.str().c_str());
+        }
+
+        ostringstream dsetName;
+        dsetName << "/level_" << a_pyrLev << "/elevation";
+
+        hid_t elevID = H5Dopen(fileID, dsetName.str().c_str());
+        if (elevID < 0) {
+            ostringstream msg;
+            msg << "H5Dopen failed to open " << dsetName.str() << ". Return value = " << elevID;
+            MayDay::Error(msg.str().c_str());
+        }
+        herr_t status = H5Dread(elevID,             // hid_t dataset_id    IN: Identifier of the dataset read from.
+                                H5T_NATIVE_DOUBLE,  // hid_t mem_type_id   IN: Identifier of the memory datatype.
+                                H5S_ALL,            // hid_t mem_space_id  IN: Identifier of the memory dataspace.
+                                H5S_ALL,            // hid_t file_space_id IN: Identifier of the dataset's dataspace in the file.
+                                H5P_DEFAULT,        // hid_t xfer_plist_id     IN: Identifier of a transfer property list for this I/O operation.
+                                &elevVect[0]);      // void * buf  OUT: Buffer to receive data read from file.
+        H5Dclose(elevID);
+        H5Fclose(fileID);
+
+        if (status < 0) {
+            ostringstream msg;
+            msg << "H5Dread failed to read " << dsetName.str() << ". Return value = " << status;
+            MayDay::Error(msg.str().c_str());
+        }
+    }
+
+    // Package the data into an FArrayBox. The file is row-major.
+    s_pyrElevPtr[a_pyrLev] = RefCountedPtr<FArrayBox>(new FArrayBox(pyrBox, 1));
+    FArrayBox& elevFAB = *s_pyrElevPtr[a_pyrLev];
+
+    BoxIterator bit(pyrBox);
+    for (bit.reset(); bit.ok(); ++bit) {
+        const IntVect& iv = bit();
+#if CH_SPACEDIM == 2
+        const int idx = iv[0];
+#else
+        const int idx = iv[1] + iv[0]*n[1];
+#endif
+        elevFAB(iv) = elevVect[idx];
+    }
+}
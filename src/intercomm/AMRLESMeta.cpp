@@ -51,6 +51,16 @@ int AMRLESMeta::les2amrLeader = MPI_UNDEFINED_RANK;
 MPI_Comm AMRLESMeta::interComm = MPI_COMM_NULL;
 MPI_Comm AMRLESMeta::amrlesPeerComm = MPI_COMM_NULL;
 
+// Dedicated plot I/O intracommunication
+int       AMRLESMeta::ioRank  = MPI_UNDEFINED_RANK;
+int       AMRLESMeta::ioSize  = 0;
+MPI_Comm  AMRLESMeta::ioComm  = MPI_COMM_NULL;
+MPI_Group AMRLESMeta::ioGroup = MPI_GROUP_NULL;
+
+// AMR/IO intercommunication
+MPI_Comm AMRLESMeta::amrioInterComm = MPI_COMM_NULL;
+MPI_Comm AMRLESMeta::amrioPeerComm = MPI_COMM_NULL;
+
 
 
 // -----------------------------------------------------------------------------
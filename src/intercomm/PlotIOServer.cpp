@@ -0,0 +1,426 @@
+/*******************************************************************************
+ *  SOMAR - Stratified Ocean Model with Adaptive Refinement
+ *  Developed by Ed Santilli & Alberto Scotti
+ *  Copyright (C) 2014 University of North Carolina at Chapel Hill
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301
+ *  USA
+ *
+ *  For up-to-date contact information, please visit the repository homepage,
+ *  https://github.com/somarhub.
+ ******************************************************************************/
+#ifdef CH_USE_HDF5
+
+#include "PlotIOServer.H"
+#include "PackUtils.H"
+#include "LayoutIterator.H"
+#include "SPMD.H"
+#include "MayDay.H"
+#include "CH_Timer.H"
+#include "parstream.H"
+#include <sstream>
+#include <iomanip>
+#include <map>
+#include <algorithm>
+#include <climits>
+
+
+// Static members
+std::string              PlotIOServer::s_descBuffer;
+std::vector<Real>        PlotIOServer::s_dataBuffer;
+std::vector<MPI_Request> PlotIOServer::s_requests;
+
+
+// -----------------------------------------------------------------------------
+// Are plot files being shipped to dedicated I/O ranks?
+// -----------------------------------------------------------------------------
+bool PlotIOServer::isActive ()
+{
+#ifdef CH_MPI
+    return (AMRLESMeta::ioSize > 0 &&
+            AMRLESMeta::isGroupMember(AMRLESMeta::amrGroup));
+#else
+    return false;
+#endif
+}
+
+
+// -----------------------------------------------------------------------------
+// AMR side. Snapshots the plot data and posts the sends to the I/O ranks.
+// This returns before the data arrives, so a_levData may be freed.
+// -----------------------------------------------------------------------------
+void PlotIOServer::sendPlotFile (const std::string&                   a_filename,
+                                 const HDF5HeaderData&                a_amrHeader,
+                                 const HDF5HeaderData&                a_plotHeader,
+                                 const Vector<HDF5HeaderData>&        a_levHeaders,
+                                 const Vector<LevelData<FArrayBox>*>& a_levData,
+                                 const PlotWriteOptions&              a_opts)
+{
+#ifdef CH_MPI
+    CH_TIME("PlotIOServer::sendPlotFile");
+    using namespace AMRLESMeta;
+
+    CH_assert(isActive());
+    CH_assert(a_levHeaders.size() == a_levData.size());
+
+    const int numLevels = a_levData.size();
+
+    // The staging buffer may still be in flight.
+    wait();
+
+    // Snapshot the local data, level by level in layout order.
+    size_t count = 0;
+    for (int lev = 0; lev < numLevels; ++lev) {
+        const LevelData<FArrayBox>& data = *a_levData[lev];
+        DataIterator dit = data.dataIterator();
+        for (dit.reset(); dit.ok(); ++dit) {
+            count += data[dit].box().numPts() * data.nComp();
+        }
+    }
+    CH_assert(count < size_t(INT_MAX));
+
+    s_dataBuffer.resize(count);
+    size_t offset = 0;
+    for (int lev = 0; lev < numLevels; ++lev) {
+        const LevelData<FArrayBox>& data = *a_levData[lev];
+        DataIterator dit = data.dataIterator();
+        for (dit.reset(); dit.ok(); ++dit) {
+            const FArrayBox& dataFAB = data[dit];
+            const size_t fabCount = dataFAB.box().numPts() * dataFAB.nComp();
+            const Real* srcPtr = dataFAB.dataPtr(0);
+            std::copy(srcPtr, srcPtr + fabCount, &s_dataBuffer[offset]);
+            offset += fabCount;
+        }
+    }
+
+    // Rank 0 describes the file: headers, layouts, and box owners.
+    if (procID() == 0) {
+        std::ostringstream os;
+        os << std::setprecision(17) << std::scientific;
+
+        packString(os, a_filename);
+        os << a_opts.precision << ' '
+           << a_opts.deflateLevel << ' '
+           << int(a_opts.useShuffle) << ' '
+           << a_opts.chunkSize << '\n';
+        packHeader(os, a_amrHeader);
+        packHeader(os, a_plotHeader);
+        os << numLevels << '\n';
+
+        for (int lev = 0; lev < numLevels; ++lev) {
+            const LevelData<FArrayBox>& data = *a_levData[lev];
+            const DisjointBoxLayout& grids = data.getBoxes();
+            const ProblemDomain& domain = grids.physDomain();
+
+            packHeader(os, a_levHeaders[lev]);
+            packBox(os, domain.domainBox());
+            for (int dir = 0; dir < SpaceDim; ++dir) {
+                os << int(domain.isPeriodic(dir)) << ' ';
+            }
+            os << data.nComp() << ' ';
+            packIntVect(os, data.ghostVect());
+            os << '\n' << grids.size() << '\n';
+
+            LayoutIterator lit = grids.layoutIterator();
+            for (lit.reset(); lit.ok(); ++lit) {
+                packBox(os, grids[lit()]);
+                os << grids.procID(lit()) << '\n';
+            }
+        }
+
+        s_descBuffer = os.str();
+
+        MPI_Request req;
+        MPI_Isend(&s_descBuffer[0], int(s_descBuffer.size()), MPI_CHAR,
+                  0, TAG_PLOTIO_DESC, amrioInterComm, &req);
+        s_requests.push_back(req);
+    }
+
+    // Ship our boxes to our I/O rank.
+    if (count > 0) {
+        MPI_Request req;
+        MPI_Isend(&s_dataBuffer[0], int(count), MPI_CH_REAL,
+                  procID() % ioSize, TAG_PLOTIO_DATA, amrioInterComm, &req);
+        s_requests.push_back(req);
+    }
+#else
+    MayDay::Error("PlotIOServer::sendPlotFile requires MPI");
+#endif
+}
+
+
+// -----------------------------------------------------------------------------
+// AMR side. Lets MPI make progress on the outstanding sends.
+// -----------------------------------------------------------------------------
+void PlotIOServer::progress ()
+{
+#ifdef CH_MPI
+    if (s_requests.empty()) return;
+
+    int flag = 0;
+    MPI_Testall(int(s_requests.size()), &s_requests[0], &flag, MPI_STATUSES_IGNORE);
+    if (flag) {
+        s_requests.clear();
+    }
+#endif
+}
+
+
+// -----------------------------------------------------------------------------
+// AMR side. Blocks until the staging buffer can be reused.
+// -----------------------------------------------------------------------------
+void PlotIOServer::wait ()
+{
+#ifdef CH_MPI
+    CH_TIME("PlotIOServer::wait");
+
+    if (s_requests.empty()) return;
+
+    MPI_Waitall(int(s_requests.size()), &s_requests[0], MPI_STATUSES_IGNORE);
+    s_requests.clear();
+#endif
+}
+
+
+// -----------------------------------------------------------------------------
+// AMR side. Waits for the outstanding sends, then tells the I/O ranks to
+// shut down. Call this on every AMR rank.
+// -----------------------------------------------------------------------------
+void PlotIOServer::stop ()
+{
+#ifdef CH_MPI
+    if (!isActive()) return;
+
+    wait();
+
+    // An empty description is the stop signal.
+    if (procID() == 0) {
+        MPI_Send(NULL, 0, MPI_CHAR, 0, AMRLESMeta::TAG_PLOTIO_DESC,
+                 AMRLESMeta::amrioInterComm);
+    }
+
+    s_descBuffer.clear();
+    s_dataBuffer.clear();
+#endif
+}
+
+
+// -----------------------------------------------------------------------------
+// I/O side. Receives and writes plot files until stop is called.
+// -----------------------------------------------------------------------------
+void PlotIOServer::serve ()
+{
+#ifdef CH_MPI
+    CH_TIME("PlotIOServer::serve");
+    CH_assert(AMRLESMeta::isGroupMember(AMRLESMeta::ioGroup));
+
+    std::string desc;
+    while (receiveDescription(desc)) {
+        writePlotFile(desc);
+    }
+#endif
+}
+
+
+// -----------------------------------------------------------------------------
+// Receives one file description. Returns false on the stop signal.
+// -----------------------------------------------------------------------------
+bool PlotIOServer::receiveDescription (std::string& a_desc)
+{
+#ifdef CH_MPI
+    using namespace AMRLESMeta;
+
+    int len = 0;
+    if (ioRank == 0) {
+        MPI_Status status;
+        MPI_Probe(0, TAG_PLOTIO_DESC, amrioInterComm, &status);
+        MPI_Get_count(&status, MPI_CHAR, &len);
+
+        a_desc.resize(len);
+        MPI_Recv(((len > 0)? &a_desc[0]: NULL), len, MPI_CHAR,
+                 0, TAG_PLOTIO_DESC, amrioInterComm, MPI_STATUS_IGNORE);
+    }
+
+    MPI_Bcast(&len, 1, MPI_INT, 0, ioComm);
+    if (len == 0) return false;
+
+    a_desc.resize(len);
+    MPI_Bcast(&a_desc[0], len, MPI_CHAR, 0, ioComm);
+    return true;
+#else
+    return false;
+#endif
+}
+
+
+// -----------------------------------------------------------------------------
+// Receives and writes the plot file described by a_desc.
+// -----------------------------------------------------------------------------
+void PlotIOServer::writePlotFile (const std::string& a_desc)
+{
+#ifdef CH_MPI
+    CH_TIME("PlotIOServer::writePlotFile");
+    using namespace AMRLESMeta;
+
+    // Parse the description and build the layouts. Each box goes to the
+    // I/O rank that its AMR owner ships to.
+    std::istringstream is(a_desc);
+
+    std::string filename;
+    PlotWriteOptions opts;
+    HDF5HeaderData amrHeader, plotHeader;
+    int numLevels = 0;
+
+    unpackString(is, filename);
+    {
+        int shuffleFlag;
+        is >> opts.precision >> opts.deflateLevel >> shuffleFlag >> opts.chunkSize;
+        opts.useShuffle = (shuffleFlag != 0);
+    }
+    unpackHeader(is, amrHeader);
+    unpackHeader(is, plotHeader);
+    is >> numLevels;
+
+    Vector<HDF5HeaderData>                       levHeaders(numLevels);
+    Vector<IntVect>                              levGhost(numLevels);
+    Vector<Vector<Box> >                         levBoxes(numLevels);
+    Vector<Vector<int> >                         levAMRProcs(numLevels);
+    Vector<RefCountedPtr<LevelData<FArrayBox> > > levData(numLevels);
+
+    for (int lev = 0; lev < numLevels; ++lev) {
+        Box domBox;
+        bool isPeriodic[CH_SPACEDIM];
+        int numComps = 0;
+        int numBoxes = 0;
+
+        unpackHeader(is, levHeaders[lev]);
+        unpackBox(is, domBox);
+        for (int dir = 0; dir < SpaceDim; ++dir) {
+            int periodicFlag;
+            is >> periodicFlag;
+            isPeriodic[dir] = (periodicFlag != 0);
+        }
+        is >> numComps;
+        unpackIntVect(is, levGhost[lev]);
+        is >> numBoxes;
+
+        levBoxes[lev].resize(numBoxes);
+        levAMRProcs[lev].resize(numBoxes);
+        Vector<int> ioProcs(numBoxes);
+        for (int b = 0; b < numBoxes; ++b) {
+            unpackBox(is, levBoxes[lev][b]);
+            is >> levAMRProcs[lev][b];
+            ioProcs[b] = levAMRProcs[lev][b] % ioSize;
+        }
+
+        if (is.fail()) {
+            MayDay::Error("PlotIOServer::writePlotFile received a corrupt file description");
+        }
+
+        DisjointBoxLayout grids(levBoxes[lev], ioProcs, ProblemDomain(domBox, isPeriodic));
+        levData[lev] = RefCountedPtr<LevelData<FArrayBox> >(
+            new LevelData<FArrayBox>(grids, numComps, levGhost[lev])
+        );
+    }
+
+    // Post the receives. We hear from AMR ranks ioRank, ioRank + ioSize, ...
+    std::vector<int> srcRanks;
+    for (int r = ioRank; r < amrSize; r += ioSize) {
+        srcRanks.push_back(r);
+    }
+
+    std::vector<std::vector<Real> > recvBuffers(srcRanks.size());
+    std::vector<MPI_Request> recvRequests;
+
+    for (size_t s = 0; s < srcRanks.size(); ++s) {
+        size_t count = 0;
+        for (int lev = 0; lev < numLevels; ++lev) {
+            const int numComps = levData[lev]->nComp();
+            for (int b = 0; b < levBoxes[lev].size(); ++b) {
+                if (levAMRProcs[lev][b] != srcRanks[s]) continue;
+                count += grow(levBoxes[lev][b], levGhost[lev]).numPts() * numComps;
+            }
+        }
+        if (count == 0) continue;
+
+        recvBuffers[s].resize(count);
+
+        MPI_Request req;
+        MPI_Irecv(&recvBuffers[s][0], int(count), MPI_CH_REAL,
+                  srcRanks[s], TAG_PLOTIO_DATA, amrioInterComm, &req);
+        recvRequests.push_back(req);
+    }
+
+    if (!recvRequests.empty()) {
+        MPI_Waitall(int(recvRequests.size()), &recvRequests[0], MPI_STATUSES_IGNORE);
+    }
+
+    // Unpack. Each buffer holds its sender's boxes, level by level, in
+    // layout order.
+    std::vector<size_t> offsets(srcRanks.size(), 0);
+
+    for (int lev = 0; lev < numLevels; ++lev) {
+        LevelData<FArrayBox>& data = *levData[lev];
+
+        std::map<IntVect, DataIndex, SmallEndLT> localIndex;
+        DataIterator dit = data.dataIterator();
+        for (dit.reset(); dit.ok(); ++dit) {
+            localIndex[data.getBoxes()[dit].smallEnd()] = dit();
+        }
+
+        for (size_t s = 0; s < srcRanks.size(); ++s) {
+            size_t& offset = offsets[s];
+
+            for (int b = 0; b < levBoxes[lev].size(); ++b) {
+                if (levAMRProcs[lev][b] != srcRanks[s]) continue;
+
+                CH_assert(localIndex.find(levBoxes[lev][b].smallEnd()) != localIndex.end());
+                FArrayBox& dataFAB = data[localIndex[levBoxes[lev][b].smallEnd()]];
+                CH_assert(dataFAB.box() == grow(levBoxes[lev][b], levGhost[lev]));
+
+                const size_t fabCount = dataFAB.box().numPts() * dataFAB.nComp();
+                const Real* srcPtr = &recvBuffers[s][offset];
+                std::copy(srcPtr, srcPtr + fabCount, dataFAB.dataPtr(0));
+                offset += fabCount;
+            }
+        }
+    }
+
+    // Write the file exactly as LepticAMR::writePlotFile would.
+    HDF5Handle handle(filename.c_str(), HDF5Handle::CREATE);
+
+    amrHeader.writeToFile(handle);
+    plotHeader.writeToFile(handle);
+
+    for (int lev = 0; lev < numLevels; ++lev) {
+        char level_str[20];
+        sprintf (level_str, "%d", lev);
+        const std::string label = std::string("level_") + level_str;
+
+        handle.setGroup(label);
+        levHeaders[lev].writeToFile(handle);
+
+        write (handle, levData[lev]->getBoxes());
+        writePlotData(handle, *levData[lev], "data", levGhost[lev], opts);
+    }
+
+    handle.close();
+
+    pout() << "PlotIOServer wrote " << filename << endl;
+#endif
+}
+
+
+#endif //CH_USE_HDF5
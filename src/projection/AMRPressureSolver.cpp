@@ -50,6 +50,7 @@ bool AMRPressureSolver::s_useAMRMGSolver = true;
 AMRPressureSolver::AMRPressureSolver ()
 : m_isDefined(false),
   m_numLevels(-1),
+  m_numIter(0),
   m_lepticSolverPtr(NULL),
   m_amrmgSolverPtr(NULL),
   m_bottomSolverPtr(NULL)
@@ -483,6 +484,8 @@ void AMRPressureSolver::solve (Vector<LevelData<FArrayBox>*>&       a_phi,
         setValLevels(a_phi, a_lmin, a_lmax, 0.0);
     }
 
+    m_numIter = 0;
+
     if (m_isLevelSolver) {
         // Level solve
         // You can put a loop here to switch back and forth among solvers.
@@ -497,6 +500,7 @@ void AMRPressureSolver::solve (Vector<LevelData<FArrayBox>*>&       a_phi,
                                      a_lmin,
                                      false, // zero phi?
                                      a_forceHomogeneous);
+            m_numIter += static_cast<AMRLepticSolver*>(m_lepticSolverPtr)->getNumIter();
         }
         if (s_useLevelMGSolver) {
             CH_assert(m_amrmgSolverPtr != NULL);
@@ -506,6 +510,7 @@ void AMRPressureSolver::solve (Vector<LevelData<FArrayBox>*>&       a_phi,
                                     a_lmin,
                                     false, // zero phi?
                                     a_forceHomogeneous);
+            m_numIter += static_cast<MappedAMRMultiGrid<LevelData<FArrayBox> >*>(m_amrmgSolverPtr)->getNumIter();
         }
     } else {
         // AMR solve
@@ -521,6 +526,7 @@ void AMRPressureSolver::solve (Vector<LevelData<FArrayBox>*>&       a_phi,
                                      a_lmin,
                                      false, // zero phi?
                                      a_forceHomogeneous);
+            m_numIter += static_cast<AMRLepticSolver*>(m_lepticSolverPtr)->getNumIter();
         }
         if (s_useAMRMGSolver) {
             CH_assert(m_amrmgSolverPtr != NULL);
@@ -530,6 +536,7 @@ void AMRPressureSolver::solve (Vector<LevelData<FArrayBox>*>&       a_phi,
                                     a_lmin,
                                     false, // zero phi?
                                     a_forceHomogeneous);
+            m_numIter += static_cast<MappedAMRMultiGrid<LevelData<FArrayBox> >*>(m_amrmgSolverPtr)->getNumIter();
         }
     }
 }
@@ -0,0 +1,467 @@
+/*******************************************************************************
+ *  SOMAR - Stratified Ocean Model with Adaptive Refinement
+ *  Developed by Ed Santilli & Alberto Scotti
+ *  Copyright (C) 2014 University of North Carolina at Chapel Hill
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301
+ *  USA
+ *
+ *  For up-to-date contact information, please visit the repository homepage,
+ *  https://github.com/somarhub.
+ ******************************************************************************/
+#ifdef CH_USE_HDF5
+
+#include "CheckpointStager.H"
+#include "PackUtils.H"
+#include "LayoutIterator.H"
+#include "SPMD.H"
+#include "MayDay.H"
+#include "CH_Timer.H"
+#include "parstream.H"
+#include <sstream>
+#include <iomanip>
+#include <map>
+#include <vector>
+#include <cstdio>
+#include <cerrno>
+#include <sys/types.h>
+#include <sys/stat.h>
+
+
+// Static members
+pthread_t   CheckpointStager::s_thread;
+bool        CheckpointStager::s_threadIsActive = false;
+std::string CheckpointStager::s_drainSrc;
+std::string CheckpointStager::s_drainDestDir;
+std::string CheckpointStager::s_drainDest;
+std::string CheckpointStager::s_drainError;
+
+
+// -----------------------------------------------------------------------------
+// Creates a_dir if it does not exist yet. Several ranks may race to create
+// the same directory, so losing that race is not an error.
+// -----------------------------------------------------------------------------
+static bool makeDir (const std::string& a_dir)
+{
+    if (mkdir(a_dir.c_str(), 0755) == 0) return true;
+    return (errno == EEXIST);
+}
+
+
+// -----------------------------------------------------------------------------
+// The per-rank file name of a_rank in a_dir.
+// -----------------------------------------------------------------------------
+std::string CheckpointStager::rankFileName (const std::string& a_dir,
+                                            const int          a_rank)
+{
+    char rank_str[40];
+    sprintf(rank_str, "/rank_%06d.ckpt", a_rank);
+    return a_dir + rank_str;
+}
+
+
+// -----------------------------------------------------------------------------
+// Is a_path a checkpoint in the per-rank form?
+// -----------------------------------------------------------------------------
+bool CheckpointStager::isStaged (const std::string& a_path)
+{
+    struct stat info;
+    if (stat(a_path.c_str(), &info) != 0) return false;
+    if (!S_ISDIR(info.st_mode)) return false;
+
+    // The first rank's file holds everything needed to start the merge.
+    return (stat(rankFileName(a_path, 0).c_str(), &info) == 0);
+}
+
+
+// -----------------------------------------------------------------------------
+// Writes this rank's part of a checkpoint to a_stageDir and starts draining
+// it to a_destDir.
+// -----------------------------------------------------------------------------
+void CheckpointStager::stage (const std::string&                                  a_stageDir,
+                              const std::string&                                  a_destDir,
+                              const HDF5HeaderData&                               a_amrHeader,
+                              const HDF5HeaderData&                               a_physHeader,
+                              const Vector<HDF5HeaderData>&                       a_levHeaders,
+                              const Vector<Vector<std::string> >&                 a_levNames,
+                              const Vector<Vector<const LevelData<FArrayBox>*> >& a_levData)
+{
+    CH_TIME("CheckpointStager::stage");
+
+    const int numLevels = a_levHeaders.size();
+    CH_assert(a_levNames.size() == numLevels);
+    CH_assert(a_levData.size() == numLevels);
+
+    // The stage file of the last checkpoint may still be draining.
+    wait();
+
+    // Describe the checkpoint. This is identical on every rank.
+    std::string desc;
+    {
+        std::ostringstream os;
+        os << std::setprecision(17) << std::scientific;
+
+        os << numProc() << '\n';
+        packHeader(os, a_amrHeader);
+        packHeader(os, a_physHeader);
+        os << numLevels << '\n';
+
+        for (int lev = 0; lev < numLevels; ++lev) {
+            const int numFields = a_levNames[lev].size();
+            CH_assert(a_levData[lev].size() == numFields);
+
+            packHeader(os, a_levHeaders[lev]);
+            os << numFields << '\n';
+            for (int f = 0; f < numFields; ++f) {
+                packString(os, a_levNames[lev][f]);
+                os << a_levData[lev][f]->nComp() << '\n';
+            }
+
+            if (numFields == 0) continue;
+
+            const DisjointBoxLayout& grids = a_levData[lev][0]->getBoxes();
+            os << grids.size() << '\n';
+            LayoutIterator lit = grids.layoutIterator();
+            for (lit.reset(); lit.ok(); ++lit) {
+                packBox(os, grids[lit()]);
+                os << grids.procID(lit()) << '\n';
+            }
+        }
+        desc = os.str();
+    }
+
+    // Create the stage directory. Other ranks on this node may beat us to it.
+    if (!makeDir(a_stageDir)) {
+        std::ostringstream msg;
+        msg << "CheckpointStager::stage could not create " << a_stageDir;
+        MayDay::Error(msg.str().c_str());
+    }
+
+    // The stage file is named after its destination.
+    std::string baseName = a_destDir;
+    while (baseName.size() > 1 && baseName[baseName.size() - 1] == '/') {
+        baseName.erase(baseName.size() - 1);
+    }
+    baseName = baseName.substr(baseName.find_last_of('/') + 1);
+
+    char rank_str[40];
+    sprintf(rank_str, ".rank_%06d", procID());
+    s_drainSrc = a_stageDir + "/" + baseName + rank_str;
+
+    // Dump the description, then our valid data in level, field, and layout
+    // order.
+    FILE* fp = fopen(s_drainSrc.c_str(), "wb");
+    if (fp == NULL) {
+        std::ostringstream msg;
+        msg << "CheckpointStager::stage could not open " << s_drainSrc;
+        MayDay::Error(msg.str().c_str());
+    }
+
+    const unsigned long long descLen = desc.size();
+    fwrite(&descLen, sizeof(descLen), 1, fp);
+    fwrite(desc.data(), 1, desc.size(), fp);
+
+    for (int lev = 0; lev < numLevels; ++lev) {
+        for (int f = 0; f < a_levData[lev].size(); ++f) {
+            const LevelData<FArrayBox>& data = *a_levData[lev][f];
+            const DisjointBoxLayout& grids = data.getBoxes();
+
+            DataIterator dit = data.dataIterator();
+            for (dit.reset(); dit.ok(); ++dit) {
+                FArrayBox validFAB(grids[dit], data.nComp());
+                validFAB.copy(data[dit]);
+
+                const size_t count = validFAB.box().numPts() * validFAB.nComp();
+                fwrite(validFAB.dataPtr(0), sizeof(Real), count, fp);
+            }
+        }
+    }
+
+    const bool writeFailed = (ferror(fp) != 0);
+    fclose(fp);
+    if (writeFailed) {
+        std::ostringstream msg;
+        msg << "CheckpointStager::stage could not write " << s_drainSrc;
+        MayDay::Error(msg.str().c_str());
+    }
+
+    // Drain in the background.
+    s_drainDestDir = a_destDir;
+    s_drainDest = rankFileName(a_destDir, procID());
+    s_drainError = "";
+
+    if (pthread_create(&s_thread, NULL, CheckpointStager::drain, NULL) == 0) {
+        s_threadIsActive = true;
+    } else {
+        MayDay::Warning("CheckpointStager::stage could not start the drain thread. Draining now");
+        drain(NULL);
+        wait();
+    }
+}
+
+
+// -----------------------------------------------------------------------------
+// Blocks until the last drain is complete.
+// -----------------------------------------------------------------------------
+void CheckpointStager::wait ()
+{
+    if (s_threadIsActive) {
+        CH_TIME("CheckpointStager::wait");
+        pthread_join(s_thread, NULL);
+        s_threadIsActive = false;
+    }
+
+    if (!s_drainError.empty()) {
+        pout() << "CheckpointStager: " << s_drainError
+               << ". The staged copy was left in " << s_drainSrc << endl;
+        MayDay::Warning("CheckpointStager could not drain a checkpoint");
+        s_drainError = "";
+    }
+}
+
+
+// -----------------------------------------------------------------------------
+// Copies the stage file to its destination. The copy only gets its final
+// name once it is complete.
+// -----------------------------------------------------------------------------
+void* CheckpointStager::drain (void* a_unused)
+{
+    if (!makeDir(s_drainDestDir)) {
+        s_drainError = "could not create " + s_drainDestDir;
+        return NULL;
+    }
+
+    const std::string partName = s_drainDest + ".part";
+    FILE* srcFP = fopen(s_drainSrc.c_str(), "rb");
+    FILE* destFP = fopen(partName.c_str(), "wb");
+
+    if (srcFP == NULL || destFP == NULL) {
+        s_drainError = "could not open " + ((srcFP == NULL)? s_drainSrc: partName);
+        if (srcFP != NULL) fclose(srcFP);
+        if (destFP != NULL) fclose(destFP);
+        return NULL;
+    }
+
+    std::vector<char> buf(1 << 22);
+    size_t numRead;
+    while ((numRead = fread(&buf[0], 1, buf.size(), srcFP)) > 0) {
+        if (fwrite(&buf[0], 1, numRead, destFP) != numRead) {
+            s_drainError = "could not write " + partName;
+            break;
+        }
+    }
+    if (ferror(srcFP)) {
+        s_drainError = "could not read " + s_drainSrc;
+    }
+
+    fclose(srcFP);
+    if (fclose(destFP) != 0 && s_drainError.empty()) {
+        s_drainError = "could not close " + partName;
+    }
+
+    if (!s_drainError.empty()) {
+        remove(partName.c_str());
+        return NULL;
+    }
+
+    if (rename(partName.c_str(), s_drainDest.c_str()) != 0) {
+        s_drainError = "could not rename " + partName;
+        return NULL;
+    }
+
+    remove(s_drainSrc.c_str());
+    return NULL;
+}
+
+
+// -----------------------------------------------------------------------------
+// Merges the per-rank checkpoint in a_stagedDir into the HDF5 checkpoint
+// a_mergedFile. Rank r reads the files written by ranks r, r + numProc(), ...
+// so the number of ranks may differ from the run that wrote it.
+// -----------------------------------------------------------------------------
+void CheckpointStager::merge (const std::string& a_stagedDir,
+                              const std::string& a_mergedFile)
+{
+    CH_TIME("CheckpointStager::merge");
+
+    // The first rank reads the description and shares it.
+    std::string desc;
+    if (procID() == 0) {
+        const std::string filename = rankFileName(a_stagedDir, 0);
+        FILE* fp = fopen(filename.c_str(), "rb");
+        if (fp == NULL) {
+            std::ostringstream msg;
+            msg << "CheckpointStager::merge could not open " << filename;
+            MayDay::Error(msg.str().c_str());
+        }
+
+        unsigned long long descLen = 0;
+        if (fread(&descLen, sizeof(descLen), 1, fp) == 1) {
+            desc.resize(descLen);
+            if (descLen > 0 && fread(&desc[0], 1, descLen, fp) != descLen) {
+                desc.clear();
+            }
+        }
+        fclose(fp);
+
+        if (desc.empty()) {
+            MayDay::Error("CheckpointStager::merge found a corrupt description");
+        }
+    }
+
+#ifdef CH_MPI
+    {
+        unsigned long long descLen = desc.size();
+        MPI_Bcast(&descLen, 1, MPI_UNSIGNED_LONG_LONG, 0, Chombo_MPI::comm);
+        desc.resize(descLen);
+        MPI_Bcast(&desc[0], int(descLen), MPI_CHAR, 0, Chombo_MPI::comm);
+    }
+#endif
+
+    // Parse the description and build the layouts. Each writer's boxes go to
+    // the rank that will read its file.
+    std::istringstream is(desc);
+
+    int numWriters = 0;
+    HDF5HeaderData amrHeader, physHeader;
+    int numLevels = 0;
+
+    is >> numWriters;
+    unpackHeader(is, amrHeader);
+    unpackHeader(is, physHeader);
+    is >> numLevels;
+
+    Vector<HDF5HeaderData>                                 levHeaders(numLevels);
+    Vector<Vector<std::string> >                           levNames(numLevels);
+    Vector<Vector<Box> >                                   levBoxes(numLevels);
+    Vector<Vector<int> >                                   levWriters(numLevels);
+    Vector<Vector<RefCountedPtr<LevelData<FArrayBox> > > > levData(numLevels);
+    Vector<std::map<IntVect, DataIndex, SmallEndLT> >      levIndex(numLevels);
+
+    for (int lev = 0; lev < numLevels; ++lev) {
+        int numFields = 0;
+        unpackHeader(is, levHeaders[lev]);
+        is >> numFields;
+
+        levNames[lev].resize(numFields);
+        Vector<int> numComps(numFields);
+        for (int f = 0; f < numFields; ++f) {
+            unpackString(is, levNames[lev][f]);
+            is >> numComps[f];
+        }
+
+        if (numFields == 0) continue;
+
+        int numBoxes = 0;
+        is >> numBoxes;
+
+        levBoxes[lev].resize(numBoxes);
+        levWriters[lev].resize(numBoxes);
+        Vector<int> readerProcs(numBoxes);
+        for (int b = 0; b < numBoxes; ++b) {
+            unpackBox(is, levBoxes[lev][b]);
+            is >> levWriters[lev][b];
+            readerProcs[b] = levWriters[lev][b] % numProc();
+        }
+
+        if (is.fail()) {
+            MayDay::Error("CheckpointStager::merge found a corrupt description");
+        }
+
+        DisjointBoxLayout grids(levBoxes[lev], readerProcs);
+        levData[lev].resize(numFields);
+        for (int f = 0; f < numFields; ++f) {
+            levData[lev][f] = RefCountedPtr<LevelData<FArrayBox> >(
+                new LevelData<FArrayBox>(grids, numComps[f], IntVect::Zero)
+            );
+        }
+
+        DataIterator dit = grids.dataIterator();
+        for (dit.reset(); dit.ok(); ++dit) {
+            levIndex[lev][grids[dit].smallEnd()] = dit();
+        }
+    }
+
+    // Read the data of the writers assigned to us.
+    for (int w = procID(); w < numWriters; w += numProc()) {
+        const std::string filename = rankFileName(a_stagedDir, w);
+        FILE* fp = fopen(filename.c_str(), "rb");
+        if (fp == NULL) {
+            std::ostringstream msg;
+            msg << "CheckpointStager::merge could not open " << filename
+                << ". Was the checkpoint completely drained?";
+            MayDay::Error(msg.str().c_str());
+        }
+
+        bool readFailed = false;
+        unsigned long long descLen = 0;
+        readFailed = (fread(&descLen, sizeof(descLen), 1, fp) != 1);
+        readFailed = readFailed || (fseek(fp, long(descLen), SEEK_CUR) != 0);
+
+        for (int lev = 0; lev < numLevels && !readFailed; ++lev) {
+            for (int f = 0; f < levNames[lev].size() && !readFailed; ++f) {
+                LevelData<FArrayBox>& data = *levData[lev][f];
+
+                for (int b = 0; b < levBoxes[lev].size(); ++b) {
+                    if (levWriters[lev][b] != w) continue;
+
+                    CH_assert(levIndex[lev].find(levBoxes[lev][b].smallEnd()) != levIndex[lev].end());
+                    FArrayBox& dataFAB = data[levIndex[lev][levBoxes[lev][b].smallEnd()]];
+                    CH_assert(dataFAB.box() == levBoxes[lev][b]);
+
+                    const size_t count = dataFAB.box().numPts() * dataFAB.nComp();
+                    if (fread(dataFAB.dataPtr(0), sizeof(Real), count, fp) != count) {
+                        readFailed = true;
+                        break;
+                    }
+                }
+            }
+        }
+        fclose(fp);
+
+        if (readFailed) {
+            std::ostringstream msg;
+            msg << "CheckpointStager::merge could not read " << filename;
+            MayDay::Error(msg.str().c_str());
+        }
+    }
+
+    // Write the file exactly as LepticAMR::writeCheckpointFile would.
+    HDF5Handle handle(a_mergedFile.c_str(), HDF5Handle::CREATE);
+
+    amrHeader.writeToFile(handle);
+    physHeader.writeToFile(handle);
+
+    for (int lev = 0; lev < numLevels; ++lev) {
+        char level_str[20];
+        sprintf(level_str, "%d", lev);
+        const std::string label = std::string("level_") + level_str;
+        handle.setGroup(label);
+
+        levHeaders[lev].writeToFile(handle);
+
+        if (levNames[lev].size() == 0) continue;
+
+        write(handle, levData[lev][0]->getBoxes());
+        for (int f = 0; f < levNames[lev].size(); ++f) {
+            write(handle, *levData[lev][f], levNames[lev][f]);
+        }
+    }
+
+    handle.close();
+}
+
+
+#endif //CH_USE_HDF5
@@ -0,0 +1,282 @@
+/*******************************************************************************
+ *  SOMAR - Stratified Ocean Model with Adaptive Refinement
+ *  Developed by Ed Santilli & Alberto Scotti
+ *  Copyright (C) 2014 University of North Carolina at Chapel Hill
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301
+ *  USA
+ *
+ *  For up-to-date contact information, please visit the repository homepage,
+ *  https://github.com/somarhub.
+ ******************************************************************************/
+#include "DiagnosticsLog.H"
+#include "SPMD.H"
+#include "MayDay.H"
+#include "Misc.H"
+#include "CH_Timer.H"
+#include "parstream.H"
+#include <sstream>
+#include <iomanip>
+
+
+// -----------------------------------------------------------------------------
+// Adds this rank's part of a_name, to be combined with a_op.
+// -----------------------------------------------------------------------------
+void DiagnosticsRow::add (const std::string& a_name,
+                          const Real         a_localVal,
+                          const int          a_op)
+{
+    CH_assert(!m_isReduced);
+    CH_assert(a_op == Op::SUM || a_op == Op::MAX || a_op == Op::MIN);
+
+    m_names.push_back(a_name);
+    m_vals.push_back(a_localVal);
+    m_ops.push_back(a_op);
+}
+
+
+// -----------------------------------------------------------------------------
+// Adds a value that is already the same on every rank.
+// -----------------------------------------------------------------------------
+void DiagnosticsRow::set (const std::string& a_name,
+                          const Real         a_val)
+{
+    m_names.push_back(a_name);
+    m_vals.push_back(a_val);
+    m_ops.push_back(-1);
+}
+
+
+#ifdef CH_MPI
+// -----------------------------------------------------------------------------
+// The MPI_Op behind DiagnosticsRow::reduce. Each element of a_type holds n
+// values followed by the n operations that combine them, so one reduction can
+// mix sums, maxes, and mins. Sending the whole row as one element keeps MPI
+// from splitting it between the values and their operations. The operations
+// are the same on every rank and pass through untouched.
+// -----------------------------------------------------------------------------
+static void diagnosticsReduceOp (void*         a_in,
+                                 void*         a_inout,
+                                 int*          a_len,
+                                 MPI_Datatype* a_type)
+{
+    int typeSize = 0;
+    MPI_Type_size(*a_type, &typeSize);
+    const int n = typeSize / int(2 * sizeof(Real));
+
+    for (int e = 0; e < *a_len; ++e) {
+        const Real* in = static_cast<const Real*>(a_in) + 2 * n * e;
+        Real* inout = static_cast<Real*>(a_inout) + 2 * n * e;
+
+        for (int i = 0; i < n; ++i) {
+            const int op = int(inout[n + i]);
+            if (op == DiagnosticsRow::Op::SUM) {
+                inout[i] += in[i];
+            } else if (op == DiagnosticsRow::Op::MAX) {
+                inout[i] = Max(inout[i], in[i]);
+            } else {
+                inout[i] = Min(inout[i], in[i]);
+            }
+        }
+    }
+}
+#endif
+
+
+// -----------------------------------------------------------------------------
+// Combines every added value across ranks. This is collective.
+// -----------------------------------------------------------------------------
+void DiagnosticsRow::reduce ()
+{
+    CH_TIME("DiagnosticsRow::reduce");
+    CH_assert(!m_isReduced);
+
+#ifdef CH_MPI
+    // Gather the values that need reducing, followed by their ops.
+    std::vector<int> idx;
+    for (int i = 0; i < int(m_ops.size()); ++i) {
+        if (m_ops[i] >= 0) idx.push_back(i);
+    }
+    const int n = idx.size();
+
+    if (n > 0) {
+        std::vector<Real> sendBuf(2 * n), recvBuf(2 * n);
+        for (int k = 0; k < n; ++k) {
+            sendBuf[k] = m_vals[idx[k]];
+            sendBuf[n + k] = Real(m_ops[idx[k]]);
+        }
+
+        static MPI_Op s_op = MPI_OP_NULL;
+        if (s_op == MPI_OP_NULL) {
+            MPI_Op_create(&diagnosticsReduceOp, 1, &s_op);
+        }
+
+        MPI_Datatype rowType;
+        MPI_Type_contiguous(2 * n, MPI_CH_REAL, &rowType);
+        MPI_Type_commit(&rowType);
+
+        int result = MPI_Allreduce(&sendBuf[0], &recvBuf[0], 1, rowType,
+                                   s_op, Chombo_MPI::comm);
+        MPI_Type_free(&rowType);
+        if (result != MPI_SUCCESS) {
+            MayDay::Error("Sorry, but I had a communication error in DiagnosticsRow::reduce");
+        }
+
+        for (int k = 0; k < n; ++k) {
+            m_vals[idx[k]] = recvBuf[k];
+        }
+    }
+#endif
+
+    m_isReduced = true;
+}
+
+
+// -----------------------------------------------------------------------------
+// Returns a set or reduced value.
+// -----------------------------------------------------------------------------
+Real DiagnosticsRow::get (const std::string& a_name) const
+{
+    for (int i = 0; i < int(m_names.size()); ++i) {
+        if (m_names[i] != a_name) continue;
+
+        if (m_ops[i] >= 0 && !m_isReduced) {
+            MayDay::Error("DiagnosticsRow::get: The row has not been reduced yet");
+        }
+        return m_vals[i];
+    }
+
+    std::ostringstream msg;
+    msg << "DiagnosticsRow::get: " << a_name << " is not in this row";
+    MayDay::Error(msg.str().c_str());
+    return 0.0;
+}
+
+
+// Static members
+bool                     DiagnosticsLog::s_isOpen = false;
+std::string              DiagnosticsLog::s_filename;
+int                      DiagnosticsLog::s_flushInterval = 1;
+std::vector<std::string> DiagnosticsLog::s_columns;
+std::string              DiagnosticsLog::s_buffer;
+int                      DiagnosticsLog::s_numBuffered = 0;
+std::ofstream            DiagnosticsLog::s_file;
+
+
+// -----------------------------------------------------------------------------
+// Opens a_filename for appending. a_flushInterval is the number of rows
+// to hold before writing.
+// -----------------------------------------------------------------------------
+void DiagnosticsLog::open (const std::string& a_filename,
+                           const int          a_flushInterval)
+{
+    if (s_isOpen) close();
+
+    s_filename = a_filename;
+    s_flushInterval = Max(a_flushInterval, 1);
+    s_columns.clear();
+    s_buffer.clear();
+    s_numBuffered = 0;
+    s_isOpen = true;
+
+    if (procID() == 0) {
+        s_file.open(s_filename.c_str(), std::ios::out | std::ios::app);
+        if (!s_file) {
+            std::ostringstream msg;
+            msg << "DiagnosticsLog::open: Could not open " << s_filename;
+            MayDay::Error(msg.str().c_str());
+        }
+    }
+}
+
+
+// -----------------------------------------------------------------------------
+// Has open been called?
+// -----------------------------------------------------------------------------
+bool DiagnosticsLog::isOpen ()
+{
+    return s_isOpen;
+}
+
+
+// -----------------------------------------------------------------------------
+// Appends a reduced row.
+// -----------------------------------------------------------------------------
+void DiagnosticsLog::append (const DiagnosticsRow& a_row)
+{
+    if (!s_isOpen) return;
+    if (procID() != 0) return;
+
+    std::ostringstream line;
+    line << std::setprecision(12) << std::scientific;
+
+    // Start a new header whenever the columns change.
+    if (a_row.names() != s_columns) {
+        s_columns = a_row.names();
+        for (int c = 0; c < int(s_columns.size()); ++c) {
+            line << (c == 0? "": ",") << s_columns[c];
+        }
+        line << "\n";
+    }
+
+    const std::vector<Real>& vals = a_row.values();
+    for (int c = 0; c < int(vals.size()); ++c) {
+        line << (c == 0? "": ",") << vals[c];
+    }
+    line << "\n";
+
+    s_buffer += line.str();
+    ++s_numBuffered;
+
+    if (s_numBuffered >= s_flushInterval) {
+        flush();
+    }
+}
+
+
+// -----------------------------------------------------------------------------
+// Writes any held rows.
+// -----------------------------------------------------------------------------
+void DiagnosticsLog::flush ()
+{
+    if (!s_isOpen) return;
+    if (procID() != 0) return;
+    if (s_numBuffered == 0) return;
+
+    CH_TIME("DiagnosticsLog::flush");
+
+    s_file << s_buffer << std::flush;
+    if (!s_file) {
+        pout() << "DiagnosticsLog::flush: Could not write to " << s_filename << endl;
+    }
+
+    s_buffer.clear();
+    s_numBuffered = 0;
+}
+
+
+// -----------------------------------------------------------------------------
+// Writes any held rows and closes the file.
+// -----------------------------------------------------------------------------
+void DiagnosticsLog::close ()
+{
+    if (!s_isOpen) return;
+
+    flush();
+    if (procID() == 0) {
+        s_file.close();
+    }
+    s_isOpen = false;
+}
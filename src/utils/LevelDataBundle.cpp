@@ -0,0 +1,137 @@
+/*******************************************************************************
+ *  SOMAR - Stratified Ocean Model with Adaptive Refinement
+ *  Developed by Ed Santilli & Alberto Scotti
+ *  Copyright (C) 2014 University of North Carolina at Chapel Hill
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301
+ *  USA
+ *
+ *  For up-to-date contact information, please visit the repository homepage,
+ *  https://github.com/somarhub.
+ ******************************************************************************/
+#include "LevelDataBundle.H"
+#include "CH_Timer.H"
+
+
+// -----------------------------------------------------------------------------
+// Adds a field. All fields must share a layout.
+// -----------------------------------------------------------------------------
+void LevelDataBundle::add (LevelData<FArrayBox>* a_dataPtr)
+{
+    CH_assert(a_dataPtr != NULL);
+    CH_assert(m_fields.size() == 0 ||
+              a_dataPtr->getBoxes() == m_fields[0]->getBoxes());
+
+    m_fields.push_back(a_dataPtr);
+    m_numComps += a_dataPtr->nComp();
+}
+
+
+// -----------------------------------------------------------------------------
+// Defines a_packed on the fields' layout with numComps() components.
+// -----------------------------------------------------------------------------
+void LevelDataBundle::definePacked (LevelData<FArrayBox>& a_packed,
+                                    const IntVect&        a_ghostVect) const
+{
+    CH_assert(m_fields.size() > 0);
+    a_packed.define(m_fields[0]->getBoxes(), m_numComps, a_ghostVect);
+}
+
+
+// -----------------------------------------------------------------------------
+// Copies every field into its components of a_packed, over the region
+// that both have (valid + ghosts).
+// -----------------------------------------------------------------------------
+void LevelDataBundle::pack (LevelData<FArrayBox>& a_packed) const
+{
+    CH_TIME("LevelDataBundle::pack");
+    CH_assert(a_packed.nComp() == m_numComps);
+
+    DataIterator dit = a_packed.dataIterator();
+    for (dit.reset(); dit.ok(); ++dit) {
+        FArrayBox& packedFAB = a_packed[dit];
+
+        int destComp = 0;
+        for (unsigned int f = 0; f < m_fields.size(); ++f) {
+            const FArrayBox& srcFAB = (*m_fields[f])[dit];
+            const Box region = srcFAB.box() & packedFAB.box();
+            const int numComps = srcFAB.nComp();
+
+            packedFAB.copy(srcFAB, region, 0, region, destComp, numComps);
+            destComp += numComps;
+        }
+    }
+}
+
+
+// -----------------------------------------------------------------------------
+// The reverse of pack.
+// -----------------------------------------------------------------------------
+void LevelDataBundle::unpack (const LevelData<FArrayBox>& a_packed)
+{
+    CH_TIME("LevelDataBundle::unpack");
+    CH_assert(a_packed.nComp() == m_numComps);
+
+    DataIterator dit = a_packed.dataIterator();
+    for (dit.reset(); dit.ok(); ++dit) {
+        const FArrayBox& packedFAB = a_packed[dit];
+
+        int srcComp = 0;
+        for (unsigned int f = 0; f < m_fields.size(); ++f) {
+            FArrayBox& destFAB = (*m_fields[f])[dit];
+            const Box region = destFAB.box() & packedFAB.box();
+            const int numComps = destFAB.nComp();
+
+            destFAB.copy(packedFAB, region, srcComp, region, 0, numComps);
+            srcComp += numComps;
+        }
+    }
+}
+
+
+// -----------------------------------------------------------------------------
+// Copies the valid data of every field in a_src to the matching field
+// in a_dest, including a_dest's ghosts, just like LevelData::copyTo.
+// The two bundles must list matching fields in the same order. All
+// fields travel together in one message per pair of ranks.
+// -----------------------------------------------------------------------------
+void LevelDataBundle::copyTo (const LevelDataBundle& a_src,
+                              LevelDataBundle&       a_dest)
+{
+    CH_TIME("LevelDataBundle::copyTo");
+    CH_assert(a_src.size() == a_dest.size());
+    CH_assert(a_src.numComps() == a_dest.numComps());
+
+    if (a_src.size() == 0) return;
+
+    // Only the source's valid data is sent.
+    LevelData<FArrayBox> srcPacked;
+    a_src.definePacked(srcPacked, IntVect::Zero);
+    a_src.pack(srcPacked);
+
+    // The destination needs room for the largest ghost region.
+    IntVect ghostVect = IntVect::Zero;
+    for (int f = 0; f < a_dest.size(); ++f) {
+        ghostVect.max(a_dest.m_fields[f]->ghostVect());
+    }
+
+    LevelData<FArrayBox> destPacked;
+    a_dest.definePacked(destPacked, ghostVect);
+
+    // Regions that the source does not cover must keep their values.
+    a_dest.pack(destPacked);
+    srcPacked.copyTo(destPacked);
+    a_dest.unpack(destPacked);
+}
@@ -0,0 +1,177 @@
+/*******************************************************************************
+ *  SOMAR - Stratified Ocean Model with Adaptive Refinement
+ *  Developed by Ed Santilli & Alberto Scotti
+ *  Copyright (C) 2014 University of North Carolina at Chapel Hill
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301
+ *  USA
+ *
+ *  For up-to-date contact information, please visit the repository homepage,
+ *  https://github.com/somarhub.
+ ******************************************************************************/
+#ifdef CH_USE_HDF5
+
+#include "PackUtils.H"
+#include <map>
+
+
+// -----------------------------------------------------------------------------
+void packString (std::ostream& a_os, const std::string& a_str)
+{
+    a_os << a_str.size() << ' ' << a_str << '\n';
+}
+
+// -----------------------------------------------------------------------------
+void unpackString (std::istream& a_is, std::string& a_str)
+{
+    size_t len = 0;
+    a_is >> len;
+    a_is.get();
+    a_str.resize(len);
+    if (len > 0) {
+        a_is.read(&a_str[0], len);
+    }
+}
+
+// -----------------------------------------------------------------------------
+void packIntVect (std::ostream& a_os, const IntVect& a_iv)
+{
+    for (int dir = 0; dir < SpaceDim; ++dir) {
+        a_os << a_iv[dir] << ' ';
+    }
+}
+
+// -----------------------------------------------------------------------------
+void unpackIntVect (std::istream& a_is, IntVect& a_iv)
+{
+    for (int dir = 0; dir < SpaceDim; ++dir) {
+        a_is >> a_iv[dir];
+    }
+}
+
+// -----------------------------------------------------------------------------
+void packBox (std::ostream& a_os, const Box& a_box)
+{
+    packIntVect(a_os, a_box.smallEnd());
+    packIntVect(a_os, a_box.bigEnd());
+    packIntVect(a_os, a_box.type());
+}
+
+// -----------------------------------------------------------------------------
+void unpackBox (std::istream& a_is, Box& a_box)
+{
+    IntVect lo, hi, type;
+    unpackIntVect(a_is, lo);
+    unpackIntVect(a_is, hi);
+    unpackIntVect(a_is, type);
+    a_box = Box(lo, hi, type);
+}
+
+// -----------------------------------------------------------------------------
+void packHeader (std::ostream& a_os, const HDF5HeaderData& a_header)
+{
+    a_os << a_header.m_int.size() << '\n';
+    std::map<std::string, int>::const_iterator intIt;
+    for (intIt = a_header.m_int.begin(); intIt != a_header.m_int.end(); ++intIt) {
+        packString(a_os, intIt->first);
+        a_os << intIt->second << '\n';
+    }
+
+    a_os << a_header.m_real.size() << '\n';
+    std::map<std::string, Real>::const_iterator realIt;
+    for (realIt = a_header.m_real.begin(); realIt != a_header.m_real.end(); ++realIt) {
+        packString(a_os, realIt->first);
+        a_os << realIt->second << '\n';
+    }
+
+    a_os << a_header.m_string.size() << '\n';
+    std::map<std::string, std::string>::const_iterator strIt;
+    for (strIt = a_header.m_string.begin(); strIt != a_header.m_string.end(); ++strIt) {
+        packString(a_os, strIt->first);
+        packString(a_os, strIt->second);
+    }
+
+    a_os << a_header.m_intvect.size() << '\n';
+    std::map<std::string, IntVect>::const_iterator ivIt;
+    for (ivIt = a_header.m_intvect.begin(); ivIt != a_header.m_intvect.end(); ++ivIt) {
+        packString(a_os, ivIt->first);
+        packIntVect(a_os, ivIt->second);
+    }
+
+    a_os << a_header.m_realvect.size() << '\n';
+    std::map<std::string, RealVect>::const_iterator rvIt;
+    for (rvIt = a_header.m_realvect.begin(); rvIt != a_header.m_realvect.end(); ++rvIt) {
+        packString(a_os, rvIt->first);
+        for (int dir = 0; dir < SpaceDim; ++dir) {
+            a_os << rvIt->second[dir] << ' ';
+        }
+    }
+
+    a_os << a_header.m_box.size() << '\n';
+    std::map<std::string, Box>::const_iterator boxIt;
+    for (boxIt = a_header.m_box.begin(); boxIt != a_header.m_box.end(); ++boxIt) {
+        packString(a_os, boxIt->first);
+        packBox(a_os, boxIt->second);
+    }
+}
+
+// -----------------------------------------------------------------------------
+void unpackHeader (std::istream& a_is, HDF5HeaderData& a_header)
+{
+    std::string key;
+    size_t num;
+
+    a_is >> num;
+    for (size_t n = 0; n < num; ++n) {
+        unpackString(a_is, key);
+        a_is >> a_header.m_int[key];
+    }
+
+    a_is >> num;
+    for (size_t n = 0; n < num; ++n) {
+        unpackString(a_is, key);
+        a_is >> a_header.m_real[key];
+    }
+
+    a_is >> num;
+    for (size_t n = 0; n < num; ++n) {
+        unpackString(a_is, key);
+        unpackString(a_is, a_header.m_string[key]);
+    }
+
+    a_is >> num;
+    for (size_t n = 0; n < num; ++n) {
+        unpackString(a_is, key);
+        unpackIntVect(a_is, a_header.m_intvect[key]);
+    }
+
+    a_is >> num;
+    for (size_t n = 0; n < num; ++n) {
+        unpackString(a_is, key);
+        RealVect& rv = a_header.m_realvect[key];
+        for (int dir = 0; dir < SpaceDim; ++dir) {
+            a_is >> rv[dir];
+        }
+    }
+
+    a_is >> num;
+    for (size_t n = 0; n < num; ++n) {
+        unpackString(a_is, key);
+        unpackBox(a_is, a_header.m_box[key]);
+    }
+}
+
+
+#endif //CH_USE_HDF5
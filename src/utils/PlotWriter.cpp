@@ -0,0 +1,333 @@
+/*******************************************************************************
+ *  SOMAR - Stratified Ocean Model with Adaptive Refinement
+ *  Developed by Ed Santilli & Alberto Scotti
+ *  Copyright (C) 2014 University of North Carolina at Chapel Hill
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301
+ *  USA
+ *
+ *  For up-to-date contact information, please visit the repository homepage,
+ *  https://github.com/somarhub.
+ ******************************************************************************/
+#ifdef CH_USE_HDF5
+
+#include "PlotWriter.H"
+#include "LayoutIterator.H"
+#include "Misc.H"
+#include "SPMD.H"
+#include "MayDay.H"
+#include "CH_Timer.H"
+#include <sstream>
+#include <vector>
+#include <algorithm>
+
+
+// -----------------------------------------------------------------------------
+// Writes a_data to the current group of a_handle in the same layout as
+// Chombo's write(a_handle, a_data, a_name, a_outputGhost), so the file still
+// reads as a standard Chombo plot file. The data are stored as float or
+// double and the dataset is chunked and filtered according to a_opts.
+// This is collective.
+// -----------------------------------------------------------------------------
+void writePlotData (HDF5Handle&                 a_handle,
+                    const LevelData<FArrayBox>& a_data,
+                    const std::string&          a_name,
+                    const IntVect&              a_outputGhost,
+                    const PlotWriteOptions&     a_opts)
+{
+    CH_TIME("writePlotData");
+
+    if (a_opts.isDefault()) {
+        write(a_handle, a_data, a_name, a_outputGhost);
+        return;
+    }
+
+    if (a_opts.precision != 32 && a_opts.precision != 64) {
+        MayDay::Error("writePlotData: precision must be 32 or 64");
+    }
+
+    const DisjointBoxLayout& grids = a_data.getBoxes();
+    const int numComps = a_data.nComp();
+
+    IntVect outputGhost = a_data.ghostVect();
+    outputGhost.min(a_outputGhost);
+
+    // The attributes go where Chombo puts them.
+    {
+        HDF5HeaderData info;
+        info.m_intvect["ghost"]       = a_data.ghostVect();
+        info.m_intvect["outputGhost"] = outputGhost;
+        info.m_int    ["comps"]       = numComps;
+        info.m_string ["objectType"]  = "FArrayBox";
+
+        const std::string group = a_handle.getGroup();
+        a_handle.setGroup(group + "/" + a_name + "_attributes");
+        info.writeToFile(a_handle);
+        a_handle.setGroup(group);
+    }
+
+    // Compute the offsets of every box in the flattened dataset.
+    std::vector<long long> offsets(1, 0);
+    {
+        LayoutIterator lit = grids.layoutIterator();
+        for (lit.reset(); lit.ok(); ++lit) {
+            const Box region = grow(grids[lit()], outputGhost);
+            offsets.push_back(offsets.back() + region.numPts() * numComps);
+        }
+    }
+    const hsize_t totalSize = offsets.back();
+
+    // Gather our boxes into one buffer and select their spots in the file.
+    hsize_t dims[1];
+    dims[0] = totalSize;
+    hid_t fileSpace = H5Screate_simple(1, dims, NULL);
+    H5Sselect_none(fileSpace);
+
+    std::vector<float>  floatBuffer;
+    std::vector<double> doubleBuffer;
+    hsize_t localSize = 0;
+    {
+        int boxIdx = 0;
+        LayoutIterator lit = grids.layoutIterator();
+        DataIterator dit = a_data.dataIterator();
+        dit.reset();
+
+        for (lit.reset(); lit.ok(); ++lit, ++boxIdx) {
+            if (!dit.ok() || !(grids[dit] == grids[lit()])) continue;
+
+            // FAB data must go out component by component over region.
+            const Box region = grow(grids[dit], outputGhost);
+            FArrayBox regionFAB(region, numComps);
+            regionFAB.copy(a_data[dit]);
+
+            const size_t count = region.numPts() * numComps;
+            const Real* srcPtr = regionFAB.dataPtr(0);
+            if (a_opts.precision == 32) {
+                floatBuffer.insert(floatBuffer.end(), srcPtr, srcPtr + count);
+            } else {
+                doubleBuffer.insert(doubleBuffer.end(), srcPtr, srcPtr + count);
+            }
+
+            hsize_t start[1], blockCount[1];
+            start[0] = offsets[boxIdx];
+            blockCount[0] = count;
+            H5Sselect_hyperslab(fileSpace, H5S_SELECT_OR, start, NULL, blockCount, NULL);
+            localSize += count;
+
+            ++dit;
+        }
+    }
+
+    // Create the dataset.
+    const hid_t fileType = ((a_opts.precision == 32)? H5T_NATIVE_FLOAT: H5T_NATIVE_DOUBLE);
+    hid_t createProps = H5Pcreate(H5P_DATASET_CREATE);
+    if (totalSize > 0) {
+        hsize_t chunkDims[1];
+        chunkDims[0] = Min(hsize_t(Max(a_opts.chunkSize, 1)), totalSize);
+        H5Pset_chunk(createProps, 1, chunkDims);
+
+        if (a_opts.useShuffle) {
+            H5Pset_shuffle(createProps);
+        }
+        if (a_opts.deflateLevel > 0) {
+            H5Pset_deflate(createProps, Min(a_opts.deflateLevel, 9));
+        }
+    }
+
+    const std::string dataName = a_name + ":datatype=0";
+    hid_t dataSet = H5Dcreate(a_handle.groupID(), dataName.c_str(), fileType, fileSpace, createProps);
+    if (dataSet < 0) {
+        std::ostringstream msg;
+        msg << "writePlotData: H5Dcreate failed to create " << dataName
+            << ". Return value = " << dataSet;
+        MayDay::Error(msg.str().c_str());
+    }
+
+    // Write. Filtered datasets need every rank in one collective call.
+    hsize_t memDims[1];
+    memDims[0] = localSize;
+    hid_t memSpace = H5Screate_simple(1, memDims, NULL);
+    if (localSize == 0) {
+        H5Sselect_none(memSpace);
+    }
+
+    hid_t xferProps = H5Pcreate(H5P_DATASET_XFER);
+#ifdef CH_MPI
+    H5Pset_dxpl_mpio(xferProps, H5FD_MPIO_COLLECTIVE);
+#endif
+
+    herr_t status;
+    if (a_opts.precision == 32) {
+        status = H5Dwrite(dataSet, H5T_NATIVE_FLOAT, memSpace, fileSpace, xferProps,
+                          ((localSize > 0)? &floatBuffer[0]: NULL));
+    } else {
+        status = H5Dwrite(dataSet, H5T_NATIVE_DOUBLE, memSpace, fileSpace, xferProps,
+                          ((localSize > 0)? &doubleBuffer[0]: NULL));
+    }
+    if (status < 0) {
+        std::ostringstream msg;
+        msg << "writePlotData: H5Dwrite failed to write " << dataName
+            << ". Return value = " << status;
+        MayDay::Error(msg.str().c_str());
+    }
+
+    H5Pclose(xferProps);
+    H5Sclose(memSpace);
+    H5Dclose(dataSet);
+    H5Pclose(createProps);
+    H5Sclose(fileSpace);
+
+    // The offsets are small, so the first rank writes them alone.
+    {
+        hsize_t offDims[1];
+        offDims[0] = offsets.size();
+        hid_t offSpace = H5Screate_simple(1, offDims, NULL);
+
+        const std::string offName = a_name + ":offsets=0";
+        hid_t offSet = H5Dcreate(a_handle.groupID(), offName.c_str(), H5T_NATIVE_LLONG, offSpace, H5P_DEFAULT);
+        if (offSet < 0) {
+            std::ostringstream msg;
+            msg << "writePlotData: H5Dcreate failed to create " << offName
+                << ". Return value = " << offSet;
+            MayDay::Error(msg.str().c_str());
+        }
+
+        if (procID() == 0) {
+            H5Dwrite(offSet, H5T_NATIVE_LLONG, H5S_ALL, H5S_ALL, H5P_DEFAULT, &offsets[0]);
+        }
+
+        H5Dclose(offSet);
+        H5Sclose(offSpace);
+    }
+}
+
+
+// -----------------------------------------------------------------------------
+// Reads a_name from the current group of a_handle into a_data.
+// -----------------------------------------------------------------------------
+int readPlotData (HDF5Handle&           a_handle,
+                  LevelData<FArrayBox>& a_data,
+                  const std::string&    a_name)
+{
+    CH_TIME("readPlotData");
+
+    const DisjointBoxLayout& grids = a_data.getBoxes();
+    const int numComps = a_data.nComp();
+
+    // Read the attributes.
+    IntVect outputGhost = IntVect::Zero;
+    {
+        HDF5HeaderData info;
+        const std::string group = a_handle.getGroup();
+        if (a_handle.setGroup(group + "/" + a_name + "_attributes") != 0) {
+            a_handle.setGroup(group);
+            return 1;
+        }
+        info.readFromFile(a_handle);
+        a_handle.setGroup(group);
+
+        if (info.m_int.find("comps") == info.m_int.end() ||
+            info.m_int["comps"] != numComps) {
+            return 2;
+        }
+        if (info.m_intvect.find("outputGhost") != info.m_intvect.end()) {
+            outputGhost = info.m_intvect["outputGhost"];
+        }
+    }
+
+    // Read the offsets of every box in the flattened dataset.
+    std::vector<long long> offsets;
+    {
+        const std::string offName = a_name + ":offsets=0";
+        hid_t offSet = H5Dopen(a_handle.groupID(), offName.c_str());
+        if (offSet < 0) return 3;
+
+        hid_t offSpace = H5Dget_space(offSet);
+        offsets.resize(H5Sget_simple_extent_npoints(offSpace));
+        const herr_t status = H5Dread(offSet, H5T_NATIVE_LLONG, H5S_ALL, H5S_ALL,
+                                      H5P_DEFAULT, &offsets[0]);
+        H5Sclose(offSpace);
+        H5Dclose(offSet);
+
+        if (status < 0 || int(offsets.size()) != grids.size() + 1) return 4;
+    }
+
+    // Select our boxes' spots in the file.
+    const std::string dataName = a_name + ":datatype=0";
+    hid_t dataSet = H5Dopen(a_handle.groupID(), dataName.c_str());
+    if (dataSet < 0) return 5;
+
+    hid_t fileSpace = H5Dget_space(dataSet);
+    H5Sselect_none(fileSpace);
+
+    hsize_t localSize = 0;
+    {
+        int boxIdx = 0;
+        LayoutIterator lit = grids.layoutIterator();
+        for (lit.reset(); lit.ok(); ++lit, ++boxIdx) {
+            if (grids.procID(lit()) != procID()) continue;
+
+            hsize_t start[1], blockCount[1];
+            start[0] = offsets[boxIdx];
+            blockCount[0] = offsets[boxIdx + 1] - offsets[boxIdx];
+            H5Sselect_hyperslab(fileSpace, H5S_SELECT_OR, start, NULL, blockCount, NULL);
+            localSize += blockCount[0];
+        }
+    }
+
+    // Read. Our boxes come out in layout order.
+    hsize_t memDims[1];
+    memDims[0] = localSize;
+    hid_t memSpace = H5Screate_simple(1, memDims, NULL);
+    if (localSize == 0) {
+        H5Sselect_none(memSpace);
+    }
+
+    hid_t xferProps = H5Pcreate(H5P_DATASET_XFER);
+#ifdef CH_MPI
+    H5Pset_dxpl_mpio(xferProps, H5FD_MPIO_COLLECTIVE);
+#endif
+
+    std::vector<double> buffer(localSize);
+    const herr_t status = H5Dread(dataSet, H5T_NATIVE_DOUBLE, memSpace, fileSpace, xferProps,
+                                  ((localSize > 0)? &buffer[0]: NULL));
+
+    H5Pclose(xferProps);
+    H5Sclose(memSpace);
+    H5Sclose(fileSpace);
+    H5Dclose(dataSet);
+
+    if (status < 0) return 6;
+
+    // Unpack.
+    size_t offset = 0;
+    DataIterator dit = a_data.dataIterator();
+    for (dit.reset(); dit.ok(); ++dit) {
+        const Box region = grow(grids[dit], outputGhost);
+        FArrayBox regionFAB(region, numComps);
+
+        const size_t count = region.numPts() * numComps;
+        std::copy(buffer.begin() + offset, buffer.begin() + offset + count, regionFAB.dataPtr(0));
+        offset += count;
+
+        a_data[dit].copy(regionFAB);
+    }
+    CH_assert(offset == localSize);
+
+    return 0;
+}
+
+
+#endif //CH_USE_HDF5
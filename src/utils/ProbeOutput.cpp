@@ -0,0 +1,150 @@
+/*******************************************************************************
+ *  SOMAR - Stratified Ocean Model with Adaptive Refinement
+ *  Developed by Ed Santilli & Alberto Scotti
+ *  Copyright (C) 2014 University of North Carolina at Chapel Hill
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301
+ *  USA
+ *
+ *  For up-to-date contact information, please visit the repository homepage,
+ *  https://github.com/somarhub.
+ ******************************************************************************/
+#include "ProbeOutput.H"
+#include "MiscUtils.H"
+#include "MayDay.H"
+#include "CH_Timer.H"
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+
+
+// -----------------------------------------------------------------------------
+// The cells to sample, in the index space of level.
+// -----------------------------------------------------------------------------
+Box ProbeSpec::region (const Box& a_levelDomain) const
+{
+    Box retBox;
+
+    switch (type) {
+    case Type::BOX:
+        retBox = Box(lo, hi);
+        break;
+    case Type::SLICE:
+        {
+            CH_assert(0 <= dir && dir < SpaceDim);
+            SliceTransform slicer(dir, pos);
+            retBox = slicer(a_levelDomain);
+        }
+        break;
+    case Type::POINT:
+        retBox = Box(lo, lo);
+        break;
+    default:
+        MayDay::Error("ProbeSpec::region received a bad probe type");
+    }
+
+    retBox &= a_levelDomain;
+    return retBox;
+}
+
+
+// -----------------------------------------------------------------------------
+// Appends one record. a_data must cover a_region and hold one comp per
+// field of a_spec. Only call this on the rank that holds a_data.
+// -----------------------------------------------------------------------------
+void ProbeOutput::append (const ProbeSpec&   a_spec,
+                          const std::string& a_prefix,
+                          const Box&         a_region,
+                          const int          a_step,
+                          const Real         a_time,
+                          const FArrayBox&   a_data)
+{
+    CH_TIME("ProbeOutput::append");
+
+    CH_assert(a_data.box().contains(a_region));
+    CH_assert(a_data.nComp() == int(a_spec.fields.size()));
+
+    const std::string filename = a_prefix + a_spec.name + ".probe";
+
+    // Describe the file the first time we see it.
+    FILE* fp = fopen(filename.c_str(), "rb");
+    if (fp == NULL) {
+        writeDescription(a_spec, filename, a_region);
+    } else {
+        fclose(fp);
+    }
+
+    fp = fopen(filename.c_str(), "ab");
+    if (fp == NULL) {
+        std::ostringstream msg;
+        msg << "ProbeOutput::append could not open " << filename;
+        MayDay::Error(msg.str().c_str());
+    }
+
+    // Gather the region into one contiguous buffer.
+    FArrayBox regionFAB(a_region, a_data.nComp());
+    regionFAB.copy(a_data);
+
+    const int    step = a_step;
+    const double time = a_time;
+    fwrite(&step, sizeof(int), 1, fp);
+    fwrite(&time, sizeof(double), 1, fp);
+
+    const size_t count = a_region.numPts() * a_data.nComp();
+#ifdef CH_USE_DOUBLE
+    fwrite(regionFAB.dataPtr(0), sizeof(double), count, fp);
+#else
+    std::vector<double> buffer(regionFAB.dataPtr(0), regionFAB.dataPtr(0) + count);
+    fwrite(&buffer[0], sizeof(double), count, fp);
+#endif
+
+    fclose(fp);
+}
+
+
+// -----------------------------------------------------------------------------
+// Writes the text companion the first time a probe file is created.
+// -----------------------------------------------------------------------------
+void ProbeOutput::writeDescription (const ProbeSpec&   a_spec,
+                                    const std::string& a_filename,
+                                    const Box&         a_region)
+{
+    const std::string descName = a_filename + ".txt";
+    std::ofstream os(descName.c_str());
+    if (!os) {
+        std::ostringstream msg;
+        msg << "ProbeOutput::writeDescription could not open " << descName;
+        MayDay::Error(msg.str().c_str());
+    }
+
+    const char* typeNames[] = {"box", "slice", "point"};
+    const size_t numComps = a_spec.fields.size();
+
+    os << "name = " << a_spec.name << '\n'
+       << "type = " << typeNames[a_spec.type] << '\n'
+       << "level = " << a_spec.level << '\n'
+       << "interval = " << a_spec.interval << '\n'
+       << "lo =";
+    for (int dir = 0; dir < SpaceDim; ++dir) os << ' ' << a_region.smallEnd(dir);
+    os << "\nhi =";
+    for (int dir = 0; dir < SpaceDim; ++dir) os << ' ' << a_region.bigEnd(dir);
+    os << "\nfields =";
+    for (size_t f = 0; f < numComps; ++f) os << ' ' << a_spec.fields[f];
+    os << "\nrecord = int step, double time, double data[" << numComps
+       << "][" << a_region.numPts() << "] (Fortran order within each comp)"
+       << "\nrecord_bytes = "
+       << sizeof(int) + sizeof(double) * (1 + numComps * a_region.numPts())
+       << std::endl;
+}
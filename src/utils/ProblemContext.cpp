@@ -34,6 +34,7 @@
 #include "CylindricalMap.H"
 #include "LedgeMap.H"
 #include "MassBayMap.H"
+#include "GriddedBathymetryMap.H"
 
 #include "AdvectionTestBCUtil.H"
 #include "LockExchangeBCUtil.H"
@@ -204,6 +205,22 @@ void ProblemContext::readAMR ()
     }
     pout() << "\tregrid_intervals = " << regrid_intervals << endl;
 
+    regrid_drift_tol = 0.0;
+    ppAMR.query("regrid_drift_tol", regrid_drift_tol);
+    pout() << "\tregrid_drift_tol = " << regrid_drift_tol << endl;
+
+    min_regrid_intervals = vintLevels;
+    if (max_level > 0 && regrid_drift_tol > 0.0) {
+        ppAMR.queryarr("min_regrid_intervals", min_regrid_intervals, 0, num_read_levels);
+        pout() << "\tmin_regrid_intervals = " << min_regrid_intervals << endl;
+    }
+
+    max_level_cells = Vector<Real>(num_read_levels, 0.0);
+    if (max_level > 0) {
+        ppAMR.queryarr("max_level_cells", max_level_cells, 0, num_read_levels);
+    }
+    pout() << "\tmax_level_cells = " << max_level_cells << endl;
+
     Vector<int> levRefRatio(SpaceDim, 1);
     bool defaultSet = ppAMR.queryarr("refratio", levRefRatio, 0, SpaceDim);
 
@@ -237,6 +254,10 @@ void ProblemContext::readAMR ()
     ppAMR.query("fill_ratio", fill_ratio);
     pout() << "\tfill_ratio = " << fill_ratio << std::endl;
 
+    distributedClustering = false;
+    ppAMR.query("distributed_clustering", distributedClustering);
+    pout() << "\tdistributed_clustering = " << distributedClustering << std::endl;
+
     splitDirs = Vector<int>(SpaceDim, 1);
     ppAMR.queryarr("splitDirs", splitDirs, 0, SpaceDim);
     for (int dir = 0; dir < SpaceDim; ++dir) {
@@ -247,6 +268,22 @@ void ProblemContext::readAMR ()
         }
     }
 
+    column_block_factor = 0;
+    ppAMR.query("column_block_factor", column_block_factor);
+    if (column_block_factor > 0) {
+        if (column_block_factor % block_factor != 0) {
+            MayDay::Error("amr.column_block_factor must be a multiple of amr.block_factor");
+        }
+        bool hasSpanDir = false;
+        for (int dir = 0; dir < SpaceDim; ++dir) {
+            if (splitDirs[dir] == 0) hasSpanDir = true;
+        }
+        if (!hasSpanDir) {
+            pout() << "\tcolumn_block_factor has no effect unless some splitDirs are 0." << endl;
+        }
+    }
+    pout() << "\tcolumn_block_factor = " << column_block_factor << endl;
+
     const int nproc = numProc();
     maxGridSize = IntVect::Zero;
     IntVect userDefined = IntVect::Zero;
@@ -437,10 +474,88 @@ void ProblemContext::readAMR ()
     ppAMR.query("tags_grow", tags_grow);
     pout() << "\ttags_grow = " << tags_grow << endl;
 
+    bitmap_tagging = false;
+    ppAMR.query("bitmap_tagging", bitmap_tagging);
+    pout() << "\tbitmap_tagging = " << bitmap_tagging << endl;
+
+    predictive_tagging = false;
+    ppAMR.query("predictive_tagging", predictive_tagging);
+    pout() << "\tpredictive_tagging = " << predictive_tagging << endl;
+
+    // Per-level tagging criteria
+    ParmParse ppTag("tag");
+    tagCriteria.clear();
+
+    int numTagCriteria = 0;
+    ppTag.query("num", numTagCriteria);
+
+    for (int c = 0; c < numTagCriteria; ++c) {
+        std::ostringstream tagKey;
+        tagKey << "tag." << c;
+        ParmParse ppThis(tagKey.str().c_str());
+
+        TagCriterion crit;
+
+        std::ostringstream defName;
+        defName << "tag" << c;
+        crit.name = defName.str();
+        ppThis.query("name", crit.name);
+
+        std::string typeStr;
+        ppThis.get("type", typeStr);
+        crit.type = TagCriterion::typeFromName(typeStr);
+
+        if (crit.type == TagCriterion::Type::GRADIENT ||
+            crit.type == TagCriterion::Type::UNDIVIDED) {
+            ppThis.get("field", crit.field);
+        }
+
+        if (crit.type == TagCriterion::Type::REGION) {
+            ppThis.getarr("lo", vint, 0, SpaceDim);
+            crit.lo = IntVect(vint);
+            ppThis.getarr("hi", vint, 0, SpaceDim);
+            crit.hi = IntVect(vint);
+        }
+
+        const int numTols = ppThis.countval("tol");
+        if (numTols <= 0) {
+            MayDay::Error("tag.N.tol must list at least one tolerance");
+        }
+        ppThis.getarr("tol", crit.tol, 0, numTols);
+
+        pout() << "\t" << tagKey.str() << ": " << crit.name << ", " << typeStr;
+        if (!crit.field.empty()) {
+            pout() << " on " << crit.field;
+        }
+        if (crit.type == TagCriterion::Type::REGION) {
+            pout() << " " << Box(crit.lo, crit.hi);
+        }
+        pout() << ", tol =";
+        for (int t = 0; t < numTols; ++t) {
+            pout() << " " << crit.tol[t];
+        }
+        pout() << endl;
+
+        tagCriteria.push_back(crit);
+    }
+
     write_stdout = true;
     ppAMR.query("write_stdout", write_stdout);
     pout() << "\twrite_stdout = " << write_stdout << endl;
 
+    diagnostics_file = std::string("");
+    ppAMR.query("diagnostics_file", diagnostics_file);
+    if (!diagnostics_file.empty()) {
+        pout() << "\tdiagnostics_file = " << diagnostics_file << endl;
+    }
+
+    diagnostics_flushInterval = 10;
+    ppAMR.query("diagnostics_flushInterval", diagnostics_flushInterval);
+    pout() << "\tdiagnostics_flushInterval = " << diagnostics_flushInterval << endl;
+    if (diagnostics_flushInterval < 1) {
+        MayDay::Error("amr.diagnostics_flushInterval must be at least 1");
+    }
+
     init_dt_multiplier = 1.0;
     ppAMR.query("init_dt_multiplier", init_dt_multiplier);
     pout() << "\tinit_dt_multiplier = " << init_dt_multiplier << endl;
@@ -616,6 +731,33 @@ void ProblemContext::readGeometry ()
             }
         }
         break;
+    case CoordMap::GRIDDEDBATHYMETRY:
+        {
+            ppGeo.get("bathymetryFile", bathymetryFile);
+            pout() << "\tbathymetryFile = " << bathymetryFile << endl;
+        }
+        break;
+    }
+
+    tidalAmplitude = 0.0;
+    tidalPeriod = 0.0;
+    if (ppGeo.query("tidalAmplitude", tidalAmplitude)) {
+        pout() << "\ttidalAmplitude = " << tidalAmplitude << endl;
+    }
+    if (tidalAmplitude != 0.0) {
+        ppGeo.get("tidalPeriod", tidalPeriod);
+        pout() << "\ttidalPeriod = " << tidalPeriod << endl;
+        if (tidalPeriod <= 0.0) {
+            MayDay::Error("geometry.tidalPeriod must be positive");
+        }
+    }
+
+    metricCacheBudget = 512.0;
+    ppGeo.query("metricCacheBudget", metricCacheBudget);
+    if (metricCacheBudget < 0.0) {
+        pout() << "\tmetricCacheBudget = unlimited" << endl;
+    } else {
+        pout() << "\tmetricCacheBudget = " << metricCacheBudget << " MB" << endl;
     }
 
     pout() << endl;
@@ -662,6 +804,9 @@ GeoSourceInterface* ProblemContext::newGeoSourceInterface () const
     case ProblemContext::CoordMap::NEWBEAMGENERATOR:
         geoSourcePtr = new NewBeamGeneratorMap;
         break;
+    case ProblemContext::CoordMap::GRIDDEDBATHYMETRY:
+        geoSourcePtr = new GriddedBathymetryMap;
+        break;
     default:
         MayDay::Error("ProblemContext::newGeoSourceInterface received "
                       "an invalid s_coordMap");
@@ -713,9 +858,31 @@ void ProblemContext::readPlot ()
         checkpointScheduled = true;
         pout() << "\tcheckpoint_interval = " << checkpoint_interval << std::endl;
     }
+    checkpoint_collective = false;
+    checkpoint_chunkBytes = 1048576;
+    checkpoint_fullInterval = 1;
+    checkpoint_stageDir = "";
     if (checkpointScheduled) {
         ppPlot.query("checkpoint_prefix", check_prefix);
         pout() << "\tcheckpoint_prefix = " << check_prefix << std::endl;
+
+        ppPlot.query("checkpoint_collective", checkpoint_collective);
+        pout() << "\tcheckpoint_collective = " << checkpoint_collective << std::endl;
+
+        ppPlot.query("checkpoint_chunkBytes", checkpoint_chunkBytes);
+        pout() << "\tcheckpoint_chunkBytes = " << checkpoint_chunkBytes << std::endl;
+        if (checkpoint_chunkBytes < int(sizeof(Real))) {
+            MayDay::Error("plot.checkpoint_chunkBytes is too small");
+        }
+
+        ppPlot.query("checkpoint_fullInterval", checkpoint_fullInterval);
+        pout() << "\tcheckpoint_fullInterval = " << checkpoint_fullInterval << std::endl;
+        if (checkpoint_fullInterval < 1) {
+            MayDay::Error("plot.checkpoint_fullInterval must be at least 1");
+        }
+
+        ppPlot.query("checkpoint_stageDir", checkpoint_stageDir);
+        pout() << "\tcheckpoint_stageDir = " << checkpoint_stageDir << std::endl;
     } else {
         MayDay::Warning("No checkpoints scheduled");
     }
@@ -724,6 +891,25 @@ void ProblemContext::readPlot ()
         MayDay::Error("You must schedule a plot or a checkpoint");
     }
 
+    thumbnail_interval = -1;
+    thumbnail_prefix = std::string("thumb_");
+    thumbnail_coarsening = 4 * IntVect::Unit;
+    ppPlot.query("thumbnail_interval", thumbnail_interval);
+    pout() << "\tthumbnail_interval = " << thumbnail_interval << endl;
+    if (thumbnail_interval > 0) {
+        ppPlot.query("thumbnail_prefix", thumbnail_prefix);
+        pout() << "\tthumbnail_prefix = " << thumbnail_prefix << endl;
+
+        Vector<int> vint(SpaceDim);
+        if (ppPlot.queryarr("thumbnail_coarsening", vint, 0, SpaceDim)) {
+            thumbnail_coarsening = IntVect(vint);
+        }
+        pout() << "\tthumbnail_coarsening = " << thumbnail_coarsening << endl;
+        if (thumbnail_coarsening.min() < 1) {
+            MayDay::Error("plot.thumbnail_coarsening must be positive");
+        }
+    }
+
     write_divergence = false;
     ppPlot.query("writeDivergence", write_divergence);
     pout() << "\twrite_divergence = " << write_divergence << endl;
@@ -783,6 +969,164 @@ void ProblemContext::readPlot ()
     ppPlot.query("writeGeometry", write_geometry);
     pout() << "\twrite_geometry = " << write_geometry << endl;
 
+    plot_fields.clear();
+    {
+        const int numFields = ppPlot.countval("fields");
+        if (numFields > 0) {
+            ppPlot.getarr("fields", plot_fields, 0, numFields);
+
+            pout() << "\tfields =";
+            for (int f = 0; f < numFields; ++f) {
+                pout() << " " << plot_fields[f];
+            }
+            pout() << endl;
+        }
+    }
+
+    plot_writeOptions = PlotWriteOptions();
+
+    ppPlot.query("precision", plot_writeOptions.precision);
+    pout() << "\tprecision = " << plot_writeOptions.precision << endl;
+    if (plot_writeOptions.precision != 32 && plot_writeOptions.precision != 64) {
+        MayDay::Error("plot.precision must be 32 or 64");
+    }
+
+    ppPlot.query("deflateLevel", plot_writeOptions.deflateLevel);
+    pout() << "\tdeflateLevel = " << plot_writeOptions.deflateLevel << endl;
+    if (plot_writeOptions.deflateLevel < 0 || 9 < plot_writeOptions.deflateLevel) {
+        MayDay::Error("plot.deflateLevel must be in [0, 9]");
+    }
+
+    ppPlot.query("useShuffle", plot_writeOptions.useShuffle);
+    pout() << "\tuseShuffle = " << plot_writeOptions.useShuffle << endl;
+
+    ppPlot.query("chunkSize", plot_writeOptions.chunkSize);
+    pout() << "\tchunkSize = " << plot_writeOptions.chunkSize << endl;
+    if (plot_writeOptions.chunkSize <= 0) {
+        MayDay::Error("plot.chunkSize must be positive");
+    }
+
+    // Probes
+    ParmParse ppProbe("probe");
+    probes.clear();
+
+    int numProbes = 0;
+    ppProbe.query("num", numProbes);
+    if (numProbes > 0) {
+        probe_prefix = std::string("probe_");
+        ppProbe.query("prefix", probe_prefix);
+        pout() << "\tprobe.prefix = " << probe_prefix << endl;
+    }
+
+    for (int p = 0; p < numProbes; ++p) {
+        std::ostringstream probeKey;
+        probeKey << "probe." << p;
+        ParmParse ppThis(probeKey.str().c_str());
+
+        ProbeSpec spec;
+
+        std::ostringstream defName;
+        defName << "probe" << p;
+        spec.name = defName.str();
+        ppThis.query("name", spec.name);
+
+        std::string typeStr;
+        ppThis.get("type", typeStr);
+
+        Vector<int> vint(SpaceDim, 0);
+        if (typeStr == std::string("box")) {
+            spec.type = ProbeSpec::Type::BOX;
+            ppThis.getarr("lo", vint, 0, SpaceDim);
+            spec.lo = IntVect(vint);
+            ppThis.getarr("hi", vint, 0, SpaceDim);
+            spec.hi = IntVect(vint);
+        } else if (typeStr == std::string("slice")) {
+            spec.type = ProbeSpec::Type::SLICE;
+            ppThis.get("dir", spec.dir);
+            ppThis.get("pos", spec.pos);
+            if (spec.dir < 0 || SpaceDim <= spec.dir) {
+                MayDay::Error("probe.N.dir is out of range");
+            }
+        } else if (typeStr == std::string("point")) {
+            spec.type = ProbeSpec::Type::POINT;
+            ppThis.getarr("point", vint, 0, SpaceDim);
+            spec.lo = IntVect(vint);
+            spec.hi = spec.lo;
+        } else {
+            MayDay::Error("probe.N.type must be box, slice, or point");
+        }
+
+        ppThis.query("interval", spec.interval);
+        ppThis.query("level", spec.level);
+
+        const int numFields = ppThis.countval("fields");
+        if (numFields <= 0) {
+            MayDay::Error("probe.N.fields must list at least one field");
+        }
+        ppThis.getarr("fields", spec.fields, 0, numFields);
+
+        pout() << "\t" << probeKey.str() << ": " << spec.name << ", " << typeStr
+               << ", every " << spec.interval << " steps on level " << spec.level
+               << ", fields =";
+        for (int f = 0; f < numFields; ++f) {
+            pout() << " " << spec.fields[f];
+        }
+        pout() << endl;
+
+        probes.push_back(spec);
+    }
+
+    // Running statistics
+    ParmParse ppStats("stats");
+    stats_fields.clear();
+    stats_covariances.clear();
+
+    const int numStatsFields = ppStats.countval("fields");
+    if (numStatsFields > 0) {
+        ppStats.getarr("fields", stats_fields, 0, numStatsFields);
+        pout() << "\tstats.fields =";
+        for (int f = 0; f < numStatsFields; ++f) {
+            pout() << " " << stats_fields[f];
+        }
+        pout() << endl;
+
+        // Covariances are listed as a:b, where a and b are in stats.fields.
+        const int numCovs = ppStats.countval("covariances");
+        std::vector<std::string> covStrs;
+        if (numCovs > 0) {
+            ppStats.getarr("covariances", covStrs, 0, numCovs);
+        }
+
+        pout() << "\tstats.covariances =";
+        for (int c = 0; c < numCovs; ++c) {
+            const size_t colon = covStrs[c].find(':');
+            if (colon == std::string::npos) {
+                MayDay::Error("stats.covariances must be listed as a:b");
+            }
+            const std::string nameA = covStrs[c].substr(0, colon);
+            const std::string nameB = covStrs[c].substr(colon + 1);
+
+            std::pair<int,int> cov(-1, -1);
+            for (int f = 0; f < numStatsFields; ++f) {
+                if (stats_fields[f] == nameA) cov.first = f;
+                if (stats_fields[f] == nameB) cov.second = f;
+            }
+            if (cov.first < 0 || cov.second < 0) {
+                MayDay::Error("stats.covariances can only pair fields listed in stats.fields");
+            }
+
+            stats_covariances.push_back(cov);
+            pout() << " " << covStrs[c];
+        }
+        pout() << endl;
+    }
+
+    stats_startTime = 0.0;
+    ppStats.query("startTime", stats_startTime);
+    if (numStatsFields > 0) {
+        pout() << "\tstats.startTime = " << stats_startTime << endl;
+    }
+
     pout() << endl;
 }
 
@@ -49,6 +49,7 @@ Real computeMaxBVFreq (const LevelData<FluxBox>& a_B,
     // Create grid references, etc...
     const RealVect& dx = a_levGeo.getDx();
     const GeoSourceInterface& geoSource = *a_levGeo.getGeoSourcePtr();
+    MapTimeScope mapTime(a_levGeo);
     const DisjointBoxLayout& grids = a_B.getBoxes();
     DataIterator dit = grids.dataIterator();
 
@@ -128,6 +129,7 @@ void computeBVFreq (FArrayBox&           a_N,
     // Create grid references, etc...
     const RealVect& dx = a_levGeo.getDx();
     const GeoSourceInterface& geoSource = *a_levGeo.getGeoSourcePtr();
+    MapTimeScope mapTime(a_levGeo);
 
     // Fill dXi^i/dz
     FArrayBox dXidzFAB(a_destBox, SpaceDim);
@@ -218,6 +220,7 @@ void solveVertEigenProblem (LevelData<FArrayBox>&       a_c0,
     const RealVect& dx = a_levGeo.getDx();
     const Real dz = dx[SpaceDim-1];
     const GeoSourceInterface& geoSource = *a_levGeo.getGeoSourcePtr();
+    MapTimeScope mapTime(a_levGeo);
 
 #define ARRAY1D(a)   Box(IntVect(D_DECL((1),(1),(1))), IntVect(D_DECL((a),(1),(1)))), (1)
 #define ARRAY2D(a,b) Box(IntVect(D_DECL((1),(1),(1))), IntVect(D_DECL((a),(b),(1)))), (1)
@@ -0,0 +1,96 @@
+/*******************************************************************************
+ *  SOMAR - Stratified Ocean Model with Adaptive Refinement
+ *  Developed by Ed Santilli & Alberto Scotti
+ *  Copyright (C) 2014 University of North Carolina at Chapel Hill
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301
+ *  USA
+ *
+ *  For up-to-date contact information, please visit the repository homepage,
+ *  https://github.com/somarhub.
+ ******************************************************************************/
+#include "TagCriterion.H"
+#include "MayDay.H"
+#include <sstream>
+
+
+// -----------------------------------------------------------------------------
+// The tolerance on a_level. The last tolerance given is used on all
+// finer levels. A tolerance <= 0 turns the criterion off on that level.
+// -----------------------------------------------------------------------------
+Real TagCriterion::tolerance (const int a_level) const
+{
+    CH_assert(a_level >= 0);
+    if (tol.size() == 0) return 0.0;
+
+    const int idx = (a_level < int(tol.size()) ? a_level : int(tol.size()) - 1);
+    return tol[idx];
+}
+
+
+// -----------------------------------------------------------------------------
+// The REGION criterion's box, refined to the index space of the level
+// whose domain is a_levelDomain. lo and hi are level 0 indices.
+// -----------------------------------------------------------------------------
+Box TagCriterion::region (const Box& a_levelDomain,
+                          const Box& a_baseDomain) const
+{
+    CH_assert(type == Type::REGION);
+
+    const IntVect refToBase = a_levelDomain.size() / a_baseDomain.size();
+
+    Box retBox(lo, hi);
+    retBox.refine(refToBase);
+    retBox &= a_levelDomain;
+
+    return retBox;
+}
+
+
+// -----------------------------------------------------------------------------
+// Converts between the input file names and the Type enum.
+// -----------------------------------------------------------------------------
+const char* TagCriterion::typeName (const int a_type)
+{
+    static const char* names[Type::_NUM_TYPES] = {
+        "gradient",
+        "undivided",
+        "vortquota",
+        "richardson",
+        "region"
+    };
+
+    if (a_type < 0 || Type::_NUM_TYPES <= a_type) {
+        MayDay::Error("TagCriterion::typeName received a bad type");
+    }
+    return names[a_type];
+}
+
+
+// -----------------------------------------------------------------------------
+// Converts between the input file names and the Type enum.
+// -----------------------------------------------------------------------------
+int TagCriterion::typeFromName (const std::string& a_name)
+{
+    for (int t = 0; t < Type::_NUM_TYPES; ++t) {
+        if (a_name == typeName(t)) return t;
+    }
+
+    std::ostringstream msg;
+    msg << "Unknown tagging criterion type " << a_name
+        << ". Use gradient, undivided, vortquota, richardson, or region.";
+    MayDay::Error(msg.str().c_str());
+    return -1;
+}